@@ -0,0 +1,78 @@
+// Benchmark of `cc_parse_batch` scaling over the number of threads:
+//
+// many independent inputs, each a list of comma-separated integers, are parsed with the same frozen parser.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define NUM_SOURCES 512
+#define SOURCE_ITEMS 2000
+
+static struct cc_result count_items(size_t n, void **items) {
+    for(size_t i = 0; i < n; i++)
+        free(items[i]);
+    return cc_ok((void*) (uintptr_t) n);
+}
+
+static char *generate_input(unsigned seed) {
+    char *input = alloc_input(SOURCE_ITEMS * 12 + 1);
+
+    size_t len = 0;
+    for(int i = 0; i < SOURCE_ITEMS; i++) {
+        next_random(&seed);
+        len += sprintf(input + len, "%s%u", i ? "," : "", (seed >> 8) % 1000000);
+    }
+
+    return input;
+}
+
+int main(void) {
+    static char *inputs[NUM_SOURCES];
+    static struct cc_source *sources[NUM_SOURCES];
+    static struct cc_result results[NUM_SOURCES];
+
+    for(unsigned i = 0; i < NUM_SOURCES; i++) {
+        inputs[i] = generate_input(i);
+        sources[i] = cc_string_source((const char8_t*) inputs[i]);
+    }
+
+    struct cc_parser *number = cc_capture(cc_least(1, NULL, cc_digit()));
+    struct cc_parser *list = cc_seq(cc_fold_first, cc_chain(count_items, number, cc_noreturn(cc_char(','))), cc_eof());
+    list = cc_freeze(list);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double single = 0.0;
+
+    printf("%d sources, %ld cpus\n", NUM_SOURCES, cpus);
+    printf("threads | time (ms) | speedup\n");
+    for(long threads = 1; threads <= (cpus > 0 ? cpus : 1); threads *= 2) {
+        double start = now();
+        int err = cc_parse_batch((const struct cc_source *const *) sources, NUM_SOURCES, cc_retain(list), results, threads);
+        double time = now() - start;
+
+        for(unsigned i = 0; i < NUM_SOURCES; i++) {
+            if(err || results[i].err || (uintptr_t) results[i].out != 2 * SOURCE_ITEMS - 1) {
+                fprintf(stderr, "parsing failed\n");
+                return EXIT_FAILURE;
+            }
+        }
+
+        if(threads == 1)
+            single = time;
+
+        printf("%7ld | %9.3f | %7.2f\n", threads, time * 1e3, single / time);
+    }
+
+    cc_release(list);
+    for(unsigned i = 0; i < NUM_SOURCES; i++) {
+        cc_close(sources[i]);
+        free(inputs[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
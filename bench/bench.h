@@ -0,0 +1,51 @@
+// Helpers shared by the benchmarks:
+//
+// every benchmark is a program of its own, so everything in here is `static inline`.
+
+#ifndef CCOMBINATOR_BENCH_H
+#define CCOMBINATOR_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sys/resource.h>
+
+// number of times each measurement is repeated, only the fastest run is reported
+#ifndef NUM_RUNS
+    #define NUM_RUNS 5
+#endif
+
+static inline double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// peak resident memory of the process in KiB
+static inline long peak_memory(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// keeps the shortest `time` of all runs in `best`
+static inline void keep_best(double *best, int run, double time) {
+    if(run == 0 || time < *best)
+        *best = time;
+}
+
+// allocates the buffer for generated input, there is nothing to measure without it
+static inline char *alloc_input(size_t size) {
+    char *input = malloc(size);
+    if(!input)
+        exit(EXIT_FAILURE);
+    return input;
+}
+
+// advances the pseudo-random `seed`, so the generated input is the same on every platform
+static inline unsigned next_random(unsigned *seed) {
+    return *seed = *seed * 1103515245u + 12345u;
+}
+
+#endif
@@ -0,0 +1,223 @@
+// Benchmark of the C code generated by `cc_codegen_c` against interpreting the same parser:
+//
+//     json = @null: ws, value, ws;
+//     value = object | array | string | number | "true" | "false" | "null";
+//     ...
+//
+// the grammar is read from bench/codegen.bnf, from which `ccgen` generates `parse_json` at build time.
+// both parse the same generated document and have to count the same number of members.
+// before that, both have to agree on a few samples with non-ascii characters.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#ifndef GRAMMAR_PATH
+    #define GRAMMAR_PATH "bench/codegen.bnf"
+#endif
+
+#define NUM_RECORDS 10000
+#define MAX_NAMES 256
+
+// generated by ccgen
+int parse_json(const char8_t *in, size_t n, struct cc_result *r);
+
+static size_t num_members;
+
+// the names of all members are appended here while checking the samples, NULL otherwise
+static char *member_names;
+
+struct cc_result count_member(size_t n, void **r) {
+    if(member_names && n > 0 && r[0] && strlen(member_names) + strlen(r[0]) < MAX_NAMES)
+        strcat(member_names, r[0]);
+
+    for(size_t i = 0; i < n; i++)
+        free(r[i]);
+
+    num_members++;
+    return cc_ok(NULL);
+}
+
+int is_string_char(char32_t c) {
+    return c >= 0x20 && c != '"' && c != '\\';
+}
+
+int is_escape_char(char32_t c) {
+    return c && c < 0x80 && strchr("\"\\/bfnrt", (int) c);
+}
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_RECORDS * 192 + 16);
+
+    size_t len = sprintf(input, "[\n");
+    unsigned seed = 1;
+    for(int i = 0; i < NUM_RECORDS; i++) {
+        next_random(&seed);
+        len += sprintf(input + len,
+            "  {\"id\": %d, \"name\": \"record \\\"%u\\\"\", \"score\": -%u.%u, \"active\": %s, \"tags\": [\"a\", \"b\\n\"], \"parent\": null}%s\n",
+            i, seed >> 20, (seed >> 8) % 1000, (seed >> 4) % 100, seed & 1 ? "true" : "false", i + 1 < NUM_RECORDS ? "," : "");
+    }
+
+    len += sprintf(input + len, "]\n");
+    *size = len;
+    return input;
+}
+
+static double measure_interpreted(const char *input, size_t size, struct cc_parser *p) {
+    struct cc_source *src = cc_nstring_source((const char8_t*) input, size);
+    if(!src)
+        exit(EXIT_FAILURE);
+
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        num_members = 0;
+
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    cc_close(src);
+    return best;
+}
+
+static double measure_generated(const char *input, size_t size) {
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        num_members = 0;
+
+        double start = now();
+        int err = parse_json((const char8_t*) input, size, &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    return best;
+}
+
+// valid and invalid documents with multi-byte characters, and a stray continuation byte inside of a string
+static const char *const samples[] = {
+    "{\"a1\xc3\xa9\": 1, \"\xe2\x82\xac\": [\"\xf0\x9f\x98\x80\", \"caf\xc3\xa9\"]}",
+    "[\"\xc3\xa9\", \xc3\xa9]",
+    "{\"ab\xa9\": null}",
+};
+
+#define NUM_SAMPLES (sizeof(samples) / sizeof(*samples))
+
+// parses `in` and returns whether it is valid, the member names are written to `names`
+static bool parse_sample(const char *in, struct cc_parser *p, char names[MAX_NAMES]) {
+    struct cc_result r;
+    int err;
+
+    names[0] = '\0';
+    member_names = names;
+
+    if(p) {
+        struct cc_source *src = cc_nstring_source((const char8_t*) in, strlen(in));
+        if(!src)
+            exit(EXIT_FAILURE);
+
+        err = cc_parse(src, cc_retain(p), &r);
+        cc_close(src);
+    }
+    else
+        err = parse_json((const char8_t*) in, strlen(in), &r);
+
+    member_names = NULL;
+
+    if(err) {
+        fprintf(stderr, "parsing failed: %s\n", strerror(err));
+        exit(EXIT_FAILURE);
+    }
+
+    if(r.err) {
+        cc_err_free(r.err);
+        return false;
+    }
+
+    return true;
+}
+
+static bool check_samples(struct cc_parser *p) {
+    for(size_t i = 0; i < NUM_SAMPLES; i++) {
+        char interpreted[MAX_NAMES], generated[MAX_NAMES];
+        bool interpreted_valid = parse_sample(samples[i], p, interpreted);
+        bool generated_valid = parse_sample(samples[i], NULL, generated);
+
+        if(interpreted_valid != generated_valid || strcmp(interpreted, generated) != 0) {
+            fprintf(stderr, "sample %zu: the generated parser returned %s [%s] instead of %s [%s]\n", i,
+                generated_valid ? "valid" : "invalid", generated, interpreted_valid ? "valid" : "invalid", interpreted);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void) {
+    struct cc_source *bnf = cc_open(GRAMMAR_PATH);
+    if(!bnf) {
+        perror(GRAMMAR_PATH);
+        return EXIT_FAILURE;
+    }
+
+    struct cc_error *e = NULL;
+    struct cc_grammar *g = cc_bnf_from(bnf, CC_ACTIONS(
+        cc_action_fold("null", cc_fold_null),
+        cc_action_fold("concat", cc_fold_concat),
+        cc_action_fold("member", count_member),
+        cc_action_match("isdigit", cc_is_digit),
+        cc_action_match("isspace", cc_is_whitespace),
+        cc_action_match("strchar", is_string_char),
+        cc_action_match("escape", is_escape_char)
+    ), &e);
+    cc_close(bnf);
+
+    if(!g) {
+        fprintf(stderr, "compiling the grammar failed\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    char *input = generate_input(&size);
+
+    struct cc_parser *p = cc_grammar_link(g, "json");
+    if(!check_samples(p))
+        return EXIT_FAILURE;
+
+    double interpreted = measure_interpreted(input, size, p);
+    size_t interpreted_members = num_members;
+    cc_release(p);
+
+    double generated = measure_generated(input, size);
+    if(num_members != interpreted_members) {
+        fprintf(stderr, "the generated parser counted %zu members instead of %zu\n", num_members, interpreted_members);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d records, %zu members, %zu bytes\n", NUM_RECORDS, num_members, size);
+    printf("interpreted: %.3f ms (%.1f MB/s)\n", interpreted * 1e3, size / interpreted * 1e-6);
+    printf("generated:   %.3f ms (%.1f MB/s, %.2fx)\n", generated * 1e3, size / generated * 1e-6, interpreted / generated);
+
+    cc_grammar_free(g);
+    free(input);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+// Benchmark of skipping block comments with `cc_many_until` and a literal terminator:
+//
+//     file = { ws | "(*" { any } "*)" }
+//
+// every comment body is searched for "*)" directly instead of trying the terminator before each character.
+// build the library with `-DCC_NO_SCAN` to compare against the character-by-character loop.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_COMMENTS 2000
+#define COMMENT_SIZE 4096
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_COMMENTS * (COMMENT_SIZE + 8) + 1);
+
+    static const char text[] = "lorem ipsum (dolor) sit * amet,\nconsectetur adipiscing elit ";
+
+    size_t len = 0;
+    for(int i = 0; i < NUM_COMMENTS; i++) {
+        len += sprintf(input + len, "(*");
+        for(size_t j = 0; j < COMMENT_SIZE; j++)
+            input[len++] = text[j % (sizeof(text) - 1)];
+        len += sprintf(input + len, "*)\n");
+    }
+
+    *size = len;
+    return input;
+}
+
+int main(void) {
+    size_t size;
+    char *input = generate_input(&size);
+
+    struct cc_parser *comment = cc_and(2, cc_fold_null,
+        cc_noreturn(cc_string(u8"(*")),
+        cc_many_until(cc_fold_null, cc_any(), cc_noreturn(cc_string(u8"*)"))));
+    struct cc_parser *p = cc_freeze(cc_and(2, NULL, cc_many(NULL, cc_either(cc_whitespace(), comment)), cc_eof()));
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            return EXIT_FAILURE;
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    printf("%d comments, %zu bytes: %.3f ms (%.1f MiB/s)\n", NUM_COMMENTS, size, best * 1e3, size / best / (1 << 20));
+
+    cc_release(p);
+    cc_close(src);
+    free(input);
+    return EXIT_SUCCESS;
+}
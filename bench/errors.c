@@ -0,0 +1,119 @@
+// Benchmark of `CC_PARSE_LAZY_ERRORS` against tracking errors through the whole parse:
+//
+//     stmt = "let", ident, '=', expr, ';' | "print", expr, ';' | "if", expr, "then", stmt;
+//     expr = term, { ('+' | '-' | '*' | '/' | "==" | "<"), term };
+//     term = number | ident | '(', expr, ')';
+//
+// many small inputs are parsed with the same context, once all valid and once with an error at the end of each.
+// valid inputs only take the pass without errors, invalid ones are parsed a second time to build the error report.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_INPUTS 10000
+#define NUM_STMTS 8
+
+static char *generate_input(unsigned seed, bool valid) {
+    char *input = alloc_input(NUM_STMTS * 64 + 1);
+
+    size_t len = 0;
+    for(int i = 0; i < NUM_STMTS; i++) {
+        next_random(&seed);
+        switch((seed >> 16) % 3) {
+        case 0:
+            len += sprintf(input + len, "let v%u = (v%u + %u) * %u;", seed % 100, (seed >> 4) % 100, (seed >> 8) % 1000, seed % 7);
+            break;
+        case 1:
+            len += sprintf(input + len, "print v%u / %u - (%u);", (seed >> 4) % 100, seed % 97 + 1, (seed >> 8) % 1000);
+            break;
+        default:
+            len += sprintf(input + len, "if v%u == %u then print v%u < %u;", seed % 100, (seed >> 4) % 10, (seed >> 8) % 100, seed % 1000);
+            break;
+        }
+    }
+
+    // an unterminated statement at the very end makes every alternative fail deep into the input
+    if(!valid)
+        len += sprintf(input + len, "let x = (1 + ");
+
+    input[len] = '\0';
+    return input;
+}
+
+static double measure(struct cc_context *ctx, struct cc_source *const sources[], struct cc_parser *p, int flags, bool valid) {
+    double best = 0.0;
+    for(int run = 0; run < NUM_RUNS; run++) {
+        double start = now();
+        for(int i = 0; i < NUM_INPUTS; i++) {
+            struct cc_result r;
+            if(cc_parse_ctx(ctx, sources[i], cc_retain(p), &r, flags) || !r.err != valid) {
+                fprintf(stderr, "unexpected parse result\n");
+                exit(EXIT_FAILURE);
+            }
+
+            if(r.err)
+                cc_err_free(r.err);
+        }
+
+        double time = now() - start;
+        keep_best(&best, run, time);
+    }
+
+    return best;
+}
+
+int main(void) {
+    struct cc_error *e = NULL;
+    struct cc_grammar *g = cc_bnf(u8""
+        "stmts = @null: stmt, @null{ stmt };\n"
+        "stmt = @null: \"let\", ws, ident, ws, '=', expr, ws, ';' | @null: \"print\", expr, ws, ';' | @null: \"if\", expr, ws, \"then\", ws, stmt;\n"
+        "expr = @null: ws, term, @null{ @null: ws, ( '+' | '-' | '*' | '/' | \"==\" | '<' ), ws, term };\n"
+        "term = @null: @isdigit, @null{ @isdigit } | ident | @null: '(', expr, ws, ')';\n"
+        "ident = @null: @isalpha, @null{ @isalpha | @isdigit };\n"
+        "ws = @null{ ' ' };\n",
+        CC_ACTIONS(
+            cc_action_match("isalpha", cc_is_alpha),
+            cc_action_match("isdigit", cc_is_digit),
+            cc_action_fold("null", cc_fold_null)
+        ), &e);
+    if(!g) {
+        fprintf(stderr, "compiling the grammar failed\n");
+        return EXIT_FAILURE;
+    }
+
+    struct cc_parser *p = cc_seq(cc_fold_first, cc_grammar_link(g, "stmts"), cc_eof());
+    struct cc_context *ctx = cc_context_create();
+
+    static char *inputs[2][NUM_INPUTS];
+    static struct cc_source *sources[2][NUM_INPUTS];
+    for(int valid = 0; valid < 2; valid++) {
+        for(unsigned i = 0; i < NUM_INPUTS; i++) {
+            inputs[valid][i] = generate_input(i, valid);
+            sources[valid][i] = cc_string_source((const char8_t*) inputs[valid][i]);
+        }
+    }
+
+    printf("%d inputs of %d statements\n", NUM_INPUTS, NUM_STMTS);
+    printf("input   | default (ms) | lazy errors (ms) | speedup\n");
+    for(int valid = 1; valid >= 0; valid--) {
+        double tracked = measure(ctx, sources[valid], p, CC_PARSE_DEFAULT, valid);
+        double lazy = measure(ctx, sources[valid], p, CC_PARSE_LAZY_ERRORS, valid);
+        printf("%-7s | %12.3f | %16.3f | %.2fx\n", valid ? "valid" : "invalid", tracked * 1e3, lazy * 1e3, tracked / lazy);
+    }
+
+    for(int valid = 0; valid < 2; valid++) {
+        for(unsigned i = 0; i < NUM_INPUTS; i++) {
+            cc_close(sources[valid][i]);
+            free(inputs[valid][i]);
+        }
+    }
+
+    cc_context_destroy(ctx);
+    cc_release(p);
+    cc_grammar_free(g);
+    return EXIT_SUCCESS;
+}
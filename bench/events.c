@@ -0,0 +1,138 @@
+// Benchmark of `cc_parse_events` against building a result tree with fold actions:
+//
+//     doc = { entry };
+//     entry = key, '=', value, '\n';
+//     key = alpha, { alpha | digit };
+//     value = digit, { digit } | key;
+//
+// the tree is a list of entry nodes holding their key and value strings, the events are counted instead.
+// `value` tries a number first, so every textual value backtracks over a failed alternative.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_ENTRIES 500000
+
+struct entry {
+    char *key;
+    char *value;
+};
+
+static size_t num_entries;
+
+static struct cc_result make_entry(size_t n, void **r) {
+    struct entry *e = malloc(sizeof(struct entry));
+    if(!e)
+        return cc_err(cc_error("out of memory"));
+
+    // key, '=', value, '\n'
+    e->key = r[0];
+    e->value = r[2];
+    free(r[1]);
+    free(r[3]);
+    (void) n;
+
+    return cc_ok(e);
+}
+
+static struct cc_result make_list(size_t n, void **r) {
+    for(size_t i = 0; i < n; i++) {
+        struct entry *e = r[i];
+        free(e->key);
+        free(e->value);
+        free(e);
+    }
+
+    num_entries = n;
+    return cc_ok(NULL);
+}
+
+static int count_entry(const struct cc_event *ev, void *userp) {
+    (void) userp;
+    if(ev->type == CC_EVENT_EXIT && strcmp(ev->rule, "entry") == 0)
+        num_entries++;
+    return 0;
+}
+
+static char *generate_input(void) {
+    char *input = alloc_input(NUM_ENTRIES * 32 + 1);
+
+    size_t len = 0;
+    unsigned seed = 1;
+    for(int i = 0; i < NUM_ENTRIES; i++) {
+        next_random(&seed);
+        if(seed & 0x10000)
+            len += sprintf(input + len, "key%c%c=%u\n", 'a' + seed % 26, 'a' + (seed >> 8) % 26, seed >> 12);
+        else
+            len += sprintf(input + len, "name%c=value%c\n", 'a' + seed % 26, 'a' + (seed >> 8) % 26);
+    }
+
+    input[len] = '\0';
+    return input;
+}
+
+int main(void) {
+    struct cc_error *e = NULL;
+    struct cc_grammar *g = cc_bnf(u8""
+        "doc = @list{ entry };\n"
+        "entry = @entry: key, '=', value, '\\n';\n"
+        "key = @concat: @isalpha, @concat{ @isalpha | @isdigit };\n"
+        "value = @concat: @isdigit, @concat{ @isdigit } | key;\n",
+        CC_ACTIONS(
+            cc_action_match("isalpha", cc_is_alpha),
+            cc_action_match("isdigit", cc_is_digit),
+            cc_action_fold("concat", cc_fold_concat),
+            cc_action_fold("entry", make_entry),
+            cc_action_fold("list", make_list)
+        ), &e);
+    if(!g) {
+        fprintf(stderr, "compiling the grammar failed\n");
+        return EXIT_FAILURE;
+    }
+
+    char *input = generate_input();
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+    struct cc_parser *p = cc_seq(cc_fold_first, cc_grammar_link(g, "doc"), cc_eof());
+
+    // the events run first, since the peak memory of the process only grows
+    long base = peak_memory();
+    double start = now();
+    if(cc_parse_events(src, cc_retain(p), count_entry, NULL, NULL) != CC_MATCH) {
+        fprintf(stderr, "parsing failed\n");
+        return EXIT_FAILURE;
+    }
+
+    double events_time = now() - start;
+    long events_memory = peak_memory() - base;
+    size_t events_entries = num_entries;
+
+    struct cc_result r;
+    start = now();
+    if(cc_parse(src, cc_retain(p), &r) || r.err) {
+        fprintf(stderr, "parsing failed\n");
+        return EXIT_FAILURE;
+    }
+
+    double tree_time = now() - start;
+    long tree_memory = peak_memory() - base;
+
+    if(events_entries != num_entries) {
+        fprintf(stderr, "%zu entry events instead of %zu entries\n", events_entries, num_entries);
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu entries, %zu bytes\n", num_entries, strlen(input));
+    printf("mode   | time (ms) | peak memory (KiB)\n");
+    printf("tree   | %9.3f | %17ld\n", tree_time * 1e3, tree_memory);
+    printf("events | %9.3f | %17ld (%.2fx)\n", events_time * 1e3, events_memory, tree_time / events_time);
+
+    cc_close(src);
+    free(input);
+    cc_release(p);
+    cc_grammar_free(g);
+    return EXIT_SUCCESS;
+}
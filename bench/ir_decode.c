@@ -0,0 +1,135 @@
+// Micro-benchmark comparing the IR operand decoding of the former packed, big-endian
+// encoding (byte-wise reads) with the current aligned, native-width encoding.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "internal.h"
+
+#define ITERATIONS 20000
+
+static bool has_u32_operand(uint8_t opcode) {
+    switch(opcode) {
+    case IR_PUSH:
+    case IR_JUMP:
+    case IR_JUMP_IF_NONZERO:
+    case IR_JUMP_IF_SUCCESS:
+    case IR_JUMP_IF_FAILURE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// re-encode the compiled IR in the old packed format
+static size_t legacy_encode(const struct cc_ir *ir, uint8_t *out, size_t *instructions) {
+    size_t n = 0;
+    for(uint32_t ip = 0; ip < ir->count; (*instructions)++) {
+        uint8_t opcode = out[n++] = ir->bytes[ip++];
+
+        if(has_u32_operand(opcode)) {
+            ip = IR_ALIGN(ip, uint32_t);
+            uint32_t v = ir_read_u32(ir, ip);
+            ip += sizeof(uint32_t);
+            for(int i = sizeof(uint32_t) - 1; i >= 0; i--)
+                out[n++] = (v >> (i * 8)) & 0xff;
+        }
+        else if(opcode == IR_CALL) {
+            ip = IR_ALIGN(ip, uintptr_t);
+            uintptr_t v = ir_read_ptr(ir, ip);
+            ip += sizeof(uintptr_t);
+            for(int i = sizeof(uintptr_t) - 1; i >= 0; i--)
+                out[n++] = (v >> (i * 8)) & 0xff;
+        }
+    }
+    return n;
+}
+
+static uintptr_t legacy_decode(const uint8_t *bytes, size_t count) {
+    uintptr_t sum = 0;
+    for(size_t ip = 0; ip < count;) {
+        uint8_t opcode = bytes[ip++];
+
+        if(has_u32_operand(opcode)) {
+            uint32_t c = 0;
+            for(unsigned i = 0; i < sizeof(uint32_t); i++)
+                c |= (uint32_t) bytes[ip + i] << ((sizeof(uint32_t) - i - 1) * 8);
+            ip += sizeof(uint32_t);
+            sum += c;
+        }
+        else if(opcode == IR_CALL) {
+            uintptr_t c = 0;
+            for(unsigned i = 0; i < sizeof(uintptr_t); i++)
+                c |= (uintptr_t) bytes[ip + i] << ((sizeof(uintptr_t) - i - 1) * 8);
+            ip += sizeof(uintptr_t);
+            sum += c;
+        }
+        else
+            sum += opcode;
+    }
+    return sum;
+}
+
+static uintptr_t aligned_decode(const struct cc_ir *ir) {
+    uintptr_t sum = 0;
+    for(uint32_t ip = 0; ip < ir->count;) {
+        uint8_t opcode = ir->bytes[ip++];
+
+        if(has_u32_operand(opcode)) {
+            ip = IR_ALIGN(ip, uint32_t);
+            sum += ir_read_u32(ir, ip);
+            ip += sizeof(uint32_t);
+        }
+        else if(opcode == IR_CALL) {
+            ip = IR_ALIGN(ip, uintptr_t);
+            sum += ir_read_ptr(ir, ip);
+            ip += sizeof(uintptr_t);
+        }
+        else
+            sum += opcode;
+    }
+    return sum;
+}
+
+int main(void) {
+    // a sequence over many combinators gives a long, CALL- and JUMP-heavy IR sequence
+    struct cc_parser *inner[64];
+    for(unsigned i = 0; i < LEN(inner); i++)
+        inner[i] = cc_maybe(cc_char('a' + i % 26));
+
+    struct cc_parser *p = cc_andv(LEN(inner), cc_fold_concat, inner);
+    if(!p || cc_compile(p)) {
+        fprintf(stderr, "failed compiling benchmark parser\n");
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *legacy = malloc(p->ir->count * 2);
+    size_t instructions = 0;
+    size_t legacy_count = legacy_encode(p->ir, legacy, &instructions);
+
+    volatile uintptr_t sink = 0;
+
+    double start = now();
+    for(unsigned i = 0; i < ITERATIONS; i++)
+        sink += legacy_decode(legacy, legacy_count);
+    double legacy_time = now() - start;
+
+    start = now();
+    for(unsigned i = 0; i < ITERATIONS; i++)
+        sink += aligned_decode(p->ir);
+    double aligned_time = now() - start;
+
+    double total = (double) instructions * ITERATIONS;
+
+    printf("ir size:  %zu instructions, %zu bytes packed, %u bytes aligned\n", instructions, legacy_count, p->ir->count);
+    printf("packed:   %8.3f ms (%.2f ns/instruction)\n", legacy_time * 1e3, legacy_time * 1e9 / total);
+    printf("aligned:  %8.3f ms (%.2f ns/instruction)\n", aligned_time * 1e3, aligned_time * 1e9 / total);
+    printf("speedup:  %.2fx\n", legacy_time / aligned_time);
+
+    free(legacy);
+    cc_release(p);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// Benchmark of resolving the references between the rules of a grammar once with `cc_grammar_link`:
+//
+//     e0 = e1, { "<0>", e1 };
+//     e1 = e2, { "<1>", e2 };
+//     ...
+//     e199 = @isdigit;
+//
+// every digit is parsed through all 200 rules. `cc_rule` looks each of them up by name while parsing,
+// `cc_grammar_link` calls them directly.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_RULES 200
+#define NUM_OPERANDS 5000
+
+static char *generate_grammar(void) {
+    char *bnf = alloc_input(NUM_RULES * 64);
+
+    size_t len = 0;
+    for(int i = 0; i < NUM_RULES - 1; i++)
+        len += sprintf(bnf + len, "e%d = @null: e%d, @null{ @null: \"<%d>\", e%d };\n", i, i + 1, i, i + 1);
+    sprintf(bnf + len, "e%d = @isdigit;\n", NUM_RULES - 1);
+
+    return bnf;
+}
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_OPERANDS * 8 + 1);
+
+    size_t len = 0;
+    unsigned seed = 1;
+    for(int i = 0; i < NUM_OPERANDS; i++) {
+        next_random(&seed);
+        if(i > 0)
+            len += sprintf(input + len, "<%u>", (seed >> 8) % NUM_RULES / 2);
+        input[len++] = '0' + (seed >> 16) % 10;
+    }
+
+    input[len] = '\0';
+    *size = len;
+    return input;
+}
+
+static double measure(struct cc_source *src, struct cc_parser *p) {
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    cc_release(p);
+    return best;
+}
+
+int main(void) {
+    char *bnf = generate_grammar();
+
+    struct cc_error *e = NULL;
+    struct cc_grammar *g = cc_bnf((const char8_t*) bnf, CC_ACTIONS(
+        cc_action_match("isdigit", cc_is_digit),
+        cc_action_fold("null", cc_fold_null)
+    ), &e);
+    if(!g) {
+        fprintf(stderr, "compiling the grammar failed\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    char *input = generate_input(&size);
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+
+    double by_name = measure(src, cc_rule(g, "e0"));
+    double linked = measure(src, cc_grammar_link(g, "e0"));
+
+    printf("%d rules, %d operands, %zu bytes\n", NUM_RULES, NUM_OPERANDS, size);
+    printf("cc_rule:         %.3f ms\n", by_name * 1e3);
+    printf("cc_grammar_link: %.3f ms (%.2fx)\n", linked * 1e3, by_name / linked);
+
+    cc_close(src);
+    cc_grammar_free(g);
+    free(input);
+    free(bnf);
+    return EXIT_SUCCESS;
+}
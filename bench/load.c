@@ -0,0 +1,90 @@
+// Benchmark of loading a grammar saved with `cc_grammar_save` instead of building it from its BNF source:
+//
+//     stmt0 = "let0", ident, '=', expr0, ';' | "print0", expr0, ';';
+//     expr0 = term0, { ('+' | '-'), term0 };
+//     term0 = @isdigit, { @isdigit } | ident | '(', expr0, ')';
+//     ...
+//
+// `cc_bnf` runs the combinator-based BNF parser, `cc_grammar_load` maps the saved file and rebuilds the parsers from it directly.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_RUNS 20
+#include "bench.h"
+
+#define NUM_GROUPS 64
+
+static char *generate_grammar(void) {
+    char *bnf = alloc_input(NUM_GROUPS * 256 + 128);
+
+    size_t len = sprintf(bnf, "ident = @concat: @isalpha, @concat{ @isalpha | @isdigit | '_' };\n");
+    for(int i = 0; i < NUM_GROUPS; i++) {
+        len += sprintf(bnf + len,
+            "stmt%d = \"let%d\", ident, '=', expr%d, ';' | \"print%d\", expr%d, ';';\n"
+            "expr%d = term%d, { ('+' | '-'), term%d };\n"
+            "term%d = @isdigit, { @isdigit } | ident | '(', expr%d, ')';\n",
+            i, i, i, i, i, i, i, i, i, i);
+    }
+
+    return bnf;
+}
+
+int main(void) {
+    struct cc_action *actions = CC_ACTIONS(
+        cc_action_match("isalpha", cc_is_alpha),
+        cc_action_match("isdigit", cc_is_digit),
+        cc_action_fold("concat", cc_fold_concat)
+    );
+
+    char *bnf = generate_grammar();
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/ccombinator-load-%d.ccg", (int) getpid());
+
+    double best_bnf = 0.0, best_load = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_error *e = NULL;
+        double start = now();
+        struct cc_grammar *g = cc_bnf((const char8_t*) bnf, actions, &e);
+        double time = now() - start;
+
+        if(!g) {
+            fprintf(stderr, "compiling the grammar failed\n");
+            return EXIT_FAILURE;
+        }
+
+        if(i == 0 && cc_grammar_save(g, path)) {
+            fprintf(stderr, "saving the grammar failed\n");
+            return EXIT_FAILURE;
+        }
+
+        cc_grammar_free(g);
+        keep_best(&best_bnf, i, time);
+    }
+
+    for(int i = 0; i < NUM_RUNS; i++) {
+        double start = now();
+        struct cc_grammar *g = cc_grammar_load(path, actions);
+        double time = now() - start;
+
+        if(!g) {
+            fprintf(stderr, "loading the grammar failed\n");
+            return EXIT_FAILURE;
+        }
+
+        cc_grammar_free(g);
+        keep_best(&best_load, i, time);
+    }
+
+    printf("%d rules, %zu bytes of BNF\n", 3 * NUM_GROUPS + 1, strlen(bnf));
+    printf("cc_bnf:          %.3f ms\n", best_bnf * 1e3);
+    printf("cc_grammar_load: %.3f ms (%.1fx)\n", best_load * 1e3, best_bnf / best_load);
+
+    unlink(path);
+    free(bnf);
+    return EXIT_SUCCESS;
+}
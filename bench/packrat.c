@@ -0,0 +1,65 @@
+// Benchmark of a grammar with exponential backtracking, with and without memoization:
+//
+//     expr = term '+' expr | term '-' expr | term
+//     term = '(' expr ')' | digit
+//
+// every `expr` tries `term` up to three times at the same position,
+// so nested parentheses take O(3^n) steps without memoization and O(n) with it.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define MAX_DEPTH 12
+
+static struct cc_parser *expr(struct cc_parser *self, void *memo) {
+    struct cc_parser *term = cc_or(2, cc_and(3, NULL, cc_char('('), self, cc_char(')')), cc_digit());
+    if(memo)
+        term = cc_memo(term);
+
+    return cc_or(3,
+        cc_and(3, NULL, cc_retain(term), cc_char('+'), cc_retain(self)),
+        cc_and(3, NULL, cc_retain(term), cc_char('-'), cc_retain(self)),
+        term
+    );
+}
+
+static double run(const char *input, bool memo, int flags) {
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+    struct cc_parser *p = cc_and(2, NULL, cc_fix(expr, memo ? &memo : NULL), cc_eof());
+
+    struct cc_result r;
+    double start = now();
+    int err = cc_parse_with(src, p, &r, flags);
+    double time = now() - start;
+
+    if(err || r.err) {
+        fprintf(stderr, "parsing failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    cc_close(src);
+    return time;
+}
+
+int main(void) {
+    char input[2 * MAX_DEPTH + 2];
+
+    printf("depth | no memo (ms) | cc_memo (ms) | CC_PARSE_MEMOIZE (ms)\n");
+    for(int depth = 2; depth <= MAX_DEPTH; depth += 2) {
+        memset(input, '(', depth);
+        input[depth] = '1';
+        memset(input + depth + 1, ')', depth);
+        input[2 * depth + 1] = '\0';
+
+        printf("%5d | %12.3f | %12.3f | %21.3f\n", depth,
+            run(input, false, CC_PARSE_DEFAULT) * 1e3,
+            run(input, true, CC_PARSE_DEFAULT) * 1e3,
+            run(input, false, CC_PARSE_MEMOIZE) * 1e3);
+    }
+
+    return EXIT_SUCCESS;
+}
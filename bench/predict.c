@@ -0,0 +1,85 @@
+// Benchmark of predictive dispatch in `cc_or` on a keyword-heavy grammar:
+//
+//     stmt = "break" ';' | "case" ident ';' | ... | "while" ident ';'
+//
+// every statement starts with a keyword, so only the variants starting with the same letter are tried.
+// build the library with `-DCC_NO_PREDICTION` to compare against trying every variant in order.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_STATEMENTS 200000
+
+static const char *keywords[] = {
+    "break", "case", "const", "continue", "default", "do", "else", "enum",
+    "extern", "for", "goto", "if", "return", "static", "switch", "while",
+};
+
+#define NUM_KEYWORDS (sizeof(keywords) / sizeof(*keywords))
+
+static struct cc_parser *statement(void) {
+    struct cc_parser *ws = cc_many(NULL, cc_whitespace());
+    struct cc_parser *ident = cc_noreturn(cc_least(1, NULL, cc_alpha()));
+
+    struct cc_parser **variants = calloc(NUM_KEYWORDS, sizeof(struct cc_parser*));
+    if(!variants)
+        exit(EXIT_FAILURE);
+
+    for(size_t i = 0; i < NUM_KEYWORDS; i++) {
+        variants[i] = cc_and(5, NULL,
+            cc_noreturn(cc_string((const char8_t*) keywords[i])),
+            cc_retain(ws), cc_retain(ident), cc_noreturn(cc_char(';')), cc_retain(ws));
+    }
+
+    cc_release(ws);
+    cc_release(ident);
+    return cc_free_data(cc_orv(NUM_KEYWORDS, variants));
+}
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_STATEMENTS * 16 + 1);
+
+    size_t len = 0;
+    unsigned seed = 1;
+    for(int i = 0; i < NUM_STATEMENTS; i++) {
+        next_random(&seed);
+        len += sprintf(input + len, "%s x;\n", keywords[(seed >> 8) % NUM_KEYWORDS]);
+    }
+
+    *size = len;
+    return input;
+}
+
+int main(void) {
+    size_t size;
+    char *input = generate_input(&size);
+
+    struct cc_parser *p = cc_freeze(cc_and(2, NULL, cc_many(NULL, statement()), cc_eof()));
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            return EXIT_FAILURE;
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    printf("%d statements, %zu bytes: %.3f ms (%.1f MiB/s)\n", NUM_STATEMENTS, size, best * 1e3, size / best / (1 << 20));
+
+    cc_release(p);
+    cc_close(src);
+    free(input);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+// Benchmark of `cc_many_reduce` against folding all results of `cc_many` at once:
+//
+//     lines = { number, '\n' };
+//
+// the numbers are read from a streaming source and summed up, so the input itself is never held in memory.
+// `cc_many` keeps a lazy result for every line until the end, `cc_many_reduce` adds each number right away.
+
+#include <ccombinator.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_LINES 2000000
+
+struct generator {
+    unsigned line;
+    char pending[16];
+    size_t pending_len, pending_off;
+};
+
+static int generate(void *userp, char8_t *buf, size_t n, size_t *nread) {
+    struct generator *g = userp;
+
+    size_t len = 0;
+    while(len < n) {
+        if(g->pending_off == g->pending_len) {
+            if(g->line == NUM_LINES)
+                break;
+
+            g->pending_len = sprintf(g->pending, "%u\n", g->line++ % 1000);
+            g->pending_off = 0;
+        }
+
+        size_t chunk = g->pending_len - g->pending_off;
+        if(chunk > n - len)
+            chunk = n - len;
+        memcpy(buf + len, g->pending + g->pending_off, chunk);
+        g->pending_off += chunk;
+        len += chunk;
+    }
+
+    *nread = len;
+    return 0;
+}
+
+static uintptr_t number_value(void *span) {
+    uintptr_t n = 0;
+    for(size_t i = 0; i < ((struct cc_span*) span)->len; i++)
+        n = n * 10 + (((struct cc_span*) span)->ptr[i] - '0');
+
+    free(span);
+    return n;
+}
+
+static struct cc_result sum_all(size_t n, void **r) {
+    uintptr_t sum = 0;
+    for(size_t i = 0; i < n; i++)
+        sum += number_value(r[i]);
+
+    return cc_ok((void*) sum);
+}
+
+static struct cc_result sum_init(void) {
+    return cc_ok(NULL);
+}
+
+static struct cc_result sum_step(void *acc, void *x) {
+    return cc_ok((void*) ((uintptr_t) acc + number_value(x)));
+}
+
+static struct cc_parser *line(void) {
+    return cc_seq(cc_fold_first, cc_capture(cc_least(1, NULL, cc_digit())), cc_char('\n'));
+}
+
+static double run(struct cc_parser *p, uintptr_t *sum) {
+    struct generator g = {0};
+    struct cc_source *src = cc_stream_source(generate, &g);
+    if(!src)
+        exit(EXIT_FAILURE);
+
+    struct cc_result r;
+    double start = now();
+    int err = cc_parse(src, cc_seq(cc_fold_first, p, cc_eof()), &r);
+    double time = now() - start;
+
+    if(err || r.err) {
+        fprintf(stderr, "parsing failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    cc_close(src);
+    *sum = (uintptr_t) r.out;
+    return time;
+}
+
+int main(void) {
+    uintptr_t reduced, folded;
+
+    // the reduce runs first, since the peak memory of the process only grows
+    long base = peak_memory();
+    double reduce_time = run(cc_many_reduce(sum_init, sum_step, line()), &reduced);
+    long reduce_memory = peak_memory() - base;
+
+    double many_time = run(cc_many(sum_all, line()), &folded);
+    long many_memory = peak_memory() - base;
+
+    if(reduced != folded) {
+        fprintf(stderr, "cc_many_reduce summed up %zu instead of %zu\n", (size_t) reduced, (size_t) folded);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d lines, sum %zu\n", NUM_LINES, (size_t) reduced);
+    printf("combinator     | time (ms) | peak memory (KiB)\n");
+    printf("cc_many        | %9.3f | %17ld\n", many_time * 1e3, many_memory);
+    printf("cc_many_reduce | %9.3f | %17ld\n", reduce_time * 1e3, reduce_memory);
+    return EXIT_SUCCESS;
+}
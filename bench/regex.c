@@ -0,0 +1,77 @@
+// Benchmark of a regular expression prone to catastrophic backtracking:
+//
+//     (a*b|a)*c
+//
+// on inputs of n 'a's followed by a 'c', every repetition first scans the remaining 'a's looking for a 'b',
+// which takes quadratic time when backtracking. the dfa backend (`CC_REGEX_DFA`) matches in linear time.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_RUNS 3
+#include "bench.h"
+
+#define PATTERN u8"(a*b|a)*c"
+#define MIN_SIZE 1000
+#define MAX_SIZE 8000
+
+static double measure(struct cc_parser *p, const char *input) {
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+    if(!src)
+        exit(EXIT_FAILURE);
+
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        free(r.out);
+
+        keep_best(&best, i, time);
+    }
+
+    cc_close(src);
+    return best;
+}
+
+int main(void) {
+    struct cc_error *e = NULL;
+    struct cc_parser *backtracking = cc_regex_with(PATTERN, CC_REGEX_DEFAULT, &e);
+    struct cc_parser *dfa = backtracking && !e ? cc_regex_with(PATTERN, CC_REGEX_DFA, &e) : NULL;
+    if(!dfa || e) {
+        fprintf(stderr, "compiling \"%s\" failed\n", PATTERN);
+        return EXIT_FAILURE;
+    }
+
+    backtracking = cc_freeze(backtracking);
+    dfa = cc_freeze(dfa);
+
+    char *input = malloc(MAX_SIZE + 2);
+    if(!input)
+        return EXIT_FAILURE;
+
+    printf("%s\n", PATTERN);
+    for(size_t n = MIN_SIZE; n <= MAX_SIZE; n *= 2) {
+        memset(input, 'a', n);
+        input[n] = 'c';
+        input[n + 1] = '\0';
+
+        double b = measure(backtracking, input);
+        double d = measure(dfa, input);
+        printf("%6zu bytes: backtracking %9.3f ms, dfa %6.3f ms (%.0fx)\n", n + 1, b * 1e3, d * 1e3, b / d);
+    }
+
+    cc_release(backtracking);
+    cc_release(dfa);
+    free(input);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+// Benchmark of scanning runs of character classes in `cc_many` on whitespace-heavy input:
+//
+//     file = { ws ident } ws
+//
+// the whitespace and identifier runs are not returned, so they are skipped over in blocks.
+// build the library with `-DCC_NO_SCAN` to compare against matching one character per iteration.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_WORDS 200000
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_WORDS * 64 + 1);
+
+    size_t len = 0;
+    unsigned seed = 1;
+    for(int i = 0; i < NUM_WORDS; i++) {
+        next_random(&seed);
+        unsigned indent = (seed >> 8) % 24, word = 4 + (seed >> 16) % 28;
+
+        memset(input + len, ' ', indent);
+        len += indent;
+        for(unsigned j = 0; j < word; j++)
+            input[len++] = "abcdefghijklmnopqrstuvwxyz_0123456789"[(seed + j * 7) % 37];
+        input[len++] = i % 4 == 3 ? '\n' : '\t';
+    }
+
+    input[len] = '\0';
+    *size = len;
+    return input;
+}
+
+int main(void) {
+    size_t size;
+    char *input = generate_input(&size);
+
+    struct cc_parser *ws = cc_noreturn(cc_many(NULL, cc_whitespace()));
+    struct cc_parser *ident = cc_capture(cc_least(1, NULL, cc_anyof(U"abcdefghijklmnopqrstuvwxyz_0123456789")));
+    struct cc_parser *p = cc_freeze(cc_and(3, NULL,
+        cc_many(NULL, cc_seq(cc_fold_last, cc_retain(ws), ident)), ws, cc_eof()));
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+
+    double best = 0.0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        struct cc_result r;
+        double start = now();
+        int err = cc_parse(src, cc_retain(p), &r);
+        double time = now() - start;
+
+        if(err || r.err) {
+            fprintf(stderr, "parsing failed\n");
+            return EXIT_FAILURE;
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    printf("%d words, %zu bytes: %.3f ms (%.1f MiB/s)\n", NUM_WORDS, size, best * 1e3, size / best / (1 << 20));
+
+    cc_release(p);
+    cc_close(src);
+    free(input);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+// Benchmark of searching a log for all matches of regular expressions with `cc_regex_findall`:
+//
+//     timeout after [0-9]+ ms            (every match starts with a literal)
+//     (volume|drive)-[0-9]: disk full    (every match contains a literal at most 9 bytes in)
+//
+// only the positions near the occurrences of the literals are tried instead of every position.
+// build the library with `-DCC_NO_SCAN` to compare against trying the positions one by one.
+
+#include <ccombinator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NUM_LINES 400000
+
+static char *generate_input(size_t *size) {
+    char *input = alloc_input(NUM_LINES * 96 + 1);
+
+    size_t len = 0;
+    for(int i = 0; i < NUM_LINES; i++) {
+        if(i % 1000 == 7)
+            len += sprintf(input + len, "2024-05-17 12:%02d:%02d ERROR worker-%d connection timeout after %d ms\n", i / 60 % 60, i % 60, i % 32, i % 5000);
+        else if(i % 1000 == 500)
+            len += sprintf(input + len, "2024-05-17 12:%02d:%02d ERROR volume-%d: disk full\n", i / 60 % 60, i % 60, i % 8);
+        else
+            len += sprintf(input + len, "2024-05-17 12:%02d:%02d INFO worker-%d request %d handled in %d ms\n", i / 60 % 60, i % 60, i % 32, i, i % 97);
+    }
+
+    *size = len;
+    return input;
+}
+
+static int count_match(const struct cc_span *, void *userp) {
+    (*(size_t*) userp)++;
+    return 0;
+}
+
+static void measure(struct cc_source *src, const char8_t *pattern, size_t size) {
+    struct cc_error *e = NULL;
+    struct cc_parser *re = cc_regex_with(pattern, CC_REGEX_DFA, &e);
+    if(!re || e) {
+        fprintf(stderr, "compiling \"%s\" failed\n", pattern);
+        exit(EXIT_FAILURE);
+    }
+
+    double best = 0.0;
+    size_t count = 0;
+    for(int i = 0; i < NUM_RUNS; i++) {
+        count = 0;
+        double start = now();
+        int err = cc_regex_findall(src, cc_retain(re), count_match, &count);
+        double time = now() - start;
+
+        if(err) {
+            fprintf(stderr, "searching failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        keep_best(&best, i, time);
+    }
+
+    printf("%-34s %zu matches: %.3f ms (%.1f MiB/s)\n", (const char*) pattern, count, best * 1e3, size / best / (1 << 20));
+    cc_release(re);
+}
+
+int main(void) {
+    size_t size;
+    char *input = generate_input(&size);
+    struct cc_source *src = cc_string_source((const char8_t*) input);
+
+    printf("%d lines, %zu bytes\n", NUM_LINES, size);
+    measure(src, u8"timeout after [0-9]+ ms", size);
+    measure(src, u8"(volume|drive)-[0-9]: disk full", size);
+
+    cc_close(src);
+    free(input);
+    return EXIT_SUCCESS;
+}
@@ -495,6 +495,10 @@ static int action_table_init(struct cc_hashtable *t, const struct cc_action acti
     size_t count;
     for(count = 0; actions[count].type != CC_ACTION_NULL; count++);
 
+    // an empty list is the same as no actions at all
+    if(count == 0)
+        return 0;
+
     int err;
     if((err = hashtable_init(t, count * 2)))
         return err;
@@ -526,7 +530,7 @@ struct cc_grammar *cc_bnf_from(const struct cc_source *bnf_source, const struct
     }
 
     struct cc_hashtable action_table;
-    if((errno = action_table_init(&action_table, actions))) {
+    if((errno = grammar_set_actions(g, actions)) || (errno = action_table_init(&action_table, actions))) {
         cc_release(bnf);
         cc_grammar_free(g);
         return NULL;
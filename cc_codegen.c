@@ -0,0 +1,1248 @@
+#include <ccombinator.h>
+
+#include "internal.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+// C code generation:
+//
+// every combinator becomes a function `p<index>` doing what the ir sequence `cc_compile` generates for it does,
+// with labels and gotos for its jumps. terminals are matched inline wherever they are called.
+// the generated code keeps the same state as the interpreter (NORETURN and NOERROR flags, expected items)
+// and builds the same result tree, which is only evaluated after the parse succeeded.
+
+// support code put in front of every generated parser
+static const char *const runtime[] = {
+    "#include <ccombinator.h>\n",
+    "\n",
+    "#include <errno.h>\n",
+    "#include <stdbool.h>\n",
+    "#include <stdint.h>\n",
+    "#include <stdlib.h>\n",
+    "#include <string.h>\n",
+    "\n",
+    "enum {\n",
+    "    GEN_NULL,\n",
+    "    GEN_VALUE,\n",
+    "    GEN_CHAR,\n",
+    "    GEN_TEXT,\n",
+    "    GEN_SPAN,\n",
+    "    GEN_LOCATION,\n",
+    "    GEN_LIFT,\n",
+    "    GEN_FOLD,\n",
+    "    GEN_APPLY,\n",
+    "};\n",
+    "\n",
+    "// results are evaluated once the parse succeeded, nodes of failed alternatives are discarded without calling any functions\n",
+    "struct gen_node {\n",
+    "    int type;\n",
+    "    size_t at; // byte offset the node was created at, for error locations\n",
+    "    union {\n",
+    "        void *value;\n",
+    "        char32_t ch;\n",
+    "        cc_lift_t lift;\n",
+    "        cc_fold_t fold;\n",
+    "        cc_apply_t apply;\n",
+    "    };\n",
+    "    size_t a, b; // text and spans: start and length, folds: first child and count, applications: inner node\n",
+    "};\n",
+    "\n",
+    "struct gen_stack {\n",
+    "    size_t *items;\n",
+    "    size_t count;\n",
+    "    size_t capacity;\n",
+    "};\n",
+    "\n",
+    "struct gen_class {\n",
+    "    uint32_t ascii[4];\n",
+    "    size_t n;\n",
+    "    const char32_t (*ranges)[2];\n",
+    "};\n",
+    "\n",
+    "struct gen_state {\n",
+    "    const char8_t *in;\n",
+    "    size_t size;\n",
+    "    size_t pos;\n",
+    "\n",
+    "    bool noreturn;\n",
+    "    bool noerror;\n",
+    "\n",
+    "    // node 0 is the NULL result\n",
+    "    struct gen_node *nodes;\n",
+    "    size_t n_nodes;\n",
+    "    size_t c_nodes;\n",
+    "\n",
+    "    struct gen_stack results;\n",
+    "    struct gen_stack children;\n",
+    "\n",
+    "    void **values;\n",
+    "    size_t n_values;\n",
+    "    size_t c_values;\n",
+    "\n",
+    "    struct cc_location line; // last resolved location\n",
+    "    struct cc_error err;\n",
+    "};\n",
+    "\n",
+    "struct gen_mark {\n",
+    "    size_t pos;\n",
+    "    size_t nodes;\n",
+    "    size_t children;\n",
+    "};\n",
+    "\n",
+    "static inline struct gen_mark gen_save(const struct gen_state *s) {\n",
+    "    return (struct gen_mark){s->pos, s->n_nodes, s->children.count};\n",
+    "}\n",
+    "\n",
+    "static inline void gen_restore(struct gen_state *s, struct gen_mark m) {\n",
+    "    s->pos = m.pos;\n",
+    "    s->n_nodes = m.nodes;\n",
+    "    s->children.count = m.children;\n",
+    "}\n",
+    "\n",
+    "static inline char32_t gen_peek(const struct gen_state *s) {\n",
+    "    if(s->pos >= s->size)\n",
+    "        return (char32_t) EOF;\n",
+    "\n",
+    "    const char8_t *p = s->in + s->pos;\n",
+    "    uint32_t k = __builtin_clz(~((uint32_t) p[0] << 24));\n",
+    "    char32_t value = p[0] & ((1u << (8 - k)) - 1);\n",
+    "\n",
+    "    for(uint32_t i = 1; i < k && s->pos + i < s->size && (p[i] & 0xc0) == 0x80; i++)\n",
+    "        value = (value << 6) | (p[i] & 0x3f);\n",
+    "\n",
+    "    return value;\n",
+    "}\n",
+    "\n",
+    "static inline size_t gen_cp_length(char32_t cp) {\n",
+    "    return 1u + (cp >= 0x80) + (cp >= 0x800) + (cp >= 0x10000);\n",
+    "}\n",
+    "\n",
+    "static inline void gen_advance(struct gen_state *s, char32_t cp) {\n",
+    "    s->pos += gen_cp_length(cp);\n",
+    "    if(s->pos > s->size)\n",
+    "        s->pos = s->size; // truncated character at the end of the input\n",
+    "}\n",
+    "\n",
+    "static inline bool gen_class_has(const struct gen_class *c, char32_t cp) {\n",
+    "    if(cp < 0x80)\n",
+    "        return !!(c->ascii[cp / 32] & (1u << (cp % 32)));\n",
+    "\n",
+    "    size_t lo = 0, hi = c->n;\n",
+    "    while(lo < hi) {\n",
+    "        size_t mid = lo + (hi - lo) / 2;\n",
+    "        if(cp < c->ranges[mid][0])\n",
+    "            hi = mid;\n",
+    "        else if(cp > c->ranges[mid][1])\n",
+    "            lo = mid + 1;\n",
+    "        else\n",
+    "            return true;\n",
+    "    }\n",
+    "\n",
+    "    return false;\n",
+    "}\n",
+    "\n",
+    "static inline int gen_push(struct gen_stack *st, size_t item) {\n",
+    "    if(st->count >= st->capacity) {\n",
+    "        size_t capacity = st->capacity ? st->capacity * 2 : 256;\n",
+    "        size_t *items = realloc(st->items, capacity * sizeof(size_t));\n",
+    "        if(!items)\n",
+    "            return -ENOMEM;\n",
+    "\n",
+    "        st->items = items;\n",
+    "        st->capacity = capacity;\n",
+    "    }\n",
+    "\n",
+    "    st->items[st->count++] = item;\n",
+    "    return 0;\n",
+    "}\n",
+    "\n",
+    "// returns the index of a new node, `0` if no memory is left\n",
+    "static inline size_t gen_node(struct gen_state *s, int type) {\n",
+    "    if(s->n_nodes >= s->c_nodes) {\n",
+    "        size_t capacity = s->c_nodes ? s->c_nodes * 2 : 256;\n",
+    "        struct gen_node *nodes = realloc(s->nodes, capacity * sizeof(struct gen_node));\n",
+    "        if(!nodes)\n",
+    "            return 0;\n",
+    "\n",
+    "        s->nodes = nodes;\n",
+    "        s->c_nodes = capacity;\n",
+    "    }\n",
+    "\n",
+    "    s->nodes[s->n_nodes] = (struct gen_node){.type = type, .at = s->pos};\n",
+    "    return s->n_nodes++;\n",
+    "}\n",
+    "\n",
+    "// pushes the result of a successful parser, returns `1` or a negative ERRNO value\n",
+    "static inline int gen_result(struct gen_state *s, size_t node) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "    return gen_push(&s->results, node) ? -ENOMEM : 1;\n",
+    "}\n",
+    "\n",
+    "static inline int gen_char(struct gen_state *s, char32_t ch) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_CHAR);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->nodes[node].ch = ch;\n",
+    "    return gen_result(s, node);\n",
+    "}\n",
+    "\n",
+    "static inline int gen_text(struct gen_state *s, int type, size_t start) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, type);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->nodes[node].a = start;\n",
+    "    s->nodes[node].b = s->pos - start;\n",
+    "    return gen_result(s, node);\n",
+    "}\n",
+    "\n",
+    "static inline int gen_value(struct gen_state *s, void *value) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_VALUE);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->nodes[node].value = value;\n",
+    "    return gen_result(s, node);\n",
+    "}\n",
+    "\n",
+    "static inline int gen_lift(struct gen_state *s, cc_lift_t lift) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_LIFT);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->nodes[node].lift = lift;\n",
+    "    return gen_result(s, node);\n",
+    "}\n",
+    "\n",
+    "static inline int gen_location(struct gen_state *s) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_LOCATION);\n",
+    "    return node ? gen_result(s, node) : -ENOMEM;\n",
+    "}\n",
+    "\n",
+    "// folds the top `n` results into one\n",
+    "static inline int gen_fold(struct gen_state *s, cc_fold_t fold, size_t n) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_FOLD);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->results.count -= n;\n",
+    "    s->nodes[node].fold = fold;\n",
+    "    s->nodes[node].a = s->children.count;\n",
+    "    s->nodes[node].b = n;\n",
+    "\n",
+    "    for(size_t i = 0; i < n; i++) {\n",
+    "        if(gen_push(&s->children, s->results.items[s->results.count + i]))\n",
+    "            return -ENOMEM;\n",
+    "    }\n",
+    "\n",
+    "    return gen_result(s, node);\n",
+    "}\n",
+    "\n",
+    "static inline int gen_apply(struct gen_state *s, cc_apply_t apply) {\n",
+    "    if(s->noreturn)\n",
+    "        return 1;\n",
+    "\n",
+    "    size_t node = gen_node(s, GEN_APPLY);\n",
+    "    if(!node)\n",
+    "        return -ENOMEM;\n",
+    "\n",
+    "    s->nodes[node].apply = apply;\n",
+    "    s->nodes[node].a = s->results.items[s->results.count - 1];\n",
+    "    s->results.items[s->results.count - 1] = node;\n",
+    "    return 1;\n",
+    "}\n",
+    "\n",
+    "// errors are only kept at the farthest position a parser failed at outside `noerror` sections\n",
+    "static inline bool gen_error_behind(const struct gen_state *s) {\n",
+    "    return (s->err.failure || s->err.num_expected) && s->pos < s->err.loc.byte_off;\n",
+    "}\n",
+    "\n",
+    "static inline void gen_expect(struct gen_state *s, const char *what) {\n",
+    "    if(s->noerror || gen_error_behind(s))\n",
+    "        return;\n",
+    "\n",
+    "    struct cc_error *e = &s->err;\n",
+    "    if(s->pos > e->loc.byte_off || (e->num_expected == 0 && !e->failure)) {\n",
+    "        memset(e, 0, sizeof(struct cc_error));\n",
+    "        e->loc.byte_off = s->pos;\n",
+    "        e->received = gen_peek(s);\n",
+    "    }\n",
+    "\n",
+    "    if(e->num_expected >= CC_ERR_MAX_EXPECTED)\n",
+    "        return;\n",
+    "\n",
+    "    for(size_t i = 0; i < e->num_expected; i++) {\n",
+    "        if(strcmp(e->expected[i], what) == 0)\n",
+    "            return;\n",
+    "    }\n",
+    "\n",
+    "    e->expected[e->num_expected++] = what;\n",
+    "}\n",
+    "\n",
+    "static inline void gen_fail(struct gen_state *s, const char *msg) {\n",
+    "    if(s->noerror || gen_error_behind(s))\n",
+    "        return;\n",
+    "\n",
+    "    memset(&s->err, 0, sizeof(struct cc_error));\n",
+    "    s->err.loc.byte_off = s->pos;\n",
+    "    s->err.received = gen_peek(s);\n",
+    "    s->err.failure = msg;\n",
+    "}\n",
+    "\n",
+    "static struct cc_location gen_resolve(struct gen_state *s, size_t off) {\n",
+    "    if(off < s->line.byte_off)\n",
+    "        s->line = CC_LOCATION_DEFAULT;\n",
+    "\n",
+    "    for(size_t i = s->line.byte_off; i < off; i++) {\n",
+    "        if(s->in[i] == '\\n') {\n",
+    "            s->line.line++;\n",
+    "            s->line.col = 1;\n",
+    "        }\n",
+    "        else\n",
+    "            s->line.col += (s->in[i] & 0xc0) != 0x80;\n",
+    "    }\n",
+    "\n",
+    "    s->line.byte_off = off;\n",
+    "    return s->line;\n",
+    "}\n",
+    "\n",
+    "static int gen_eval(struct gen_state *s, size_t node, struct cc_result *out) {\n",
+    "    *out = cc_ok(NULL);\n",
+    "    if(node == 0)\n",
+    "        return 0;\n",
+    "\n",
+    "    const struct gen_node *n = &s->nodes[node];\n",
+    "    switch(n->type) {\n",
+    "    case GEN_VALUE:\n",
+    "        out->out = n->value;\n",
+    "        return 0;\n",
+    "    case GEN_CHAR: {\n",
+    "        char8_t *str = calloc(gen_cp_length(n->ch) + 1, sizeof(char8_t));\n",
+    "        if(!str)\n",
+    "            return -errno;\n",
+    "\n",
+    "        if(n->ch < 0x80)\n",
+    "            str[0] = n->ch;\n",
+    "        else if(n->ch < 0x800) {\n",
+    "            str[0] = 0xc0 | (n->ch >> 6);\n",
+    "            str[1] = 0x80 | (n->ch & 0x3f);\n",
+    "        }\n",
+    "        else if(n->ch < 0x10000) {\n",
+    "            str[0] = 0xe0 | (n->ch >> 12);\n",
+    "            str[1] = 0x80 | ((n->ch >> 6) & 0x3f);\n",
+    "            str[2] = 0x80 | (n->ch & 0x3f);\n",
+    "        }\n",
+    "        else {\n",
+    "            str[0] = 0xf0 | (n->ch >> 18);\n",
+    "            str[1] = 0x80 | ((n->ch >> 12) & 0x3f);\n",
+    "            str[2] = 0x80 | ((n->ch >> 6) & 0x3f);\n",
+    "            str[3] = 0x80 | (n->ch & 0x3f);\n",
+    "        }\n",
+    "\n",
+    "        out->out = str;\n",
+    "        return 0;\n",
+    "    }\n",
+    "    case GEN_TEXT: {\n",
+    "        char8_t *str = calloc(n->b + 1, sizeof(char8_t));\n",
+    "        if(!str)\n",
+    "            return -errno;\n",
+    "\n",
+    "        memcpy(str, s->in + n->a, n->b);\n",
+    "        out->out = str;\n",
+    "        return 0;\n",
+    "    }\n",
+    "    case GEN_SPAN: {\n",
+    "        struct cc_span *span = malloc(sizeof(struct cc_span));\n",
+    "        if(!span)\n",
+    "            return -errno;\n",
+    "\n",
+    "        *span = (struct cc_span){.ptr = s->in + n->a, .len = n->b};\n",
+    "        out->out = span;\n",
+    "        return 0;\n",
+    "    }\n",
+    "    case GEN_LOCATION: {\n",
+    "        struct cc_location *loc = malloc(sizeof(struct cc_location));\n",
+    "        if(!loc)\n",
+    "            return -errno;\n",
+    "\n",
+    "        *loc = gen_resolve(s, n->at);\n",
+    "        out->out = loc;\n",
+    "        return 0;\n",
+    "    }\n",
+    "    case GEN_LIFT:\n",
+    "        *out = n->lift();\n",
+    "        break;\n",
+    "    case GEN_FOLD: {\n",
+    "        size_t base = s->n_values;\n",
+    "        for(size_t i = 0; i < n->b; i++) {\n",
+    "            int err = gen_eval(s, s->children.items[n->a + i], out);\n",
+    "            if(err || out->err)\n",
+    "                return err;\n",
+    "\n",
+    "            if(s->n_values >= s->c_values) {\n",
+    "                size_t capacity = s->c_values ? s->c_values * 2 : 64;\n",
+    "                void **values = realloc(s->values, capacity * sizeof(void*));\n",
+    "                if(!values)\n",
+    "                    return -errno;\n",
+    "\n",
+    "                s->values = values;\n",
+    "                s->c_values = capacity;\n",
+    "            }\n",
+    "\n",
+    "            s->values[s->n_values++] = out->out;\n",
+    "        }\n",
+    "\n",
+    "        s->n_values = base;\n",
+    "        *out = n->fold(n->b, s->values + base);\n",
+    "        break;\n",
+    "    }\n",
+    "    case GEN_APPLY: {\n",
+    "        int err = gen_eval(s, n->a, out);\n",
+    "        if(err || out->err)\n",
+    "            return err;\n",
+    "\n",
+    "        *out = n->apply(out->out);\n",
+    "        break;\n",
+    "    }\n",
+    "    }\n",
+    "\n",
+    "    if(out->err)\n",
+    "        cc_with_location(out->err, gen_resolve(s, n->at));\n",
+    "    return 0;\n",
+    "}\n",
+    "\n",
+    "// copies the error report collected while parsing\n",
+    "static struct cc_error *gen_report(struct gen_state *s) {\n",
+    "    struct cc_error *report = calloc(1, sizeof(struct cc_error));\n",
+    "    if(!report)\n",
+    "        return NULL;\n",
+    "\n",
+    "    // like `cc_parse`, errors without any message keep an unresolved location\n",
+    "    report->loc = s->err.loc;\n",
+    "    if(s->err.failure || s->err.num_expected)\n",
+    "        report->loc = gen_resolve(s, s->err.loc.byte_off);\n",
+    "    report->received = s->err.received;\n",
+    "\n",
+    "    if(s->err.failure && !(report->failure = strdup(s->err.failure)))\n",
+    "        goto fail;\n",
+    "\n",
+    "    for(; report->num_expected < s->err.num_expected; report->num_expected++) {\n",
+    "        if(!(report->expected[report->num_expected] = strdup(s->err.expected[report->num_expected])))\n",
+    "            goto fail;\n",
+    "    }\n",
+    "\n",
+    "    return report;\n",
+    "fail:\n",
+    "    cc_err_free(report);\n",
+    "    return NULL;\n",
+    "}\n",
+    NULL,
+};
+
+#define SCOPE_NONE SIZE_MAX
+
+struct codegen_entry {
+    const struct cc_parser *p;
+    const struct cc_parser *target; // parser a lookup resolves to, NULL if it is undefined
+    size_t scope; // scope the parser was collected in
+
+    // last scope check that reached the parser and the scope it was reached in
+    size_t check;
+    size_t check_scope;
+};
+
+// bindings in effect while collecting parsers, lookups are resolved to the innermost one with their name.
+// scopes are stored in `codegen` and referred to by index, so entries can record the scope they were collected in.
+struct codegen_scope {
+    size_t prev; // `SCOPE_NONE` for the outermost binding
+    const struct cc_binding *binding;
+};
+
+struct codegen {
+    FILE *f;
+    const struct cc_action *actions;
+
+    // every parser reachable from the root, the index names its function
+    struct codegen_entry *entries;
+    size_t count;
+    size_t capacity;
+
+    struct codegen_scope *scopes;
+    size_t num_scopes;
+    size_t scopes_capacity;
+
+    size_t checks; // number of scope checks so far
+};
+
+CC_format_printf(2)
+static void emit(struct codegen *g, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(g->f, fmt, ap);
+    va_end(ap);
+}
+
+static size_t entry_find(const struct codegen *g, const struct cc_parser *p) {
+    for(size_t i = 0; i < g->count; i++) {
+        if(g->entries[i].p == p)
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+static int entry_add(struct codegen *g, const struct cc_parser *p, size_t scope) {
+    if(g->count >= g->capacity) {
+        size_t capacity = g->capacity ? g->capacity * 2 : 64;
+        struct codegen_entry *entries = realloc(g->entries, capacity * sizeof(struct codegen_entry));
+        if(!entries)
+            return errno;
+
+        g->entries = entries;
+        g->capacity = capacity;
+    }
+
+    g->entries[g->count++] = (struct codegen_entry){.p = p, .scope = scope, .check = SIZE_MAX};
+    return 0;
+}
+
+// stores the index of the scope of `binding` inside of `prev` in `scope`, every scope is only stored once
+static int scope_push(struct codegen *g, size_t prev, const struct cc_binding *binding, size_t *scope) {
+    for(size_t i = 0; i < g->num_scopes; i++) {
+        if(g->scopes[i].prev == prev && g->scopes[i].binding == binding) {
+            *scope = i;
+            return 0;
+        }
+    }
+
+    if(g->num_scopes + 1 > g->scopes_capacity) {
+        size_t capacity = MAX(g->scopes_capacity * 2, 16);
+        struct codegen_scope *scopes = realloc(g->scopes, capacity * sizeof(struct codegen_scope));
+        if(!scopes)
+            return errno;
+
+        g->scopes = scopes;
+        g->scopes_capacity = capacity;
+    }
+
+    g->scopes[g->num_scopes] = (struct codegen_scope){prev, binding};
+    *scope = g->num_scopes++;
+    return 0;
+}
+
+// returns the parser the lookup `p` calls in `scope`, NULL if it is undefined
+static const struct cc_parser *lookup_target(const struct codegen *g, const struct cc_parser *p, size_t scope) {
+    if(p->match.lookup.target)
+        return p->match.lookup.target;
+
+    for(size_t it = scope; it != SCOPE_NONE; it = g->scopes[it].prev) {
+        if(strcmp(g->scopes[it].binding->name, p->match.lookup.name) == 0)
+            return g->scopes[it].binding->p;
+    }
+
+    return NULL;
+}
+
+// stores the function of type `type` in `p` in `fn`, returns false if `p` has none
+static bool function_of(enum cc_action_type type, const struct cc_parser *p, struct cc_action *fn) {
+    *fn = (struct cc_action){.type = type};
+
+    switch(type) {
+    case CC_ACTION_FOLD:
+        fn->fold = p->fold;
+        return p->fold != NULL;
+    case CC_ACTION_APPLY:
+        fn->apply = p->match.apply.af;
+        return p->type == PARSER_APPLY;
+    case CC_ACTION_LIFT:
+        fn->lift = p->match.lift.lf;
+        return p->type == PARSER_LIFT;
+    case CC_ACTION_VALUE:
+        fn->value = p->match.lift.val;
+        return p->type == PARSER_LIFT_VAL && p->match.lift.val;
+    case CC_ACTION_MATCH:
+        fn->match = p->match.matchfn;
+        return p->type == PARSER_MATCH;
+    default:
+        return false;
+    }
+}
+
+// returns the name of the action referring to the function of type `type` in `p`, NULL if it has none
+static const char *function_name(const struct codegen *g, enum cc_action_type type, const struct cc_parser *p) {
+    struct cc_action fn;
+    if(!function_of(type, p, &fn))
+        return NULL;
+
+    const struct cc_action *action = find_action(g->actions, &fn);
+    if(!action)
+        action = find_action(builtin_actions, &fn);
+    return action ? action->name : NULL;
+}
+
+// every parser gets a single function, so the lookups below a parser reached again in another scope
+// have to resolve to the same parsers as in the scope it was collected in.
+static int check_scope(struct codegen *g, const struct cc_parser *p, size_t scope, size_t check) {
+    size_t index = entry_find(g, p);
+    if(index == SIZE_MAX)
+        return ENOTSUP; // still being collected in the other scope
+
+    struct codegen_entry *entry = &g->entries[index];
+    if(entry->scope == scope || (entry->check == check && entry->check_scope == scope))
+        return 0;
+    if(entry->check == check)
+        return ENOTSUP; // reached in multiple scopes at once
+
+    entry->check = check;
+    entry->check_scope = scope;
+
+    int err;
+    switch(p->type) {
+    case PARSER_LOOKUP: {
+        const struct cc_parser *target = lookup_target(g, p, scope);
+        if(target != entry->target)
+            return ENOTSUP;
+        return target ? check_scope(g, target, scope, check) : 0;
+    }
+    case PARSER_EXPECT:
+        return check_scope(g, p->match.expect.inner, scope, check);
+    case PARSER_APPLY:
+        return check_scope(g, p->match.apply.inner, scope, check);
+    case PARSER_NOT:
+    case PARSER_MANY:
+    case PARSER_COUNT:
+    case PARSER_MAYBE:
+    case PARSER_LEAST:
+    case PARSER_NOERROR:
+    case PARSER_NORETURN:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        return check_scope(g, p->match.unary.inner, scope, check);
+    case PARSER_AND:
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n; i++) {
+            if((err = check_scope(g, p->match.variadic.inner[i], scope, check)))
+                return err;
+        }
+        return 0;
+    case PARSER_MANY_UNTIL:
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+    case PARSER_SEQ:
+    case PARSER_EITHER:
+        if((err = check_scope(g, p->match.binary.lhs, scope, check)))
+            return err;
+        return check_scope(g, p->match.binary.rhs, scope, check);
+    case PARSER_BIND: {
+        size_t inner;
+        if((err = scope_push(g, scope, p->match.bind.binding, &inner)))
+            return err;
+        return check_scope(g, p->match.bind.inner, inner, check);
+    }
+    default:
+        return 0;
+    }
+}
+
+// records every parser reachable from `p` and resolves the lookups
+static int collect(struct codegen *g, const struct cc_parser *p, size_t scope) {
+    if(!p)
+        return EINVAL;
+
+    size_t found = entry_find(g, p);
+    if(found != SIZE_MAX)
+        return g->entries[found].scope == scope ? 0 : check_scope(g, p, scope, g->checks++);
+
+    int err;
+    if((err = entry_add(g, p, scope)))
+        return err;
+
+    size_t index = g->count - 1;
+
+    if(p->fold && !function_name(g, CC_ACTION_FOLD, p))
+        return ENOTSUP;
+
+    switch(p->type) {
+    case PARSER_UNDEFINED:
+    case PARSER_REGEX:
+    case PARSER_REDUCE: // step functions have no action type
+        return ENOTSUP;
+    case PARSER_MATCH:
+        return function_name(g, CC_ACTION_MATCH, p) ? 0 : ENOTSUP;
+    case PARSER_LIFT:
+        return function_name(g, CC_ACTION_LIFT, p) ? 0 : ENOTSUP;
+    case PARSER_LIFT_VAL:
+        return !p->match.lift.val || function_name(g, CC_ACTION_VALUE, p) ? 0 : ENOTSUP;
+    case PARSER_LOOKUP: {
+        // lookups are resolved where they are first reached, `check_scope` rejects them resolving differently elsewhere
+        const struct cc_parser *target = lookup_target(g, p, scope);
+
+        g->entries[index].target = target;
+        return target ? collect(g, target, scope) : 0;
+    }
+    case PARSER_EXPECT:
+        return collect(g, p->match.expect.inner, scope);
+    case PARSER_APPLY:
+        if(!function_name(g, CC_ACTION_APPLY, p))
+            return ENOTSUP;
+        return collect(g, p->match.apply.inner, scope);
+    case PARSER_NOT:
+    case PARSER_MANY:
+    case PARSER_COUNT:
+    case PARSER_MAYBE:
+    case PARSER_LEAST:
+    case PARSER_NOERROR:
+    case PARSER_NORETURN:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        return collect(g, p->match.unary.inner, scope);
+    case PARSER_AND:
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n; i++) {
+            if((err = collect(g, p->match.variadic.inner[i], scope)))
+                return err;
+        }
+        return 0;
+    case PARSER_MANY_UNTIL:
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+    case PARSER_SEQ:
+    case PARSER_EITHER:
+        if((err = collect(g, p->match.binary.lhs, scope)))
+            return err;
+        return collect(g, p->match.binary.rhs, scope);
+    case PARSER_BIND: {
+        size_t inner;
+        if((err = scope_push(g, scope, p->match.bind.binding, &inner)))
+            return err;
+        return collect(g, p->match.bind.inner, inner);
+    }
+    default:
+        return 0;
+    }
+}
+
+// follows lookups to the parser they call, NULL if they are undefined (or only refer to each other)
+static const struct cc_parser *resolve(const struct codegen *g, const struct cc_parser *p) {
+    for(size_t i = 0; p && p->type == PARSER_LOOKUP; i++)
+        p = i < g->count ? g->entries[entry_find(g, p)].target : NULL;
+    return p;
+}
+
+// writes `len` bytes of `s` as a string literal
+static void emit_string(struct codegen *g, const char8_t *s, size_t len) {
+    fputc('"', g->f);
+
+    for(size_t i = 0; i < len; i++) {
+        if(s[i] >= 0x20 && s[i] < 0x7f && s[i] != '"' && s[i] != '\\' && s[i] != '?')
+            fputc(s[i], g->f);
+        else
+            emit(g, "\\%03o", s[i]);
+    }
+
+    fputc('"', g->f);
+}
+
+// writes the condition of the next bytes of the input being `bytes`
+static void emit_bytes_cond(struct codegen *g, const char8_t *bytes, size_t len) {
+    if(len == 1) {
+        emit(g, "s->pos < s->size && s->in[s->pos] == 0x%02x", bytes[0]);
+        return;
+    }
+
+    emit(g, "s->size - s->pos >= %zu && memcmp(s->in + s->pos, ", len);
+    emit_string(g, bytes, len);
+    emit(g, ", %zu) == 0", len);
+}
+
+// expectations of terminals are matched inline like the terminals themselves
+static inline bool is_inline_expect(const struct cc_parser *p) {
+    return p->type == PARSER_EXPECT && !is_combinator(p->match.expect.inner->type) && p->match.expect.inner->type != PARSER_LOOKUP;
+}
+
+// only combinators get a function of their own
+static inline bool has_function(const struct cc_parser *p) {
+    return is_combinator(p->type) && !is_inline_expect(p);
+}
+
+// sets `res` to the result of calling `p`, terminals are matched inline
+static void emit_call(struct codegen *g, const struct cc_parser *p, const char *in) {
+    const struct cc_parser *target = resolve(g, p);
+    if(!target) {
+        emit(g, "%sgen_fail(s, \"undefined parser \\\"\" ", in);
+        emit_string(g, (const char8_t*) p->match.lookup.name, strlen(p->match.lookup.name));
+        emit(g, " \"\\\"\");\n%sres = 0;\n", in);
+        return;
+    }
+
+    p = target;
+    const char *what = NULL;
+    if(is_inline_expect(p)) {
+        what = p->match.expect.what;
+        p = p->match.expect.inner;
+    }
+
+    char8_t bytes[CC_UTF8_ENCODE_MAX];
+    size_t len;
+
+    switch(p->type) {
+    case PARSER_EOF:
+        emit(g, "%sres = s->pos >= s->size ? gen_result(s, 0) : 0;\n", in);
+        break;
+    case PARSER_SOF:
+        emit(g, "%sres = s->pos == 0 ? gen_result(s, 0) : 0;\n", in);
+        break;
+    case PARSER_PASS:
+        emit(g, "%sres = gen_result(s, 0);\n", in);
+        break;
+    case PARSER_FAIL:
+        emit(g, "%sgen_fail(s, ", in);
+        emit_string(g, (const char8_t*) p->match.msg, strlen(p->match.msg));
+        emit(g, ");\n%sres = 0;\n", in);
+        break;
+    case PARSER_LIFT:
+        emit(g, "%sres = gen_lift(s, %s);\n", in, function_name(g, CC_ACTION_LIFT, p));
+        break;
+    case PARSER_LIFT_VAL:
+        emit(g, "%sres = gen_value(s, %s);\n", in, p->match.lift.val ? function_name(g, CC_ACTION_VALUE, p) : "NULL");
+        break;
+    case PARSER_LOCATION:
+        emit(g, "%sres = gen_location(s);\n", in);
+        break;
+    case PARSER_CHAR:
+        len = utf8_encode(p->match.ch, bytes);
+        emit(g, "%sif(", in);
+        emit_bytes_cond(g, bytes, len);
+        emit(g, ") {\n%s    s->pos += %zu;\n%s    res = gen_char(s, 0x%x);\n%s}\n%selse\n%s    res = 0;\n",
+            in, len, in, (unsigned) p->match.ch, in, in, in);
+        break;
+    case PARSER_STRING:
+        if(p->match.len == 0) {
+            emit(g, "%sres = gen_text(s, GEN_TEXT, s->pos);\n", in);
+            break;
+        }
+
+        emit(g, "%sif(", in);
+        emit_bytes_cond(g, p->match.str, p->match.len);
+        emit(g, ") {\n%s    s->pos += %zu;\n%s    res = gen_text(s, GEN_TEXT, s->pos - %zu);\n%s}\n%selse\n%s    res = 0;\n",
+            in, p->match.len, in, p->match.len, in, in, in);
+        break;
+    case PARSER_ANY:
+    case PARSER_CHAR_RANGE:
+    case PARSER_MATCH:
+    case PARSER_ANYOF:
+    case PARSER_ONEOF:
+    case PARSER_NONEOF:
+        emit(g, "%s{\n%s    char32_t c = gen_peek(s);\n%s    if(c != (char32_t) EOF", in, in, in);
+        if(p->type == PARSER_CHAR_RANGE && p->match.lo > 0)
+            emit(g, " && c >= 0x%x", (unsigned) p->match.lo);
+        if(p->type == PARSER_CHAR_RANGE)
+            emit(g, " && c <= 0x%x", (unsigned) p->match.hi);
+        else if(p->type == PARSER_MATCH)
+            emit(g, " && %s(c)", function_name(g, CC_ACTION_MATCH, p));
+        else if(p->type != PARSER_ANY)
+            emit(g, " && %sgen_class_has(&class%zu, c)", p->type == PARSER_NONEOF ? "!" : "", entry_find(g, p));
+
+        emit(g, ") {\n%s        gen_advance(s, c);\n%s        res = gen_char(s, c);\n%s    }\n%s    else\n%s        res = 0;\n%s}\n",
+            in, in, in, in, in, in);
+        break;
+    default:
+        emit(g, "%sres = p%zu(s);\n", in, entry_find(g, p));
+        break;
+    }
+
+    // `cc_match` names its function by address, which means nothing in the generated code
+    static const char match_what[] = "character matching function <";
+    if(what && p->type == PARSER_MATCH && strncmp(what, match_what, sizeof(match_what) - 1) == 0)
+        emit(g, "%sif(res == 0)\n%s    gen_expect(s, \"%s%s>\");\n", in, in, match_what, function_name(g, CC_ACTION_MATCH, p));
+    else if(what) {
+        emit(g, "%sif(res == 0)\n%s    gen_expect(s, ", in, in);
+        emit_string(g, (const char8_t*) what, strlen(what));
+        emit(g, ");\n");
+    }
+
+    emit(g, "%sif(res < 0)\n%s    return res;\n", in, in);
+}
+
+// declares the local variables of a parser, the results of parsers without fold function are dropped
+static void emit_locals(struct codegen *g, const struct cc_parser *p, bool can_fail) {
+    if(can_fail)
+        emit(g, "    size_t rp = s->results.count;\n");
+    emit(g, "    int res;\n");
+
+    if(!p->fold)
+        emit(g, "    bool noreturn = s->noreturn;\n    s->noreturn = true;\n");
+    emit(g, "\n");
+}
+
+// the number of results is counted at run time in the local `n`
+#define RESULTS_COUNTED UINT_MAX
+
+// folds the `n` results of the parser and returns success
+static void emit_success(struct codegen *g, const struct cc_parser *p, unsigned n) {
+    if(p->fold && n != RESULTS_COUNTED)
+        emit(g, "    if((res = gen_fold(s, %s, %uu)) < 0)\n        return res;\n    return 1;\n", function_name(g, CC_ACTION_FOLD, p), n);
+    else if(p->fold)
+        emit(g, "    if((res = gen_fold(s, %s, n)) < 0)\n        return res;\n    return 1;\n", function_name(g, CC_ACTION_FOLD, p));
+    else
+        emit(g, "    s->noreturn = noreturn;\n    return gen_result(s, 0);\n");
+}
+
+// drops the results of the parser and returns failure
+static void emit_failure(struct codegen *g, const struct cc_parser *p) {
+    if(!p->fold)
+        emit(g, "    s->noreturn = noreturn;\n");
+    emit(g, "    s->results.count = rp;\n    return 0;\n");
+}
+
+// repeats `inner` until it fails, `n` counts the results
+static void emit_many_iter(struct codegen *g, const struct cc_parser *inner) {
+    emit(g, "    noerror = s->noerror;\n    s->noerror = true;\n\nrepeat:\n    m = gen_save(s);\n");
+    emit_call(g, inner, "    ");
+    emit(g, "    if(res) {\n        n++;\n        goto repeat;\n    }\n\n    gen_restore(s, m);\n    s->noerror = noerror;\n\n");
+}
+
+static void emit_parser(struct codegen *g, const struct cc_parser *p) {
+    emit(g, "\nstatic int p%zu(struct gen_state *s) {\n", entry_find(g, p));
+
+    switch(p->type) {
+    case PARSER_MANY:
+        emit(g, "    size_t n = 0;\n    bool noerror;\n    struct gen_mark m;\n");
+        emit_locals(g, p, false);
+        emit_many_iter(g, p->match.unary.inner);
+        emit_success(g, p, RESULTS_COUNTED);
+        break;
+
+    case PARSER_MANY_UNTIL:
+        emit(g, "    size_t n = 1;\n    bool noerror;\n    struct gen_mark m;\n");
+        emit_locals(g, p, true);
+
+        emit(g, "repeat:\n    noerror = s->noerror;\n    s->noerror = true;\n    m = gen_save(s);\n");
+        emit_call(g, p->match.binary.rhs, "    ");
+        emit(g, "    s->noerror = noerror;\n    if(res)\n        goto done;\n\n    gen_restore(s, m);\n");
+        emit_call(g, p->match.binary.lhs, "    ");
+        emit(g, "    if(res) {\n        n++;\n        goto repeat;\n    }\n\n");
+
+        // try the end parser again, but generate errors this time
+        emit(g, "    m = gen_save(s);\n");
+        emit_call(g, p->match.binary.rhs, "    ");
+        emit(g, "    if(res)\n        goto done;\n\n    gen_restore(s, m);\n");
+        emit_failure(g, p);
+
+        emit(g, "\ndone:\n");
+        emit_success(g, p, RESULTS_COUNTED);
+        break;
+
+    case PARSER_COUNT:
+        if(p->match.unary.n == 0) {
+            emit(g, "    return gen_result(s, 0);\n");
+            break;
+        }
+
+        emit(g, "    unsigned i = 0;\n");
+        emit_locals(g, p, true);
+
+        emit(g, "repeat:\n");
+        emit_call(g, p->match.unary.inner, "    ");
+        emit(g, "    if(!res)\n        goto fail;\n    if(++i < %uu)\n        goto repeat;\n\n", p->match.unary.n);
+
+        emit_success(g, p, p->match.unary.n);
+        emit(g, "\nfail:\n");
+        emit_failure(g, p);
+        break;
+
+    case PARSER_LEAST:
+        emit(g, "    size_t n = 0;\n    bool noerror;\n    struct gen_mark m;\n");
+        emit_locals(g, p, p->match.unary.n > 0);
+
+        if(p->match.unary.n > 0) {
+            emit(g, "count:\n");
+            emit_call(g, p->match.unary.inner, "    ");
+            emit(g, "    if(!res)\n        goto fail;\n    if(++n < %uu)\n        goto count;\n\n", p->match.unary.n);
+        }
+
+        emit_many_iter(g, p->match.unary.inner);
+        emit_success(g, p, RESULTS_COUNTED);
+
+        if(p->match.unary.n > 0) {
+            emit(g, "\nfail:\n");
+            emit_failure(g, p);
+        }
+        break;
+
+    case PARSER_MAYBE:
+        emit(g, "    bool noerror = s->noerror;\n    struct gen_mark m = gen_save(s);\n    int res;\n\n    s->noerror = true;\n");
+        emit_call(g, p->match.unary.inner, "    ");
+        emit(g, "    s->noerror = noerror;\n    if(res)\n        return 1;\n\n    gen_restore(s, m);\n    return gen_result(s, 0);\n");
+        break;
+
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        emit(g, "    size_t n = 1;\n    bool noerror;\n    struct gen_mark m;\n");
+        emit_locals(g, p, true);
+
+        emit_call(g, p->match.binary.lhs, "    ");
+        emit(g, "    if(!res)\n        goto fail;\n\n");
+
+        if(p->type == PARSER_POSTFIX)
+            emit_many_iter(g, p->match.binary.rhs);
+        else {
+            emit(g, "repeat:\n    m = gen_save(s);\n    noerror = s->noerror;\n    s->noerror = true;\n");
+            emit_call(g, p->match.binary.rhs, "    ");
+            emit(g, "    s->noerror = noerror;\n    if(res) {\n");
+            emit_call(g, p->match.binary.lhs, "        ");
+            emit(g, "        if(!res)\n            goto fail;\n\n        n += 2;\n        goto repeat;\n    }\n\n    gen_restore(s, m);\n");
+        }
+
+        emit_success(g, p, RESULTS_COUNTED);
+        emit(g, "\nfail:\n");
+        emit_failure(g, p);
+        break;
+
+    case PARSER_SEQ:
+    case PARSER_AND: {
+        unsigned n = p->type == PARSER_SEQ ? 2 : p->match.variadic.n;
+        struct cc_parser *const *inner = p->type == PARSER_SEQ ? (struct cc_parser *const[]){p->match.binary.lhs, p->match.binary.rhs} : p->match.variadic.inner;
+
+        emit_locals(g, p, n > 0);
+        for(unsigned i = 0; i < n; i++) {
+            emit_call(g, inner[i], "    ");
+            emit(g, "    if(!res)\n        goto fail;\n\n");
+        }
+
+        emit_success(g, p, n);
+
+        if(n > 0) {
+            emit(g, "\nfail:\n");
+            emit_failure(g, p);
+        }
+    } break;
+
+    case PARSER_EITHER:
+    case PARSER_OR: {
+        unsigned n = p->type == PARSER_EITHER ? 2 : p->match.variadic.n;
+        struct cc_parser *const *inner = p->type == PARSER_EITHER ? (struct cc_parser *const[]){p->match.binary.lhs, p->match.binary.rhs} : p->match.variadic.inner;
+
+        if(n > 1)
+            emit(g, "    struct gen_mark m = gen_save(s);\n");
+        emit(g, "    int res;\n\n");
+
+        for(unsigned i = 0; i < n; i++) {
+            if(i > 0)
+                emit(g, "    gen_restore(s, m);\n");
+            emit_call(g, inner[i], "    ");
+            emit(g, "    if(res)\n        return 1;\n\n");
+        }
+
+        emit(g, "    return 0;\n");
+    } break;
+
+    case PARSER_NOT:
+        emit(g, "    struct gen_mark m = gen_save(s);\n    bool noreturn = s->noreturn, noerror = s->noerror;\n    int res;\n\n");
+        emit(g, "    s->noreturn = true;\n    s->noerror = true;\n");
+        emit_call(g, p->match.unary.inner, "    ");
+        emit(g, "    s->noreturn = noreturn;\n    s->noerror = noerror;\n\n");
+        emit(g, "    if(!res)\n        return gen_result(s, 0);\n\n    gen_restore(s, m);\n    return 0;\n");
+        break;
+
+    case PARSER_EXPECT:
+        emit(g, "    int res;\n\n");
+        emit_call(g, p->match.expect.inner, "    ");
+        emit(g, "    if(!res)\n        gen_expect(s, ");
+        emit_string(g, (const char8_t*) p->match.expect.what, strlen(p->match.expect.what));
+        emit(g, ");\n    return res;\n");
+        break;
+
+    case PARSER_APPLY:
+        emit(g, "    int res;\n\n");
+        emit_call(g, p->match.apply.inner, "    ");
+        emit(g, "    return res ? gen_apply(s, %s) : 0;\n", function_name(g, CC_ACTION_APPLY, p));
+        break;
+
+    case PARSER_NORETURN:
+    case PARSER_CAPTURE:
+        if(p->type == PARSER_CAPTURE)
+            emit(g, "    size_t start = s->pos;\n");
+        emit(g, "    bool noreturn = s->noreturn;\n    int res;\n\n    s->noreturn = true;\n");
+        emit_call(g, p->match.unary.inner, "    ");
+        emit(g, "    s->noreturn = noreturn;\n    if(!res)\n        return 0;\n\n");
+
+        // the result of a capture is the span of input its inner parser consumed
+        if(p->type == PARSER_CAPTURE)
+            emit(g, "    return gen_text(s, GEN_SPAN, start);\n");
+        else
+            emit(g, "    return gen_result(s, 0);\n");
+        break;
+
+    case PARSER_NOERROR:
+        emit(g, "    bool noerror = s->noerror;\n    int res;\n\n    s->noerror = true;\n");
+        emit_call(g, p->match.unary.inner, "    ");
+        emit(g, "    s->noerror = noerror;\n    return res;\n");
+        break;
+
+    case PARSER_MEMO:
+    case PARSER_BIND:
+        // no memoization, lookups inside of bindings are already resolved
+        emit(g, "    int res;\n\n");
+        emit_call(g, p->type == PARSER_MEMO ? p->match.unary.inner : p->match.bind.inner, "    ");
+        emit(g, "    return res;\n");
+        break;
+
+    default:
+        assert(false && "unknown parser combinator type");
+        unreachable();
+    }
+
+    emit(g, "}\n");
+}
+
+// declares the functions and values of the user actions the generated code refers to
+static int emit_externs(struct codegen *g) {
+    static const char *const declarations[] = {
+        [CC_ACTION_VALUE] = "extern void *%s;\n",
+        [CC_ACTION_FOLD]  = "struct cc_result %s(size_t n, void **r);\n",
+        [CC_ACTION_APPLY] = "struct cc_result %s(void *r);\n",
+        [CC_ACTION_LIFT]  = "struct cc_result %s(void);\n",
+        [CC_ACTION_MATCH] = "int %s(char32_t c);\n",
+    };
+
+    size_t n = 0;
+    for(; g->actions && g->actions[n].type != CC_ACTION_NULL; n++);
+
+    bool *declared = calloc(n + 1, sizeof(bool));
+    if(!declared)
+        return errno;
+
+    for(size_t i = 0; i < g->count; i++) {
+        for(enum cc_action_type type = CC_ACTION_VALUE; type <= CC_ACTION_MATCH; type++) {
+            struct cc_action fn;
+            const struct cc_action *action;
+            if(!function_of(type, g->entries[i].p, &fn) || !(action = find_action(g->actions, &fn)))
+                continue;
+
+            size_t index = action - g->actions;
+            if(!declared[index])
+                emit(g, declarations[type], action->name);
+            declared[index] = true;
+        }
+    }
+
+    free(declared);
+    return 0;
+}
+
+// writes the character sets of the sets matched inline
+static void emit_classes(struct codegen *g) {
+    for(size_t i = 0; i < g->count; i++) {
+        const struct cc_parser *p = g->entries[i].p;
+        if(p->type != PARSER_ANYOF && p->type != PARSER_ONEOF && p->type != PARSER_NONEOF)
+            continue;
+
+        const struct char_class *c = p->match.list.class;
+        emit(g, "\nstatic const struct gen_class class%zu = {{0x%08x, 0x%08x, 0x%08x, 0x%08x}, %zu, ",
+            i, c->ascii[0], c->ascii[1], c->ascii[2], c->ascii[3], c->n);
+
+        if(c->n == 0) {
+            emit(g, "NULL};\n");
+            continue;
+        }
+
+        emit(g, "(const char32_t[][2]){");
+        for(size_t j = 0; j < c->n; j++)
+            emit(g, "%s{0x%x, 0x%x}", j ? ", " : "", (unsigned) c->ranges[j].lo, (unsigned) c->ranges[j].hi);
+        emit(g, "}};\n");
+    }
+}
+
+static void emit_entry(struct codegen *g, const struct cc_parser *p, const char *name) {
+    emit(g, "\nstatic int gen_start(struct gen_state *s) {\n    int res;\n\n");
+    emit_call(g, p, "    ");
+    emit(g, "    return res;\n}\n");
+
+    emit(g,
+        "\nint %s(const char8_t *in, size_t n, struct cc_result *r) {\n"
+        "    if(!in || !r)\n"
+        "        return EINVAL;\n"
+        "\n"
+        "    memset(r, 0, sizeof(struct cc_result));\n"
+        "\n"
+        "    struct gen_state s = {.in = in, .size = n, .n_nodes = 1, .line = CC_LOCATION_DEFAULT};\n"
+        "\n"
+        "    int res = gen_start(&s);\n"
+        "    if(res > 0)\n"
+        "        res = gen_eval(&s, s.results.items[0], r);\n"
+        "    else if(res == 0 && !(r->err = gen_report(&s)))\n"
+        "        res = -errno;\n"
+        "\n"
+        "    free(s.nodes);\n"
+        "    free(s.results.items);\n"
+        "    free(s.children.items);\n"
+        "    free(s.values);\n"
+        "    return res < 0 ? -res : 0;\n"
+        "}\n",
+        name);
+}
+
+int cc_codegen_c(struct cc_parser *p, const char *name, const struct cc_action actions[], FILE *f) {
+    if(!p || !name || !f)
+        return EINVAL;
+
+    struct codegen g = {.f = f, .actions = actions};
+
+    int err;
+    if((err = collect(&g, p, SCOPE_NONE)))
+        goto cleanup;
+
+    emit(&g, "// generated by ccombinator %d.%d, do not edit\n\n", CC_VERSION_MAJOR, CC_VERSION_MINOR);
+    for(size_t i = 0; runtime[i]; i++)
+        fputs(runtime[i], f);
+
+    emit(&g, "\n");
+    if((err = emit_externs(&g)))
+        goto cleanup;
+    emit_classes(&g);
+
+    emit(&g, "\n");
+    for(size_t i = 0; i < g.count; i++) {
+        if(has_function(g.entries[i].p))
+            emit(&g, "static int p%zu(struct gen_state *s);\n", i);
+    }
+
+    for(size_t i = 0; i < g.count; i++) {
+        if(has_function(g.entries[i].p))
+            emit_parser(&g, g.entries[i].p);
+    }
+
+    emit_entry(&g, p, name);
+
+    if(ferror(f))
+        err = EIO;
+cleanup:
+    free(g.entries);
+    free(g.scopes);
+    return err;
+}
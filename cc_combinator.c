@@ -258,6 +258,27 @@ struct cc_parser *cc_many(cc_fold_t f, struct cc_parser *a) {
     return p;
 }
 
+struct cc_parser *cc_many_reduce(cc_lift_t init, cc_step_t step, struct cc_parser *a) {
+    if(!a || !init || !step) {
+        errno = EINVAL;
+        goto failure;
+    }
+
+    struct cc_parser *p = parser_allocate();
+    if(!p)
+        goto failure;
+
+    p->type = PARSER_REDUCE;
+    p->match.reduce.init = init;
+    p->match.reduce.step = step;
+    p->match.reduce.inner = a;
+
+    return p;
+failure:
+    cc_release(a);
+    return NULL;
+}
+
 struct cc_parser *cc_many_until(cc_fold_t f, struct cc_parser *a, struct cc_parser *end) {
     struct cc_parser *p = binary_parser(a, end);
     if(!p)
@@ -380,6 +401,26 @@ struct cc_parser *cc_noerror(struct cc_parser *a) {
     return p;
 }
 
+struct cc_parser *cc_memo(struct cc_parser *a) {
+    struct cc_parser *p = unary_parser(a);
+    if(!p)
+        return NULL;
+
+    p->type = PARSER_MEMO;
+
+    return p;
+}
+
+struct cc_parser *cc_capture(struct cc_parser *a) {
+    struct cc_parser *p = unary_parser(a);
+    if(!p)
+        return NULL;
+
+    p->type = PARSER_CAPTURE;
+
+    return p;
+}
+
 struct cc_parser *cc_between(struct cc_parser *s, struct cc_parser *a, struct cc_parser *e) {
     if(!s || !a || !e)
         return NULL;
@@ -289,7 +289,7 @@ static int open_memstream(struct cc_source *source, const char *filename) {
 }
 
 static struct cc_source *new_source(void) {
-    struct cc_source *s = malloc(sizeof(struct cc_source));
+    struct cc_source *s = calloc(1, sizeof(struct cc_source));
     if(!s)
         return NULL;
 
@@ -334,6 +334,55 @@ struct cc_source *cc_nstring_source(const char8_t *str, size_t size) {
     return s;
 }
 
+static int free_stream(const char8_t *buffer) {
+    free((void*) buffer);
+    return 0;
+}
+
+struct cc_source *cc_stream_source(cc_read_t read, void *userp) {
+    if(!read) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct cc_source *s = new_source();
+    if(!s)
+        return NULL;
+
+    s->origin = "<stream>";
+    s->buffer_dtor = free_stream;
+    s->stream.read = read;
+    s->stream.userp = userp;
+    s->stream.pos = CC_LOCATION_DEFAULT;
+
+    return s;
+}
+
+static int read_fd(void *userp, char8_t *buf, size_t n, size_t *nread) {
+    ssize_t count;
+    while((count = read((int) (intptr_t) userp, buf, n)) < 0) {
+        if(errno != EINTR)
+            return errno;
+    }
+
+    *nread = (size_t) count;
+    return 0;
+}
+
+struct cc_source *cc_fd_source(int fd) {
+    if(fd < 0) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    struct cc_source *s = cc_stream_source(read_fd, (void*) (intptr_t) fd);
+    if(!s)
+        return NULL;
+
+    s->origin = "<fd>";
+    return s;
+}
+
 int cc_close(struct cc_source *s) {
     if(!s)
         return EINVAL;
@@ -540,6 +589,13 @@ void hashtable_free(struct cc_hashtable *t) {
             free(curr);
         }
     }
+
+    while(t->unused) {
+        struct cc_hashentry *curr = t->unused;
+        t->unused = curr->stack;
+        free(curr);
+    }
+
     free(t->entries);
 }
 
@@ -607,8 +663,10 @@ static int hashtable_insert(struct cc_hashtable *t, const char *k, void *v, bool
     if(!allow_duplicate && *slot && *slot != HASHTABLE_MARKED)
         return EEXIST;
 
-    struct cc_hashentry *entry = malloc(sizeof(struct cc_hashentry));
-    if(!entry)
+    struct cc_hashentry *entry = t->unused;
+    if(entry)
+        t->unused = entry->stack;
+    else if(!(entry = malloc(sizeof(struct cc_hashentry))))
         return errno;
 
     entry->key = k;
@@ -679,7 +737,8 @@ void *hashtable_remove(struct cc_hashtable *t, const char *k) {
         entry->prev->next = entry->next;
 
     void *value = entry->value;
-    free(entry);
+    entry->stack = t->unused;
+    t->unused = entry;
     return value;
 }
 
@@ -721,10 +780,31 @@ static int free_rule(const char *k, void *v, void*) {
     return 0;
 }
 
+int grammar_set_actions(struct cc_grammar *g, const struct cc_action actions[]) {
+    size_t count = 0;
+    while(actions && actions[count].type != CC_ACTION_NULL)
+        count++;
+
+    if(!(g->actions = calloc(count + 1, sizeof(struct cc_action))))
+        return errno;
+
+    for(size_t i = 0; i < count; i++) {
+        g->actions[i] = actions[i];
+        if(!(g->actions[i].name = strdup(actions[i].name)))
+            return errno;
+    }
+
+    return 0;
+}
+
 void cc_grammar_free(struct cc_grammar *g) {
     if(!g)
         return;
 
+    for(struct cc_action *a = g->actions; a && a->type != CC_ACTION_NULL; a++)
+        free((char*) a->name);
+    free(g->actions);
+
     hashtable_iter(&g->rules, free_rule, NULL);
 
     hashtable_free(&g->rules);
@@ -748,8 +828,10 @@ struct cc_parser *cc_rule(const struct cc_grammar *g, const char *name) {
     }
 
     struct cc_parser *found = cc_retain(hashtable_get(&g->rules, name));
-    if(!found)
+    if(!found) {
+        errno = ENOENT;
         return NULL;
+    }
 
     struct cc_parser *p = cc_seq(cc_fold_first, found, cc_eof());
     if(!p)
@@ -761,3 +843,92 @@ struct cc_parser *cc_rule(const struct cc_grammar *g, const char *name) {
     return p;
 }
 
+
+// resolves the lookups of rules in `g` reachable from `p`, bindings that might shadow rules are recorded in `g`
+static void link_parser(struct cc_parser *p, struct cc_grammar *g) {
+    if(!p || (p->flags & PARSER_FLAG_LINKED))
+        return;
+
+    p->flags |= PARSER_FLAG_LINKED; // before recursing, since `cc_fix` creates cycles
+
+    switch(p->type) {
+        case PARSER_LOOKUP: {
+            struct cc_parser *target = hashtable_get(&g->rules, p->match.lookup.name);
+
+            // rules only referring to each other are left to be resolved by name
+            struct cc_parser *it = target;
+            while(it && it != p)
+                it = it->type == PARSER_LOOKUP ? it->match.lookup.target : NULL;
+            if(it != p)
+                p->match.lookup.target = target;
+        } break;
+        case PARSER_EXPECT:
+            link_parser(p->match.expect.inner, g);
+            break;
+        case PARSER_APPLY:
+            link_parser(p->match.apply.inner, g);
+            break;
+        case PARSER_REDUCE:
+            link_parser(p->match.reduce.inner, g);
+            break;
+        case PARSER_NOT:
+        case PARSER_MANY:
+        case PARSER_COUNT:
+        case PARSER_MAYBE:
+        case PARSER_LEAST:
+        case PARSER_NOERROR:
+        case PARSER_NORETURN:
+        case PARSER_MEMO:
+        case PARSER_CAPTURE:
+            link_parser(p->match.unary.inner, g);
+            break;
+        case PARSER_AND:
+        case PARSER_OR:
+            for(unsigned i = 0; i < p->match.variadic.n; i++)
+                link_parser(p->match.variadic.inner[i], g);
+            break;
+        case PARSER_BIND:
+            // the lookups inside of bindings keep being resolved by name
+            g->scoped = true;
+            break;
+        case PARSER_SEQ:
+        case PARSER_EITHER:
+        case PARSER_MANY_UNTIL:
+        case PARSER_CHAIN:
+        case PARSER_POSTFIX:
+            link_parser(p->match.binary.lhs, g);
+            link_parser(p->match.binary.rhs, g);
+            break;
+        default:
+            break;
+    }
+}
+
+static int link_rule(const char *, void *v, void *userp) {
+    link_parser(v, userp);
+    return 0;
+}
+
+struct cc_parser *cc_grammar_link(struct cc_grammar *g, const char *name) {
+    if(!g || !name) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if(!g->linked) {
+        hashtable_iter(&g->rules, link_rule, g);
+        g->linked = true;
+    }
+
+    // rules shadowed by bindings still need to be in scope
+    if(g->scoped)
+        return cc_rule(g, name);
+
+    struct cc_parser *found = cc_retain(hashtable_get(&g->rules, name));
+    if(!found) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    return cc_seq(cc_fold_first, found, cc_eof());
+}
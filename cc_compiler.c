@@ -3,76 +3,165 @@
 
 #include "internal.h"
 
-#define EMIT(ir, i) do {                \
-    if((err = ir_push_u8((ir), (i))))   \
-        goto cleanup;                   \
+#define EMIT(ir, i) do {                                                \
+    if((err = ir_emit((ir), (i))))                                      \
+        goto cleanup;                                                   \
     } while(0)
 
-#define EMIT_PUSH(ir, v) do {           \
-    EMIT(ir, IR_PUSH);                  \
-    if((err = ir_push_u32((ir), (v))))  \
-        goto cleanup;                   \
+#define EMIT_PUSH(ir, v) do {                                           \
+    if((err = ir_emit_u32((ir), IR_PUSH, (v), NULL)))                   \
+        goto cleanup;                                                   \
     } while(0)
 
-#define EMIT_CALL(ir, v) do {           \
-    EMIT(ir, IR_CALL);                  \
-    if((err = ir_push_ptr((ir), (v))))  \
-        goto cleanup;                   \
+#define EMIT_CALL(ir, p) do {                                           \
+    if((err = ir_emit_call((ir), (p))))                                 \
+        goto cleanup;                                                   \
     } while(0)
 
-#define EMIT_JUMP(ir, to) do {          \
-    EMIT(ir, IR_JUMP);                  \
-    if((err = ir_push_u32((ir), (to)))) \
-        goto cleanup;                   \
+#define EMIT_JUMP(ir, to) do {                                          \
+    if((err = ir_emit_u32((ir), IR_JUMP, (to), NULL)))                  \
+        goto cleanup;                                                   \
     } while(0)
 
-#define EMIT_COND_JUMP(ir, to, cond) do {   \
-    EMIT(ir, IR_JUMP_##cond);               \
-    if((err = ir_push_u32((ir), (to))))     \
-        goto cleanup;                       \
+#define EMIT_COND_JUMP(ir, to, cond) do {                               \
+    if((err = ir_emit_u32((ir), IR_JUMP_##cond, (to), NULL)))           \
+        goto cleanup;                                                   \
     } while(0)
 
-static int ir_reserve(struct cc_ir **ir, uint32_t capacity) {
-    assert(*ir == NULL && "can only reserve on new ir vectors");
-    if(!(*ir = malloc(IR_ALLOC_SIZE(IR_INIT_CAPACITY))))
+// forward jumps store the offset of their target operand in `patch` for apply_patches()
+#define EMIT_FORWARD_JUMP(ir, patch) do {                               \
+    if((err = ir_emit_u32((ir), IR_JUMP, UINT32_MAX, (patch))))         \
+        goto cleanup;                                                   \
+    } while(0)
+
+#define EMIT_FORWARD_COND_JUMP(ir, cond, patch) do {                    \
+    if((err = ir_emit_u32((ir), IR_JUMP_##cond, UINT32_MAX, (patch))))  \
+        goto cleanup;                                                   \
+    } while(0)
+
+static int ir_reserve(struct cc_ir **ir, uint32_t n) {
+    uint32_t count = *ir ? (*ir)->count : 0;
+    uint32_t capacity = *ir ? (*ir)->capacity : IR_INIT_CAPACITY;
+
+    while(count + n > capacity)
+        capacity *= 2;
+
+    if(*ir && capacity == (*ir)->capacity)
+        return 0;
+
+    struct cc_ir *new = realloc(*ir, IR_ALLOC_SIZE(capacity));
+    if(!new)
         return errno;
 
-    (*ir)->count = 0;
-    (*ir)->capacity = capacity;
+    new->count = count;
+    new->capacity = capacity;
+    *ir = new;
     return 0;
 }
 
-static int ir_push_u8(struct cc_ir **ir, uint8_t byte) {
-    if(*ir == NULL)
-        ir_reserve(ir, IR_INIT_CAPACITY);
+// reserves space for a whole instruction at once, returns the offset of its (aligned) operand
+static int ir_emit_raw(struct cc_ir **ir, uint8_t opcode, uint32_t size, uint32_t align, uint32_t *operand) {
+    uint32_t ip = *ir ? (*ir)->count : 0;
+    uint32_t at = size ? (ip + align) & ~(align - 1) : ip + 1;
 
-    if((*ir)->count + 1 > (*ir)->capacity) {
-        struct cc_ir *new = realloc((*ir), IR_ALLOC_SIZE((*ir)->capacity * 2));
-        if(!new)
-            return errno;
+    int err = ir_reserve(ir, at + size - ip);
+    if(err)
+        return err;
 
-        *ir = new;
-        (*ir)->capacity *= 2;
-    }
+    (*ir)->bytes[ip] = opcode;
+    memset((*ir)->bytes + ip + 1, 0, at - ip - 1); // padding
+    (*ir)->count = at + size;
 
-    (*ir)->bytes[(*ir)->count++] = byte;
+    *operand = at;
     return 0;
 }
 
-static int ir_push_u32(struct cc_ir **ir, uint32_t dword) {
-    int err = 0;
-    for(int i = sizeof(uint32_t) - 1; i >= 0 && !err; i--) {
-        err = ir_push_u8(ir, (dword >> (i * 8)) & 0xff);
-    }
-    return err;
+static int ir_emit(struct cc_ir **ir, uint8_t opcode) {
+    uint32_t at;
+    return ir_emit_raw(ir, opcode, 0, 1, &at);
 }
 
-static int ir_push_ptr(struct cc_ir **ir, uintptr_t ptr) {
-    int err = 0;
-    for(int i = sizeof(uintptr_t) - 1; i >= 0 && !err; i--) {
-        err = ir_push_u8(ir, (ptr >> (i * 8)) & 0xff);
+static int ir_emit_u32(struct cc_ir **ir, uint8_t opcode, uint32_t dword, uint32_t *patch) {
+    uint32_t at;
+    int err = ir_emit_raw(ir, opcode, sizeof(uint32_t), alignof(uint32_t), &at);
+    if(err)
+        return err;
+
+    ir_write_u32(*ir, at, dword);
+    if(patch)
+        *patch = at;
+    return 0;
+}
+
+static int ir_emit_ptr(struct cc_ir **ir, uint8_t opcode, uintptr_t ptr) {
+    uint32_t at;
+    int err = ir_emit_raw(ir, opcode, sizeof(uintptr_t), alignof(uintptr_t), &at);
+    if(err)
+        return err;
+
+    ir_write_ptr(*ir, at, ptr);
+    return 0;
+}
+
+static inline bool is_terminal(const struct cc_parser *p) {
+    return !is_combinator(p->type) && p->type != PARSER_LOOKUP;
+}
+
+// matches the terminal parser `p` inline without pushing a call frame,
+// `what` is added to the expected list on failure (if not NULL).
+// operand layout: [what] [u32 char | u32 lo, u32 hi | parser]
+static int ir_emit_match(struct cc_ir **ir, const char *what, struct cc_parser *p) {
+    assert(is_terminal(p));
+
+    uint32_t at;
+    int err;
+
+    switch(p->type) {
+    case PARSER_CHAR:
+        if((err = ir_emit_raw(ir, IR_MATCH_CHAR, sizeof(uintptr_t) + sizeof(uint32_t), alignof(uintptr_t), &at)))
+            return err;
+        ir_write_u32(*ir, at + sizeof(uintptr_t), p->match.ch);
+        break;
+
+    case PARSER_CHAR_RANGE:
+        if((err = ir_emit_raw(ir, IR_MATCH_RANGE, sizeof(uintptr_t) + 2 * sizeof(uint32_t), alignof(uintptr_t), &at)))
+            return err;
+        ir_write_u32(*ir, at + sizeof(uintptr_t), p->match.lo);
+        ir_write_u32(*ir, at + sizeof(uintptr_t) + sizeof(uint32_t), p->match.hi);
+        break;
+
+    default: {
+        enum cc_ir_opcode opcode = IR_MATCH;
+        if(p->type == PARSER_STRING)
+            opcode = IR_MATCH_STRING;
+        else if(p->type == PARSER_ANYOF || p->type == PARSER_ONEOF || p->type == PARSER_NONEOF)
+            opcode = IR_MATCH_SET;
+
+        if((err = ir_emit_raw(ir, opcode, 2 * sizeof(uintptr_t), alignof(uintptr_t), &at)))
+            return err;
+        ir_write_ptr(*ir, at + sizeof(uintptr_t), (uintptr_t) p);
+    } break;
     }
-    return err;
+
+    ir_write_ptr(*ir, at, (uintptr_t) what);
+    return 0;
+}
+
+// calls `p`, terminals (and terminals wrapped in an expect) get matched inline
+static int ir_emit_call(struct cc_ir **ir, struct cc_parser *p) {
+    const struct cc_parser *target = p;
+    while(target->type == PARSER_LOOKUP && target->match.lookup.target)
+        target = target->match.lookup.target;
+
+    if(is_terminal(target))
+        return ir_emit_match(ir, NULL, (struct cc_parser*) target);
+
+    if(target->type == PARSER_EXPECT && is_terminal(target->match.expect.inner))
+        return ir_emit_match(ir, target->match.expect.what, target->match.expect.inner);
+
+    // linked lookups are still called through the lookup, which names the rule in events.
+    // `call_parser` follows the link without searching the scope.
+    return ir_emit_ptr(ir, IR_CALL, (uintptr_t) p);
 }
 
 static void apply_patches(struct cc_ir *ir, const uint32_t *patches, unsigned count, uint32_t value) {
@@ -80,6 +169,474 @@ static void apply_patches(struct cc_ir *ir, const uint32_t *patches, unsigned co
         ir_write_u32(ir, patches[i], value);
 }
 
+// Grammar analysis:
+
+// upper bound of parsers visited by one analysis, larger grammars are approximated
+#define ANALYSIS_BUDGET 1024
+
+// parsers the analysis is currently descending through, used to cut cycles
+struct analysis_path {
+    const struct analysis_path *prev;
+    const struct cc_parser *p;
+    unsigned *budget;
+};
+
+static bool analysis_enter(const struct analysis_path *path, const struct cc_parser *p, struct analysis_path *here) {
+    if(!p || *path->budget == 0)
+        return false;
+
+    for(const struct analysis_path *it = path; it; it = it->prev) {
+        if(it->p == p)
+            return false;
+    }
+
+    (*path->budget)--;
+    *here = (struct analysis_path){path, p, path->budget};
+    return true;
+}
+
+static void first_set_add(struct first_set *fs, char32_t lo, char32_t hi) {
+    for(uint32_t i = first_set_index(lo); i <= first_set_index(hi); i++)
+        fs->bits[i / 32] |= 1u << (i % 32);
+}
+
+static void first_set_fill(struct first_set *fs) {
+    memset(fs->bits, 0xff, sizeof(fs->bits));
+}
+
+static bool first_set_full(const struct first_set *fs) {
+    for(unsigned i = 0; i < FIRST_SET_WORDS; i++) {
+        if(fs->bits[i] != UINT32_MAX)
+            return false;
+    }
+    return true;
+}
+
+static void first_set_of(const struct cc_parser *p, const struct analysis_path *path, struct first_set *fs);
+
+static void first_set_union(const struct cc_parser *p, const struct analysis_path *path, struct first_set *fs) {
+    struct first_set other;
+    first_set_of(p, path, &other);
+
+    fs->nullable |= other.nullable;
+    for(unsigned i = 0; i < FIRST_SET_WORDS; i++)
+        fs->bits[i] |= other.bits[i];
+}
+
+static void first_set_sequence(struct cc_parser *const *inner, unsigned n, const struct analysis_path *path, struct first_set *fs) {
+    fs->nullable = true;
+
+    for(unsigned i = 0; i < n && fs->nullable; i++) {
+        fs->nullable = false;
+        first_set_union(inner[i], path, fs);
+    }
+}
+
+// computes the code points `p` can start with. the result may be larger than the exact set,
+// parsers that are not analyzed (unlinked lookups, cycles) are assumed to start with anything.
+static void first_set_of(const struct cc_parser *p, const struct analysis_path *path, struct first_set *fs) {
+    memset(fs, 0, sizeof(struct first_set));
+
+    struct analysis_path here;
+    if(!analysis_enter(path, p, &here)) {
+        fs->nullable = true;
+        first_set_fill(fs);
+        return;
+    }
+
+    switch(p->type) {
+    case PARSER_EOF:
+    case PARSER_SOF:
+    case PARSER_PASS:
+    case PARSER_LIFT:
+    case PARSER_LIFT_VAL:
+    case PARSER_LOCATION:
+    case PARSER_NOT:
+        fs->nullable = true;
+        break;
+
+    case PARSER_FAIL:
+        break;
+
+    case PARSER_ANY:
+    case PARSER_MATCH:
+    case PARSER_NONEOF:
+        first_set_fill(fs);
+        break;
+
+    case PARSER_CHAR:
+        first_set_add(fs, p->match.ch, p->match.ch);
+        break;
+
+    case PARSER_CHAR_RANGE:
+        if(p->match.lo <= p->match.hi)
+            first_set_add(fs, p->match.lo, p->match.hi);
+        break;
+
+    case PARSER_ANYOF:
+    case PARSER_ONEOF: {
+        const struct char_class *c = p->match.list.class;
+        memcpy(fs->bits, c->ascii, sizeof(c->ascii));
+        for(size_t i = 0; i < c->n; i++)
+            first_set_add(fs, c->ranges[i].lo, c->ranges[i].hi);
+    } break;
+
+    case PARSER_REGEX: {
+        uint32_t bytes[256 / 32];
+        fs->nullable = regex_first_bytes(p->match.regex, bytes);
+        for(char32_t c = 0; c < 0x80; c++) {
+            if(bytes[c / 32] & (1u << (c % 32)))
+                first_set_add(fs, c, c);
+        }
+
+        // a lead byte may start any non-ascii character
+        for(unsigned w = 0x80 / 32; w < LEN(bytes); w++) {
+            if(bytes[w]) {
+                first_set_add(fs, 0x80, FIRST_SET_OTHER);
+                break;
+            }
+        }
+    } break;
+
+    case PARSER_STRING: {
+        // strings are compared bytewise, the lookahead decodes the same as the first character
+        char32_t first = utf8_first_cp(p->match.str);
+        if(!p->match.str[0])
+            fs->nullable = true;
+        else
+            first_set_add(fs, first, first);
+    } break;
+
+    case PARSER_EXPECT:
+        first_set_of(p->match.expect.inner, &here, fs);
+        break;
+
+    case PARSER_APPLY:
+        first_set_of(p->match.apply.inner, &here, fs);
+        break;
+
+    case PARSER_BIND:
+        first_set_of(p->match.bind.inner, &here, fs);
+        break;
+
+    case PARSER_NORETURN:
+    case PARSER_NOERROR:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        first_set_of(p->match.unary.inner, &here, fs);
+        break;
+
+    case PARSER_LOOKUP:
+        if(p->match.lookup.target)
+            first_set_of(p->match.lookup.target, &here, fs);
+        else {
+            fs->nullable = true;
+            first_set_fill(fs);
+        }
+        break;
+
+    case PARSER_MANY:
+    case PARSER_MAYBE:
+        first_set_of(p->match.unary.inner, &here, fs);
+        fs->nullable = true;
+        break;
+
+    case PARSER_REDUCE:
+        first_set_of(p->match.reduce.inner, &here, fs);
+        fs->nullable = true;
+        break;
+
+    case PARSER_COUNT:
+    case PARSER_LEAST:
+        first_set_of(p->match.unary.inner, &here, fs);
+        fs->nullable |= p->match.unary.n == 0;
+        break;
+
+    case PARSER_MANY_UNTIL: {
+        // only the end parser has to succeed
+        first_set_of(p->match.binary.rhs, &here, fs);
+        bool nullable = fs->nullable;
+        first_set_union(p->match.binary.lhs, &here, fs);
+        fs->nullable = nullable;
+    } break;
+
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        first_set_of(p->match.binary.lhs, &here, fs);
+        if(fs->nullable)
+            first_set_union(p->match.binary.rhs, &here, fs);
+        break;
+
+    case PARSER_SEQ:
+        first_set_sequence((struct cc_parser* const[]){
+            p->match.binary.lhs,
+            p->match.binary.rhs
+        }, 2, &here, fs);
+        break;
+
+    case PARSER_AND:
+        first_set_sequence(p->match.variadic.inner, p->match.variadic.n, &here, fs);
+        break;
+
+    case PARSER_EITHER:
+        first_set_of(p->match.binary.lhs, &here, fs);
+        first_set_union(p->match.binary.rhs, &here, fs);
+        break;
+
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n; i++)
+            first_set_union(p->match.variadic.inner[i], &here, fs);
+        break;
+
+    default:
+        fs->nullable = true;
+        first_set_fill(fs);
+    }
+}
+
+// error entries a variant adds when it fails on its first character
+struct expect_list {
+    unsigned n;
+    const char *what[CC_ERR_MAX_EXPECTED];
+};
+
+static bool expect_list_add(struct expect_list *l, const char *what) {
+    for(unsigned i = 0; i < l->n; i++) {
+        if(strcmp(l->what[i], what) == 0)
+            return true;
+    }
+
+    if(l->n >= LEN(l->what))
+        return false;
+
+    l->what[l->n++] = what;
+    return true;
+}
+
+// collects the error entries `p` adds when failing on a lookahead it cannot start with.
+// `p` is known not to be nullable. returns false if the entries depend on more than the lookahead.
+static bool expects_of(const struct cc_parser *p, const struct analysis_path *path, struct expect_list *l) {
+    struct analysis_path here;
+    if(!analysis_enter(path, p, &here))
+        return false;
+
+    switch(p->type) {
+    case PARSER_ANY:
+    case PARSER_STRING:
+    case PARSER_CHAR:
+    case PARSER_CHAR_RANGE:
+    case PARSER_MATCH:
+    case PARSER_ANYOF:
+    case PARSER_NONEOF:
+    case PARSER_ONEOF:
+    case PARSER_REGEX:
+    case PARSER_NOERROR:
+        return true;
+
+    case PARSER_EXPECT:
+        return expects_of(p->match.expect.inner, &here, l) && expect_list_add(l, p->match.expect.what);
+
+    case PARSER_APPLY:
+        return expects_of(p->match.apply.inner, &here, l);
+
+    case PARSER_NORETURN:
+        return expects_of(p->match.unary.inner, &here, l);
+
+    case PARSER_BIND:
+        return expects_of(p->match.bind.inner, &here, l);
+
+    case PARSER_LOOKUP:
+        return p->match.lookup.target && expects_of(p->match.lookup.target, &here, l);
+
+    case PARSER_CAPTURE:
+    case PARSER_COUNT:
+    case PARSER_LEAST:
+        return expects_of(p->match.unary.inner, &here, l);
+
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        return expects_of(p->match.binary.lhs, &here, l);
+
+    case PARSER_SEQ:
+    case PARSER_AND: {
+        struct cc_parser *first = p->type == PARSER_SEQ ? p->match.binary.lhs : p->match.variadic.inner[0];
+
+        // a nullable first parser might succeed, the entries then depend on the following ones
+        struct first_set fs;
+        first_set_of(first, &here, &fs);
+        return !fs.nullable && expects_of(first, &here, l);
+    }
+
+    case PARSER_EITHER:
+        return expects_of(p->match.binary.lhs, &here, l) && expects_of(p->match.binary.rhs, &here, l);
+
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n; i++) {
+            if(!expects_of(p->match.variadic.inner[i], &here, l))
+                return false;
+        }
+        return true;
+
+    default:
+        // memoized failures add no entries at all
+        return false;
+    }
+}
+
+// skips the variant `p` if the lookahead cannot start it, the jump target is stored in `patch`
+// (UINT32_MAX if no prediction is possible). the error entries `p` would have added are added instead.
+// operand layout: [u32 target] [u32 n | IR_PREDICT_UNKNOWN] [u32 first set[FIRST_SET_WORDS]] [what[n]]
+static int ir_emit_predict(struct cc_ir **ir, const struct cc_parser *p, uint32_t *patch) {
+    *patch = UINT32_MAX;
+
+    // inline matches fail as fast as the prediction
+    if(is_terminal(p) || (p->type == PARSER_EXPECT && is_terminal(p->match.expect.inner)))
+        return 0;
+
+    unsigned budget = ANALYSIS_BUDGET;
+    struct analysis_path root = {NULL, NULL, &budget};
+
+    struct first_set fs;
+    first_set_of(p, &root, &fs);
+    if(fs.nullable || first_set_full(&fs))
+        return 0;
+
+    budget = ANALYSIS_BUDGET;
+    struct expect_list expects = {0};
+    uint32_t n = expects_of(p, &root, &expects) ? expects.n : IR_PREDICT_UNKNOWN;
+
+    uint32_t count = n == IR_PREDICT_UNKNOWN ? 0 : n;
+
+    uint32_t at, size = (2 + FIRST_SET_WORDS) * sizeof(uint32_t);
+    int err = ir_emit_raw(ir, IR_PREDICT, size + count * sizeof(uintptr_t), alignof(uintptr_t), &at);
+    if(err)
+        return err;
+
+    ir_write_u32(*ir, at, UINT32_MAX);
+    ir_write_u32(*ir, at + sizeof(uint32_t), n);
+    for(unsigned i = 0; i < FIRST_SET_WORDS; i++)
+        ir_write_u32(*ir, at + (2 + i) * sizeof(uint32_t), fs.bits[i]);
+    for(uint32_t i = 0; i < count; i++)
+        ir_write_ptr(*ir, at + size + i * sizeof(uintptr_t), (uintptr_t) expects.what[i]);
+
+    *patch = at;
+    return 0;
+}
+
+// checks if `p` matches single characters of a fixed class and fills in the operand of IR_SCAN_CLASS
+// skips wrappers that do not change which input is matched
+static const struct cc_parser *unwrap_matcher(const struct cc_parser *p) {
+    while(p->type == PARSER_EXPECT || p->type == PARSER_NORETURN || p->type == PARSER_NOERROR)
+        p = p->type == PARSER_EXPECT ? p->match.expect.inner : p->match.unary.inner;
+    return p;
+}
+
+static bool scan_class_init(struct scan_class *sc, const struct cc_parser *p) {
+    p = unwrap_matcher(p);
+
+    memset(sc, 0, sizeof(struct scan_class));
+    sc->p = p;
+
+    switch(p->type) {
+    case PARSER_ANY:
+        memset(sc->ascii, 0xff, sizeof(sc->ascii));
+        break;
+
+    case PARSER_CHAR:
+        if(p->match.ch < 0x80)
+            sc->ascii[p->match.ch / 32] |= 1u << (p->match.ch % 32);
+        break;
+
+    case PARSER_CHAR_RANGE:
+        for(char32_t c = p->match.lo; c <= p->match.hi && c < 0x80; c++)
+            sc->ascii[c / 32] |= 1u << (c % 32);
+        break;
+
+    case PARSER_MATCH:
+        // match functions are assumed to depend on their argument only
+        for(char32_t c = 0; c < 0x80; c++) {
+            if(p->match.matchfn(c))
+                sc->ascii[c / 32] |= 1u << (c % 32);
+        }
+        break;
+
+    case PARSER_ANYOF:
+    case PARSER_ONEOF:
+        memcpy(sc->ascii, p->match.list.class->ascii, sizeof(sc->ascii));
+        break;
+
+    case PARSER_NONEOF:
+        for(unsigned i = 0; i < LEN(sc->ascii); i++)
+            sc->ascii[i] = ~p->match.list.class->ascii[i];
+        break;
+
+    default:
+        return false;
+    }
+
+    // split the ascii part into ranges for the vectorized scan
+    for(uint32_t c = 0; c < 0x80; c++) {
+        if(!(sc->ascii[c / 32] & (1u << (c % 32))))
+            continue;
+
+        if(sc->n == SCAN_MAX_RANGES) {
+            sc->n = 0;
+            break;
+        }
+
+        sc->lo[sc->n] = c;
+        while(c + 1 < 0x80 && (sc->ascii[(c + 1) / 32] & (1u << ((c + 1) % 32))))
+            c++;
+        sc->hi[sc->n++] = c;
+    }
+
+    return true;
+}
+
+// consumes the longest run of `inner` at once, only valid where the results of `inner` are never needed.
+// the jump target is stored in `patch` (UINT32_MAX if `inner` is no character class).
+// operand layout: [struct scan_class] [u32 target]
+static int ir_emit_scan(struct cc_ir **ir, const struct cc_parser *inner, uint32_t *patch) {
+    *patch = UINT32_MAX;
+
+    struct scan_class sc;
+    if(!scan_class_init(&sc, inner))
+        return 0;
+
+    uint32_t at;
+    int err = ir_emit_raw(ir, IR_SCAN_CLASS, sizeof(struct scan_class) + sizeof(uint32_t), alignof(struct scan_class), &at);
+    if(err)
+        return err;
+
+    memcpy((*ir)->bytes + at, &sc, sizeof(struct scan_class));
+    ir_write_u32(*ir, at + sizeof(struct scan_class), UINT32_MAX);
+
+    *patch = at + sizeof(struct scan_class);
+    return 0;
+}
+
+// emits IR_SCAN_UNTIL if `inner` matches any character and `end` is a literal string.
+// operand layout: [string] [u32 length]
+static int ir_emit_scan_until(struct cc_ir **ir, const struct cc_parser *inner, const struct cc_parser *end) {
+    inner = unwrap_matcher(inner);
+    end = unwrap_matcher(end);
+    if(inner->type != PARSER_ANY || end->type != PARSER_STRING)
+        return 0;
+
+    size_t len = end->match.len;
+    if(len == 0 || len > UINT32_MAX)
+        return 0;
+
+    uint32_t at;
+    int err = ir_emit_raw(ir, IR_SCAN_UNTIL, sizeof(uintptr_t) + sizeof(uint32_t), alignof(uintptr_t), &at);
+    if(err)
+        return err;
+
+    ir_write_ptr(*ir, at, (uintptr_t) end->match.str);
+    ir_write_u32(*ir, at + sizeof(uintptr_t), (uint32_t) len);
+    return 0;
+}
+
 static int generate_try(struct cc_ir **ir, struct cc_parser *inner, uint32_t *patch, bool noerror) {
     int err;
 
@@ -89,7 +646,7 @@ static int generate_try(struct cc_ir **ir, struct cc_parser *inner, uint32_t *pa
     }
 
     EMIT(ir, IR_SAVE_LOCATION);
-    EMIT_CALL(ir, (uintptr_t) inner);
+    EMIT_CALL(ir, inner);
 
     if(noerror) {
         EMIT(ir, IR_SWAP);
@@ -97,8 +654,7 @@ static int generate_try(struct cc_ir **ir, struct cc_parser *inner, uint32_t *pa
         EMIT(ir, IR_POP);
     }
 
-    patch[0] = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_SUCCESS); // jump lsuccess
+    EMIT_FORWARD_COND_JUMP(ir, IF_SUCCESS, &patch[0]); // jump lsuccess
     EMIT(ir, IR_RESTORE_LOCATION);
 
     // lsuccess:
@@ -106,9 +662,16 @@ cleanup:
     return err;
 }
 
-static int generate_many_iter(struct cc_ir **ir, struct cc_parser *inner, uint32_t extra_iter) {
+// `noreturn` is set if the results of `inner` are known to be discarded
+static int generate_many_iter(struct cc_ir **ir, struct cc_parser *inner, uint32_t extra_iter, bool noreturn) {
     int err;
 
+    uint32_t lend_patch = UINT32_MAX;
+#ifndef CC_NO_SCAN
+    if(noreturn && (err = ir_emit_scan(ir, inner, &lend_patch)))
+        goto cleanup;
+#endif
+
     EMIT_PUSH(ir, 1u);
     EMIT(ir, IR_SET_NOERROR);
 
@@ -117,7 +680,7 @@ static int generate_many_iter(struct cc_ir **ir, struct cc_parser *inner, uint32
     uint32_t lrepeat = (*ir)->count;
     EMIT(ir, IR_SAVE_LOCATION);
     EMIT(ir, IR_INCREMENT);
-    EMIT_CALL(ir, (uintptr_t) inner);
+    EMIT_CALL(ir, inner);
     EMIT_COND_JUMP(ir, lrepeat, IF_SUCCESS);
 
     EMIT(ir, IR_RESTORE_LOCATION);
@@ -128,6 +691,9 @@ static int generate_many_iter(struct cc_ir **ir, struct cc_parser *inner, uint32
     EMIT(ir, IR_SET_NOERROR);
     EMIT(ir, IR_POP);
 
+    // lend:
+    if(lend_patch != UINT32_MAX)
+        apply_patches(*ir, &lend_patch, 1, (*ir)->count);
 cleanup:
     return err;
 }
@@ -140,7 +706,7 @@ static int generate_many(struct cc_ir **ir, cc_fold_t f, struct cc_parser *inner
         EMIT(ir, IR_SET_NORETURN);
     }
 
-    if((err = generate_many_iter(ir, inner, 0u)))
+    if((err = generate_many_iter(ir, inner, 0u, !f)))
         goto cleanup;
 
     if(!f) {
@@ -154,6 +720,37 @@ cleanup:
     return err;
 }
 
+// like `generate_many`, but every result is combined with the accumulator right after it was parsed.
+// without results, the init and step functions are not run at all.
+static int generate_reduce(struct cc_ir **ir, struct cc_parser *inner) {
+    int err;
+
+    EMIT(ir, IR_REDUCE_INIT);
+
+    EMIT_PUSH(ir, 1u);
+    EMIT(ir, IR_SET_NOERROR);
+
+    uint32_t lrepeat = (*ir)->count;
+    EMIT(ir, IR_SAVE_LOCATION);
+    EMIT_CALL(ir, inner);
+
+    uint32_t lfail_patch;
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &lfail_patch);
+    EMIT(ir, IR_REDUCE);
+    EMIT_JUMP(ir, lrepeat);
+
+    uint32_t lfail = (*ir)->count;
+    apply_patches(*ir, &lfail_patch, 1, lfail);
+
+    EMIT(ir, IR_RESTORE_LOCATION);
+    EMIT(ir, IR_SET_NOERROR);
+    EMIT(ir, IR_POP);
+
+    EMIT_PUSH(ir, PARSE_SUCCESS);
+cleanup:
+    return err;
+}
+
 static int generate_many_until(struct cc_ir **ir, cc_fold_t f, struct cc_parser *inner, struct cc_parser *end) {
     int err;
 
@@ -162,6 +759,11 @@ static int generate_many_until(struct cc_ir **ir, cc_fold_t f, struct cc_parser
         EMIT(ir, IR_SET_NORETURN);
     }
 
+#ifndef CC_NO_SCAN
+    if((err = ir_emit_scan_until(ir, inner, end)))
+        goto cleanup;
+#endif
+
     EMIT_PUSH(ir, 1u);
 
     uint32_t lrepeat = (*ir)->count;
@@ -171,7 +773,7 @@ static int generate_many_until(struct cc_ir **ir, cc_fold_t f, struct cc_parser
         goto cleanup;
 
     EMIT(ir, IR_INCREMENT);
-    EMIT_CALL(ir, (uintptr_t) inner);
+    EMIT_CALL(ir, inner);
     EMIT_COND_JUMP(ir, lrepeat, IF_SUCCESS); // jump lrepeat
 
     // try the end parser again, but generate errors this time
@@ -179,8 +781,8 @@ static int generate_many_until(struct cc_ir **ir, cc_fold_t f, struct cc_parser
         goto cleanup;
 
     EMIT_PUSH(ir, PARSE_FAILURE);
-    uint32_t lrestore_patch = (*ir)->count + 1;
-    EMIT_JUMP(ir, UINT32_MAX); // jump lrestore
+    uint32_t lrestore_patch;
+    EMIT_FORWARD_JUMP(ir, &lrestore_patch); // jump lrestore
     
     EMIT_JUMP(ir, lrepeat);
 
@@ -207,11 +809,10 @@ static int generate_count_linear(struct cc_ir **ir, struct cc_parser *inner, uns
     int err;
 
     for(unsigned i = 0; i < n; i++) {
-        EMIT_CALL(ir, (uintptr_t) inner);
+        EMIT_CALL(ir, inner);
         EMIT(ir, IR_DUP);
 
-        patch[i] = (*ir)->count + 1;
-        EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+        EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &patch[i]);
         EMIT(ir, IR_POP);
     }
 
@@ -227,11 +828,10 @@ static int generate_count_iter(struct cc_ir **ir, struct cc_parser *inner, unsig
     uint32_t lrepeat = (*ir)->count;
     EMIT(ir, IR_DECREMENT);
 
-    EMIT_CALL(ir, (uintptr_t) inner);
+    EMIT_CALL(ir, inner);
     EMIT(ir, IR_DUP);
 
-    patch[0] = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &patch[0]);
     EMIT(ir, IR_POP);
 
     EMIT(ir, IR_DUP);
@@ -311,7 +911,7 @@ static int generate_least(struct cc_ir **ir, cc_fold_t f, struct cc_parser *inne
         }
     }
 
-    if((err = generate_many_iter(ir, inner, n)))
+    if((err = generate_many_iter(ir, inner, n, !f)))
         goto cleanup;
 
     EMIT_PUSH(ir, PARSE_SUCCESS);
@@ -332,6 +932,8 @@ cleanup:
 static int generate_maybe(struct cc_ir **ir, struct cc_parser *inner) {
     uint32_t patch;
     int err = generate_try(ir, inner, &patch, true);
+    if(err)
+        goto cleanup;
 
     EMIT(ir, IR_NULL_RESULT);
 
@@ -352,10 +954,9 @@ static int generate_chain(struct cc_ir **ir, cc_fold_t f, struct cc_parser *lr,
         EMIT(ir, IR_SET_NORETURN);
     }
 
-    EMIT_CALL(ir, (uintptr_t) lr);
+    EMIT_CALL(ir, lr);
     EMIT(ir, IR_DUP);
-    lrestore_patch[0] = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &lrestore_patch[0]);
     EMIT(ir, IR_POP);
 
     EMIT_PUSH(ir, 1u); // iteration counter
@@ -366,18 +967,17 @@ static int generate_chain(struct cc_ir **ir, cc_fold_t f, struct cc_parser *lr,
     EMIT_PUSH(ir, 1u);
     EMIT(ir, IR_SET_NOERROR);
 
-    EMIT_CALL(ir, (uintptr_t) op);
+    EMIT_CALL(ir, op);
     EMIT(ir, IR_SWAP);
     EMIT(ir, IR_SET_NOERROR);
     EMIT(ir, IR_POP);
 
-    uint32_t lbreak_patch = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE); // jump lbreak
+    uint32_t lbreak_patch;
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &lbreak_patch); // jump lbreak
     
-    EMIT_CALL(ir, (uintptr_t) lr);
+    EMIT_CALL(ir, lr);
     EMIT(ir, IR_DUP);
-    lrestore_patch[1] = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &lrestore_patch[1]);
 
     // opreand parser successful
     EMIT(ir, IR_POP);
@@ -418,13 +1018,13 @@ static int generate_postfix(struct cc_ir **ir, cc_fold_t f, struct cc_parser *lh
         EMIT(ir, IR_SET_NORETURN);
     }
 
-    EMIT_CALL(ir, (uintptr_t) lhs);
+    EMIT_CALL(ir, lhs);
     EMIT(ir, IR_DUP);
-    uint32_t patch = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+    uint32_t patch;
+    EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &patch);
     EMIT(ir, IR_POP);
 
-    if((err = generate_many_iter(ir, rhs, 1u)))
+    if((err = generate_many_iter(ir, rhs, 1u, !f)))
         goto cleanup;
 
     EMIT_PUSH(ir, PARSE_SUCCESS);
@@ -454,11 +1054,10 @@ static int generate_sequenced(struct cc_ir **ir, cc_fold_t f, struct cc_parser *
     }
 
     for(unsigned i = 0; i < n; i++) {
-        EMIT_CALL(ir, (uintptr_t) inner[i]);
+        EMIT_CALL(ir, inner[i]);
         EMIT(ir, IR_DUP);
 
-        patch[i] = (*ir)->count + 1;
-        EMIT_COND_JUMP(ir, UINT32_MAX, IF_FAILURE);
+        EMIT_FORWARD_COND_JUMP(ir, IF_FAILURE, &patch[i]);
         EMIT(ir, IR_POP);
     }
 
@@ -487,12 +1086,22 @@ static int generate_variants(struct cc_ir **ir, struct cc_parser *const *inner,
 
     for(unsigned i = 0; i < n; i++) {
         EMIT(ir, i ? IR_RESTORE_LOCATION : IR_SAVE_LOCATION);
-        EMIT_CALL(ir, (uintptr_t) inner[i]);
+
+        uint32_t lnext_patch = UINT32_MAX;
+#ifndef CC_NO_PREDICTION
+        if((err = ir_emit_predict(ir, inner[i], &lnext_patch)))
+            goto cleanup;
+#endif
+
+        EMIT_CALL(ir, inner[i]);
         EMIT(ir, IR_DUP);
 
-        patch[i] = (*ir)->count + 1;
-        EMIT_COND_JUMP(ir, UINT32_MAX, IF_SUCCESS);
+        EMIT_FORWARD_COND_JUMP(ir, IF_SUCCESS, &patch[i]);
         EMIT(ir, IR_POP);
+
+        // lnext:
+        if(lnext_patch != UINT32_MAX)
+            apply_patches(*ir, &lnext_patch, 1, (*ir)->count);
     }
 
     EMIT_PUSH(ir, PARSE_FAILURE);
@@ -513,7 +1122,7 @@ static int generate_not(struct cc_ir **ir, struct cc_parser *inner) {
     EMIT_PUSH(ir, 1u);
     EMIT(ir, IR_SET_NOERROR);
 
-    EMIT_CALL(ir, (uintptr_t) inner);
+    EMIT_CALL(ir, inner);
 
     EMIT(ir, IR_SWAP);
     EMIT(ir, IR_SET_NOERROR);
@@ -526,8 +1135,8 @@ static int generate_not(struct cc_ir **ir, struct cc_parser *inner) {
     EMIT(ir, IR_NEGATE);
     EMIT(ir, IR_DUP);
     
-    uint32_t patch = (*ir)->count + 1;
-    EMIT_COND_JUMP(ir, UINT32_MAX, IF_SUCCESS);
+    uint32_t patch;
+    EMIT_FORWARD_COND_JUMP(ir, IF_SUCCESS, &patch);
     EMIT(ir, IR_RESTORE_LOCATION); 
 
     uint32_t lend = (*ir)->count;
@@ -548,6 +1157,10 @@ __internal int cc_compile(struct cc_parser *p) {
         err = generate_many(&p->ir, p->fold, p->match.unary.inner);
         break;
 
+    case PARSER_REDUCE:
+        err = generate_reduce(&p->ir, p->match.reduce.inner);
+        break;
+
     case PARSER_MANY_UNTIL:
         err = generate_many_until(&p->ir, p->fold, p->match.binary.lhs, p->match.binary.rhs);
         break;
@@ -599,11 +1212,16 @@ __internal int cc_compile(struct cc_parser *p) {
         break;
 
     case PARSER_EXPECT: {
-        EMIT_CALL(&p->ir, (uintptr_t) p->match.expect.inner);
+        if(is_terminal(p->match.expect.inner)) {
+            err = ir_emit_match(&p->ir, p->match.expect.what, p->match.expect.inner);
+            break;
+        }
+
+        EMIT_CALL(&p->ir, p->match.expect.inner);
         EMIT(&p->ir, IR_DUP);
 
-        uint32_t patch = p->ir->count + 1;
-        EMIT_COND_JUMP(&p->ir, UINT32_MAX, IF_SUCCESS);
+        uint32_t patch;
+        EMIT_FORWARD_COND_JUMP(&p->ir, IF_SUCCESS, &patch);
         EMIT(&p->ir, IR_EXPECT);
 
         uint32_t lend = p->ir->count;
@@ -611,18 +1229,21 @@ __internal int cc_compile(struct cc_parser *p) {
     } break;
 
     case PARSER_APPLY: {
-        EMIT_CALL(&p->ir, (uintptr_t) p->match.apply.inner);
+        EMIT_CALL(&p->ir, p->match.apply.inner);
         EMIT(&p->ir, IR_DUP);
 
-        uint32_t lend = p->ir->count + 2 + sizeof(uint32_t);
-        EMIT_COND_JUMP(&p->ir, lend, IF_FAILURE);
+        uint32_t patch;
+        EMIT_FORWARD_COND_JUMP(&p->ir, IF_FAILURE, &patch);
         EMIT(&p->ir, IR_APPLY);
+
+        uint32_t lend = p->ir->count;
+        apply_patches(p->ir, &patch, 1, lend);
     } break;
 
     case PARSER_NORETURN:
         EMIT_PUSH(&p->ir, 1u);
         EMIT(&p->ir, IR_SET_NORETURN);
-        EMIT_CALL(&p->ir, (uintptr_t) p->match.bind.inner);
+        EMIT_CALL(&p->ir, p->match.bind.inner);
         EMIT(&p->ir, IR_SWAP);
         EMIT(&p->ir, IR_SET_NORETURN);
         EMIT(&p->ir, IR_POP);
@@ -632,15 +1253,38 @@ __internal int cc_compile(struct cc_parser *p) {
     case PARSER_NOERROR:
         EMIT_PUSH(&p->ir, 1u);
         EMIT(&p->ir, IR_SET_NOERROR); 
-        EMIT_CALL(&p->ir, (uintptr_t) p->match.bind.inner);
+        EMIT_CALL(&p->ir, p->match.bind.inner);
         EMIT(&p->ir, IR_SWAP);
         EMIT(&p->ir, IR_SET_NOERROR);
         EMIT(&p->ir, IR_POP);
         break;
 
+    case PARSER_MEMO:
+        // memoization itself is done when calling the parser
+        EMIT_CALL(&p->ir, p->match.unary.inner);
+        break;
+
+    case PARSER_CAPTURE: {
+        // the result of the inner parser is replaced by the span of input it consumed
+        EMIT_PUSH(&p->ir, 1u);
+        EMIT(&p->ir, IR_SET_NORETURN);
+        EMIT_CALL(&p->ir, p->match.unary.inner);
+        EMIT(&p->ir, IR_SWAP);
+        EMIT(&p->ir, IR_SET_NORETURN);
+        EMIT(&p->ir, IR_POP);
+        EMIT(&p->ir, IR_DUP);
+
+        uint32_t patch;
+        EMIT_FORWARD_COND_JUMP(&p->ir, IF_FAILURE, &patch);
+        EMIT(&p->ir, IR_CAPTURE);
+
+        uint32_t lend = p->ir->count;
+        apply_patches(p->ir, &patch, 1, lend);
+    } break;
+
     case PARSER_BIND:
         EMIT(&p->ir, IR_PUSH_BINDING);
-        EMIT_CALL(&p->ir, (uintptr_t) p->match.bind.inner);
+        EMIT_CALL(&p->ir, p->match.bind.inner);
         EMIT(&p->ir, IR_POP_BINDING);
         break;
 
@@ -649,6 +1293,12 @@ __internal int cc_compile(struct cc_parser *p) {
         unreachable();
     }
 
+    if(err)
+        goto cleanup;
+
+    // every IR sequence ends with an explicit return, so the interpreter never has to check for its end
+    EMIT(&p->ir, IR_RETURN);
+
     return 0;
 cleanup:
     free(p->ir);
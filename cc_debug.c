@@ -26,6 +26,7 @@ static const char *parser_type_string_table[] = {
     E(PARSER_ANYOF),
     E(PARSER_NONEOF),
     E(PARSER_ONEOF),
+    E(PARSER_REGEX),
     E(PARSER_EXPECT),
     E(PARSER_APPLY),
     E(PARSER_NOT),
@@ -38,9 +39,12 @@ static const char *parser_type_string_table[] = {
     E(PARSER_MAYBE),
     E(PARSER_CHAIN),
     E(PARSER_POSTFIX),
+    E(PARSER_REDUCE),
     E(PARSER_LOCATION),
     E(PARSER_NORETURN),
     E(PARSER_NOERROR),
+    E(PARSER_MEMO),
+    E(PARSER_CAPTURE),
     E(PARSER_LOOKUP),
     E(PARSER_BIND),
 };
@@ -140,6 +144,10 @@ static int dump_parser(struct cc_parser *p, FILE *f, size_t d) {
         err = print_indented(f, d, "]\n");
     } break;
 
+    case PARSER_REGEX:
+        err = print_indented(f, d, "automaton = <%p>\n", (void*) p->match.regex);
+        break;
+
     case PARSER_EXPECT:
         break;
 
@@ -181,6 +189,8 @@ const char *ir_str_opcode(enum cc_ir_opcode opcode) {
             return "fold";
         case IR_APPLY:
             return "apply";
+        case IR_CAPTURE:
+            return "capture";
         case IR_EXPECT:
             return "expect";
         case IR_PUSH_BINDING:
@@ -191,6 +201,10 @@ const char *ir_str_opcode(enum cc_ir_opcode opcode) {
             return "null_result";
         case IR_POP_RESULT:
             return "pop_result";
+        case IR_REDUCE_INIT:
+            return "reduce_init";
+        case IR_REDUCE:
+            return "reduce";
         case IR_JUMP:
             return "jump";
         case IR_JUMP_IF_NONZERO:
@@ -199,6 +213,22 @@ const char *ir_str_opcode(enum cc_ir_opcode opcode) {
             return "if_success";
         case IR_JUMP_IF_FAILURE:
             return "if_failure";
+        case IR_PREDICT:
+            return "predict";
+        case IR_MATCH:
+            return "match";
+        case IR_MATCH_CHAR:
+            return "match_char";
+        case IR_MATCH_RANGE:
+            return "match_range";
+        case IR_MATCH_SET:
+            return "match_set";
+        case IR_MATCH_STRING:
+            return "match_string";
+        case IR_SCAN_CLASS:
+            return "scan_class";
+        case IR_SCAN_UNTIL:
+            return "scan_until";
         case IR_SAVE_LOCATION:
             return "save_location";
         case IR_RESTORE_LOCATION:
@@ -230,12 +260,14 @@ int ir_dump(const struct cc_ir *ir, FILE *f) {
 
         switch(ir->bytes[ip++]) {
         case IR_PUSH:
+            ip = IR_ALIGN(ip, uint32_t);
             uint32_t c = ir_read_u32(ir, ip);
             ip += sizeof(uint32_t);
             fprintf(f, " %u", c);
             break;
 
         case IR_CALL:
+            ip = IR_ALIGN(ip, uintptr_t);
             uintptr_t p = ir_read_ptr(ir, ip);
             ip += sizeof(uintptr_t);
             fprintf(f, " <%p>", (void*) p);
@@ -245,10 +277,75 @@ int ir_dump(const struct cc_ir *ir, FILE *f) {
         case IR_JUMP_IF_NONZERO:
         case IR_JUMP_IF_SUCCESS:
         case IR_JUMP_IF_FAILURE:
+            ip = IR_ALIGN(ip, uint32_t);
             c = ir_read_u32(ir, ip);
             ip += sizeof(uint32_t);
             fprintf(f, " <%04x>", c);
             break;
+
+        case IR_PREDICT: {
+            ip = IR_ALIGN(ip, uintptr_t);
+            fprintf(f, " <%04x>", ir_read_u32(ir, ip));
+
+            uint32_t n = ir_read_u32(ir, ip + sizeof(uint32_t));
+            ip += (2 + FIRST_SET_WORDS) * sizeof(uint32_t);
+            if(n == IR_PREDICT_UNKNOWN) {
+                fprintf(f, " (noerror)");
+                break;
+            }
+
+            for(uint32_t i = 0; i < n; i++, ip += sizeof(uintptr_t))
+                fprintf(f, "%s%s", i ? ", " : " (expect ", (const char*) ir_read_ptr(ir, ip));
+            if(n)
+                fprintf(f, ")");
+        } break;
+
+        case IR_MATCH:
+        case IR_MATCH_CHAR:
+        case IR_MATCH_RANGE:
+        case IR_MATCH_SET:
+        case IR_MATCH_STRING: {
+            uint8_t match = ir->bytes[ip - 1];
+            ip = IR_ALIGN(ip, uintptr_t);
+            const char *what = (const char*) ir_read_ptr(ir, ip);
+            ip += sizeof(uintptr_t);
+
+            char8_t lo_buf[CC_UTF8_ENCODE_PRINTABLE_MAX], hi_buf[CC_UTF8_ENCODE_PRINTABLE_MAX];
+            switch(match) {
+            case IR_MATCH_CHAR:
+                utf8_encode_printable(ir_read_u32(ir, ip), lo_buf);
+                ip += sizeof(uint32_t);
+                fprintf(f, " %s", lo_buf);
+                break;
+            case IR_MATCH_RANGE:
+                utf8_encode_printable(ir_read_u32(ir, ip), lo_buf);
+                utf8_encode_printable(ir_read_u32(ir, ip + sizeof(uint32_t)), hi_buf);
+                ip += 2 * sizeof(uint32_t);
+                fprintf(f, " %s - %s", lo_buf, hi_buf);
+                break;
+            default:
+                fprintf(f, " <%p>", (void*) ir_read_ptr(ir, ip));
+                ip += sizeof(uintptr_t);
+                break;
+            }
+
+            if(what)
+                fprintf(f, " (expect %s)", what);
+        } break;
+
+        case IR_SCAN_CLASS:
+            ip = IR_ALIGN(ip, struct scan_class);
+            fprintf(f, " <%p> <%04x>", (void*) ir_read_ptr(ir, ip), ir_read_u32(ir, ip + sizeof(struct scan_class)));
+            ip += sizeof(struct scan_class) + sizeof(uint32_t);
+            break;
+
+        case IR_SCAN_UNTIL: {
+            ip = IR_ALIGN(ip, uintptr_t);
+            const char *str = (const char*) ir_read_ptr(ir, ip);
+            fprintf(f, " \"%.*s\"", (int) ir_read_u32(ir, ip + sizeof(uintptr_t)), str);
+            ip += sizeof(uintptr_t) + sizeof(uint32_t);
+        } break;
+
         default:
             break;
         }
@@ -267,15 +364,21 @@ void lazy_debug_dump(const struct cc_lazy *lazy, FILE *f) {
 
     char8_t ch_buf[CC_UTF8_ENCODE_PRINTABLE_MAX];
 
-    switch(lazy->type) {
+    switch(lazy_type(lazy)) {
     case LAZY_VALUE:
-        fprintf(f, "<%p>", LAZY_DOWNCAST(lazy, struct cc_lazy_value)->value);
+        fprintf(f, "<%p>", lazy_get_value(lazy));
         break;
     case LAZY_INLINE:
         fprintf(f, "<%p>", LAZY_DOWNCAST(lazy, struct cc_lazy_inline)->value);
         break;
+    case LAZY_SPAN:
+        fprintf(f, "span(%zu)", LAZY_DOWNCAST(lazy, struct cc_lazy_span)->span.len);
+        break;
+    case LAZY_TEXT:
+        fprintf(f, "text(%zu)", LAZY_DOWNCAST(lazy, struct cc_lazy_span)->span.len);
+        break;
     case LAZY_CHAR:
-        utf8_encode_printable(LAZY_DOWNCAST(lazy, struct cc_lazy_char)->ch, ch_buf);
+        utf8_encode_printable(lazy_get_char(lazy), ch_buf);
         fprintf(f, "%s", ch_buf);
         break;
     case LAZY_TERMINAL:
@@ -301,6 +404,13 @@ void lazy_debug_dump(const struct cc_lazy *lazy, FILE *f) {
         lazy_debug_dump(apply->value, f);
         fprintf(f, ")");
         break;
+    case LAZY_REDUCE:
+        struct cc_lazy_reduce *reduce = LAZY_DOWNCAST(lazy, struct cc_lazy_reduce);
+        if(reduce->acc.err)
+            fprintf(f, "reduce(<error>)");
+        else
+            fprintf(f, "reduce(<%p>)", reduce->acc.out);
+        break;
     default:
         fprintf(f, "<unknown>");
     }
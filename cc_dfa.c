@@ -0,0 +1,1261 @@
+#include <ccombinator.h>
+
+#include "internal.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#define CP_MAX 0x10ffff
+
+// Code point sets:
+
+struct cp_ranges {
+    size_t n;
+    size_t capacity;
+    struct { char32_t lo, hi; } *r;
+};
+
+#define CP_RANGES_INIT {0, 0, NULL}
+#define CP_RANGES_INIT_CAP 16
+
+static int cp_ranges_add(struct cp_ranges *set, char32_t lo, char32_t hi) {
+    if(lo > hi)
+        return 0;
+
+    if(set->n + 1 > set->capacity) {
+        size_t new_capacity = MAX(set->capacity * 2, CP_RANGES_INIT_CAP);
+        void *new = realloc(set->r, new_capacity * sizeof(*set->r));
+        if(!new)
+            return errno;
+
+        set->r = new;
+        set->capacity = new_capacity;
+    }
+
+    set->r[set->n].lo = lo;
+    set->r[set->n].hi = hi;
+    set->n++;
+    return 0;
+}
+
+static int cp_range_cmp(const void *a, const void *b) {
+    char32_t x = *(const char32_t*) a, y = *(const char32_t*) b;
+    return (x > y) - (x < y);
+}
+
+// sorts the ranges and merges overlapping or adjacent ones
+static void cp_ranges_normalize(struct cp_ranges *set) {
+    if(set->n == 0)
+        return;
+
+    qsort(set->r, set->n, sizeof(*set->r), cp_range_cmp);
+
+    size_t k = 0;
+    for(size_t i = 1; i < set->n; i++) {
+        if(set->r[i].lo <= set->r[k].hi + 1)
+            set->r[k].hi = MAX(set->r[k].hi, set->r[i].hi);
+        else
+            set->r[++k] = set->r[i];
+    }
+
+    set->n = k + 1;
+}
+
+// adds the complement of `other` to `set`
+static int cp_ranges_add_negated(struct cp_ranges *set, struct cp_ranges *other) {
+    cp_ranges_normalize(other);
+
+    char32_t next = 0;
+    int err;
+    for(size_t i = 0; i < other->n; i++) {
+        if(other->r[i].lo > next && (err = cp_ranges_add(set, next, other->r[i].lo - 1)))
+            return err;
+        next = other->r[i].hi + 1;
+    }
+
+    return next <= CP_MAX ? cp_ranges_add(set, next, CP_MAX) : 0;
+}
+
+static int cp_ranges_add_class(struct cp_ranges *set, const struct char_class *c) {
+    int err;
+    for(char32_t cp = 0; cp < 0x80; cp++) {
+        if(char_class_has(c, cp) && (err = cp_ranges_add(set, cp, cp)))
+            return err;
+    }
+
+    for(size_t i = 0; i < c->n; i++) {
+        if((err = cp_ranges_add(set, c->ranges[i].lo, c->ranges[i].hi)))
+            return err;
+    }
+
+    return 0;
+}
+
+static int cp_ranges_add_matching(struct cp_ranges *set, int (*f)(char32_t)) {
+    int err;
+    char32_t lo = 0;
+    bool in = false;
+
+    // match functions are assumed to depend on their argument only
+    for(char32_t cp = 0; cp <= CP_MAX; cp++) {
+        bool m = f(cp);
+        if(m && !in)
+            lo = cp;
+        else if(!m && in && (err = cp_ranges_add(set, lo, cp - 1)))
+            return err;
+        in = m;
+    }
+
+    return in ? cp_ranges_add(set, lo, CP_MAX) : 0;
+}
+
+static inline const struct cc_parser *unwrap(const struct cc_parser *p) {
+    while(p->type == PARSER_EXPECT || p->type == PARSER_NORETURN || p->type == PARSER_NOERROR)
+        p = p->type == PARSER_EXPECT ? p->match.expect.inner : p->match.unary.inner;
+    return p;
+}
+
+// `(!set .)` as generated for negated selections
+static inline bool is_negated_set(const struct cc_parser *p) {
+    return p->type == PARSER_SEQ
+        && unwrap(p->match.binary.lhs)->type == PARSER_NOT
+        && unwrap(p->match.binary.rhs)->type == PARSER_ANY;
+}
+
+// adds the code points `p` matches as a single character to `set`, returns ENOTSUP if `p` is no character set
+static int set_of(const struct cc_parser *p, struct cp_ranges *set, unsigned depth) {
+    if(depth == 0)
+        return ENOTSUP;
+
+    int err = 0;
+
+    switch(p->type) {
+    case PARSER_ANY:
+        return cp_ranges_add(set, 0, CP_MAX);
+    case PARSER_CHAR:
+        return cp_ranges_add(set, p->match.ch, p->match.ch);
+    case PARSER_CHAR_RANGE:
+        return cp_ranges_add(set, p->match.lo, MIN(p->match.hi, CP_MAX));
+    case PARSER_MATCH:
+        return cp_ranges_add_matching(set, p->match.matchfn);
+    case PARSER_ANYOF:
+    case PARSER_ONEOF:
+        return cp_ranges_add_class(set, p->match.list.class);
+    case PARSER_NONEOF: {
+        struct cp_ranges other = CP_RANGES_INIT;
+        if(!(err = cp_ranges_add_class(&other, p->match.list.class)))
+            err = cp_ranges_add_negated(set, &other);
+        free(other.r);
+        return err;
+    }
+
+    case PARSER_EXPECT:
+        return set_of(p->match.expect.inner, set, depth - 1);
+    case PARSER_NORETURN:
+    case PARSER_NOERROR:
+        return set_of(p->match.unary.inner, set, depth - 1);
+
+    case PARSER_EITHER:
+        if((err = set_of(p->match.binary.lhs, set, depth - 1)))
+            return err;
+        return set_of(p->match.binary.rhs, set, depth - 1);
+
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n && !err; i++)
+            err = set_of(p->match.variadic.inner[i], set, depth - 1);
+        return err;
+
+    case PARSER_SEQ: {
+        if(!is_negated_set(p))
+            return ENOTSUP;
+
+        struct cp_ranges other = CP_RANGES_INIT;
+        if(!(err = set_of(unwrap(p->match.binary.lhs)->match.unary.inner, &other, depth - 1)))
+            err = cp_ranges_add_negated(set, &other);
+        free(other.r);
+        return err;
+    }
+
+    default:
+        return ENOTSUP;
+    }
+}
+
+// UTF-8 byte sequences:
+
+// a range of code points that encodes to the byte ranges `lo[i]..hi[i]`
+struct utf8_seq {
+    uint8_t n;
+    uint8_t lo[4], hi[4];
+};
+
+static uint8_t utf8_put(char32_t cp, uint8_t out[4]) {
+    uint8_t n = utf8_cp_length(cp);
+    static const uint8_t lead[] = {0x00, 0x00, 0xc0, 0xe0, 0xf0};
+
+    for(uint8_t i = n - 1; i > 0; i--, cp >>= 6)
+        out[i] = 0x80 | (cp & 0x3f);
+    out[0] = lead[n] | cp;
+    return n;
+}
+
+// splits `lo..hi` into ranges that encode to the same number of bytes with independent byte ranges
+static int utf8_sequences(char32_t lo, char32_t hi, struct utf8_seq **seqs, size_t *n, size_t *capacity) {
+    static const char32_t length_bounds[] = {0x7f, 0x7ff, 0xffff};
+
+    struct { char32_t lo, hi; } stack[32];
+    unsigned top = 0;
+
+#define SPLIT_OFF(l, h) do { stack[top].lo = (l); stack[top].hi = (h); top++; } while(0)
+
+    SPLIT_OFF(lo, hi);
+    while(top > 0) {
+        top--;
+        lo = stack[top].lo;
+        hi = stack[top].hi;
+
+    next:
+        // surrogates are never encoded
+        if(lo <= 0xdfff && hi >= 0xd800) {
+            if(hi > 0xdfff)
+                SPLIT_OFF(0xe000, hi);
+            if(lo >= 0xd800)
+                continue;
+            hi = 0xd7ff;
+        }
+
+        for(unsigned i = 0; i < LEN(length_bounds); i++) {
+            if(lo <= length_bounds[i] && hi > length_bounds[i]) {
+                SPLIT_OFF(length_bounds[i] + 1, hi);
+                hi = length_bounds[i];
+                goto next;
+            }
+        }
+
+        if(hi >= 0x80) {
+            // the continuation bytes must cover their whole range below the first differing one
+            for(unsigned i = 1; i < 4; i++) {
+                char32_t m = (1u << (6 * i)) - 1;
+                if((lo & ~m) == (hi & ~m))
+                    continue;
+
+                if(lo & m) {
+                    SPLIT_OFF((lo | m) + 1, hi);
+                    hi = lo | m;
+                    goto next;
+                }
+
+                if((hi & m) != m) {
+                    SPLIT_OFF(hi & ~m, hi);
+                    hi = (hi & ~m) - 1;
+                    goto next;
+                }
+            }
+        }
+
+        if(*n + 1 > *capacity) {
+            size_t new_capacity = MAX(*capacity * 2, CP_RANGES_INIT_CAP);
+            struct utf8_seq *new = realloc(*seqs, new_capacity * sizeof(struct utf8_seq));
+            if(!new)
+                return errno;
+
+            *seqs = new;
+            *capacity = new_capacity;
+        }
+
+        struct utf8_seq *seq = &(*seqs)[(*n)++];
+        seq->n = utf8_put(lo, seq->lo);
+        utf8_put(hi, seq->hi);
+    }
+
+#undef SPLIT_OFF
+
+    return 0;
+}
+
+// Thompson NFA:
+
+enum nfa_opcode : uint8_t {
+    NFA_BYTE,   // consume a byte in `lo..hi`
+    NFA_SPLIT,  // continue at `x` and `y`
+    NFA_JUMP,   // continue at `x`
+    NFA_SOF,    // continue at the start of the input only
+    NFA_EOF,    // continue at the end of the input only
+    NFA_MATCH,  // the last instruction
+};
+
+struct nfa_inst {
+    enum nfa_opcode op;
+    uint8_t lo, hi;
+    uint32_t x, y;
+};
+
+struct nfa {
+    uint32_t count;
+    uint32_t capacity;
+    struct nfa_inst *insts;
+};
+
+#define NFA_INIT_CAP 64
+#define NFA_MAX_INSTS 0x10000
+#define NFA_MAX_DEPTH 256
+#define NFA_NONE UINT32_MAX
+
+#define NFA_INST(...) ((struct nfa_inst){__VA_ARGS__})
+
+static int nfa_emit(struct nfa *nfa, struct nfa_inst inst, uint32_t *at) {
+    if(nfa->count >= NFA_MAX_INSTS)
+        return E2BIG;
+
+    if(nfa->count + 1 > nfa->capacity) {
+        uint32_t new_capacity = MAX(nfa->capacity * 2, NFA_INIT_CAP);
+        struct nfa_inst *new = realloc(nfa->insts, new_capacity * sizeof(struct nfa_inst));
+        if(!new)
+            return errno;
+
+        nfa->insts = new;
+        nfa->capacity = new_capacity;
+    }
+
+    if(at)
+        *at = nfa->count;
+    nfa->insts[nfa->count++] = inst;
+    return 0;
+}
+
+// alternatives are chained by splits, every one but the last jumps to the end afterwards.
+// the jumps are linked through their targets until the end is known.
+struct nfa_alt {
+    uint32_t split;
+    uint32_t jumps;
+};
+
+static int nfa_alt_begin(struct nfa *nfa, struct nfa_alt *alt, bool last) {
+    return last ? 0 : nfa_emit(nfa, NFA_INST(.op = NFA_SPLIT, .x = nfa->count + 1, .y = NFA_NONE), &alt->split);
+}
+
+static int nfa_alt_end(struct nfa *nfa, struct nfa_alt *alt, bool last) {
+    if(last) {
+        for(uint32_t at = alt->jumps, next; at != NFA_NONE; at = next) {
+            next = nfa->insts[at].x;
+            nfa->insts[at].x = nfa->count;
+        }
+        return 0;
+    }
+
+    int err = nfa_emit(nfa, NFA_INST(.op = NFA_JUMP, .x = alt->jumps), &alt->jumps);
+    nfa->insts[alt->split].y = nfa->count;
+    return err;
+}
+
+static int nfa_compile_set(struct nfa *nfa, struct cp_ranges *set) {
+    cp_ranges_normalize(set);
+
+    struct utf8_seq *seqs = NULL;
+    size_t n = 0, capacity = 0;
+    int err = 0;
+
+    for(size_t i = 0; i < set->n && !err; i++)
+        err = utf8_sequences(set->r[i].lo, MIN(set->r[i].hi, CP_MAX), &seqs, &n, &capacity);
+
+    if(!err && n == 0)
+        err = nfa_emit(nfa, NFA_INST(.op = NFA_BYTE, .lo = 1, .hi = 0), NULL); // never matches
+
+    struct nfa_alt alt = {NFA_NONE, NFA_NONE};
+    for(size_t i = 0; i < n && !err; i++) {
+        bool last = i + 1 == n;
+        if((err = nfa_alt_begin(nfa, &alt, last)))
+            break;
+
+        for(uint8_t j = 0; j < seqs[i].n && !err; j++)
+            err = nfa_emit(nfa, NFA_INST(.op = NFA_BYTE, .lo = seqs[i].lo[j], .hi = seqs[i].hi[j]), NULL);
+
+        if(!err)
+            err = nfa_alt_end(nfa, &alt, last);
+    }
+
+    free(seqs);
+    return err;
+}
+
+static int nfa_compile(struct nfa *nfa, const struct cc_parser *p, unsigned depth);
+
+static int nfa_compile_alt(struct nfa *nfa, struct cc_parser *const *ps, unsigned n, unsigned depth) {
+    struct nfa_alt alt = {NFA_NONE, NFA_NONE};
+    int err;
+
+    for(unsigned i = 0; i < n; i++) {
+        bool last = i + 1 == n;
+        if((err = nfa_alt_begin(nfa, &alt, last)) || (err = nfa_compile(nfa, ps[i], depth)) || (err = nfa_alt_end(nfa, &alt, last)))
+            return err;
+    }
+
+    return 0;
+}
+
+static int nfa_compile_star(struct nfa *nfa, const struct cc_parser *p, unsigned depth) {
+    uint32_t split = NFA_NONE;
+    int err;
+    if((err = nfa_emit(nfa, NFA_INST(.op = NFA_SPLIT, .x = nfa->count + 1, .y = NFA_NONE), &split))
+        || (err = nfa_compile(nfa, p, depth))
+        || (err = nfa_emit(nfa, NFA_INST(.op = NFA_JUMP, .x = split), NULL)))
+        return err;
+
+    nfa->insts[split].y = nfa->count;
+    return 0;
+}
+
+// appends the instructions matching `p`, which continue at the next instruction afterwards
+static int nfa_compile(struct nfa *nfa, const struct cc_parser *p, unsigned depth) {
+    if(!p)
+        return EINVAL;
+    if(depth == 0)
+        return ENOTSUP;
+
+    depth--;
+
+    int err = 0;
+    uint32_t at = NFA_NONE;
+
+    switch(p->type) {
+    case PARSER_PASS:
+    case PARSER_LIFT:
+    case PARSER_LIFT_VAL:
+    case PARSER_LOCATION:
+        return 0;
+
+    case PARSER_FAIL:
+        return nfa_emit(nfa, NFA_INST(.op = NFA_BYTE, .lo = 1, .hi = 0), NULL);
+    case PARSER_SOF:
+        return nfa_emit(nfa, NFA_INST(.op = NFA_SOF), NULL);
+    case PARSER_EOF:
+        return nfa_emit(nfa, NFA_INST(.op = NFA_EOF), NULL);
+
+    case PARSER_STRING:
+        for(size_t i = 0; i < p->match.len && !err; i++)
+            err = nfa_emit(nfa, NFA_INST(.op = NFA_BYTE, .lo = p->match.str[i], .hi = p->match.str[i]), NULL);
+        return err;
+
+    case PARSER_EXPECT:
+        return nfa_compile(nfa, p->match.expect.inner, depth);
+    case PARSER_APPLY:
+        return nfa_compile(nfa, p->match.apply.inner, depth);
+    case PARSER_NORETURN:
+    case PARSER_NOERROR:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        return nfa_compile(nfa, p->match.unary.inner, depth);
+
+    case PARSER_ANY:
+    case PARSER_CHAR:
+    case PARSER_CHAR_RANGE:
+    case PARSER_MATCH:
+    case PARSER_ANYOF:
+    case PARSER_NONEOF:
+    case PARSER_ONEOF:
+    case PARSER_EITHER:
+    case PARSER_OR:
+    case PARSER_SEQ: {
+        // selections of single characters become one set of byte sequences
+        struct cp_ranges set = CP_RANGES_INIT;
+        if(!(err = set_of(p, &set, depth + 1)))
+            err = nfa_compile_set(nfa, &set);
+        free(set.r);
+        if(err != ENOTSUP)
+            return err;
+    } break;
+
+    default:
+        break;
+    }
+
+    switch(p->type) {
+    case PARSER_SEQ:
+        if((err = nfa_compile(nfa, p->match.binary.lhs, depth)))
+            return err;
+        return nfa_compile(nfa, p->match.binary.rhs, depth);
+
+    case PARSER_AND:
+        for(unsigned i = 0; i < p->match.variadic.n && !err; i++)
+            err = nfa_compile(nfa, p->match.variadic.inner[i], depth);
+        return err;
+
+    case PARSER_EITHER: {
+        struct cc_parser *both[] = {p->match.binary.lhs, p->match.binary.rhs};
+        return nfa_compile_alt(nfa, both, LEN(both), depth);
+    }
+    case PARSER_OR:
+        return nfa_compile_alt(nfa, p->match.variadic.inner, p->match.variadic.n, depth);
+
+    case PARSER_MANY:
+        return nfa_compile_star(nfa, p->match.unary.inner, depth);
+
+    case PARSER_MAYBE:
+        if((err = nfa_emit(nfa, NFA_INST(.op = NFA_SPLIT, .x = nfa->count + 1, .y = NFA_NONE), &at))
+            || (err = nfa_compile(nfa, p->match.unary.inner, depth)))
+            return err;
+        nfa->insts[at].y = nfa->count;
+        return 0;
+
+    case PARSER_COUNT:
+    case PARSER_LEAST:
+        for(unsigned i = 0; i < p->match.unary.n && !err; i++)
+            err = nfa_compile(nfa, p->match.unary.inner, depth);
+        if(err || p->type == PARSER_COUNT)
+            return err;
+        return nfa_compile_star(nfa, p->match.unary.inner, depth);
+
+    case PARSER_CHAIN:
+        // a (op a)*
+        if((err = nfa_compile(nfa, p->match.binary.lhs, depth))
+            || (err = nfa_emit(nfa, NFA_INST(.op = NFA_SPLIT, .x = nfa->count + 1, .y = NFA_NONE), &at))
+            || (err = nfa_compile(nfa, p->match.binary.rhs, depth))
+            || (err = nfa_compile(nfa, p->match.binary.lhs, depth))
+            || (err = nfa_emit(nfa, NFA_INST(.op = NFA_JUMP, .x = at), NULL)))
+            return err;
+        nfa->insts[at].y = nfa->count;
+        return 0;
+
+    case PARSER_POSTFIX:
+        if((err = nfa_compile(nfa, p->match.binary.lhs, depth)))
+            return err;
+        return nfa_compile_star(nfa, p->match.binary.rhs, depth);
+
+    default:
+        return ENOTSUP;
+    }
+}
+
+// Literals:
+
+#define LITERAL_MAX 64
+
+struct literal {
+    size_t len;
+    size_t before; // maximum number of bytes in front of the literal, SIZE_MAX if unbounded
+    char8_t str[LITERAL_MAX];
+};
+
+static inline size_t add_bounded(size_t a, size_t b) {
+    return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+// returns the maximum number of bytes `p` can consume, SIZE_MAX if unbounded
+static size_t max_length(const struct cc_parser *p, unsigned depth) {
+    if(depth == 0)
+        return SIZE_MAX;
+
+    depth--;
+
+    size_t n = 0;
+
+    switch(p->type) {
+    case PARSER_PASS:
+    case PARSER_LIFT:
+    case PARSER_LIFT_VAL:
+    case PARSER_LOCATION:
+    case PARSER_SOF:
+    case PARSER_EOF:
+    case PARSER_NOT:
+    case PARSER_FAIL:
+        return 0;
+
+    case PARSER_STRING:
+        return p->match.len;
+    case PARSER_CHAR:
+        return utf8_cp_length(p->match.ch);
+    case PARSER_ANY:
+    case PARSER_CHAR_RANGE:
+    case PARSER_MATCH:
+    case PARSER_ANYOF:
+    case PARSER_NONEOF:
+    case PARSER_ONEOF:
+        return 4;
+
+    case PARSER_EXPECT:
+        return max_length(p->match.expect.inner, depth);
+    case PARSER_APPLY:
+        return max_length(p->match.apply.inner, depth);
+    case PARSER_NORETURN:
+    case PARSER_NOERROR:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+    case PARSER_MAYBE:
+        return max_length(p->match.unary.inner, depth);
+
+    case PARSER_SEQ:
+        return add_bounded(max_length(p->match.binary.lhs, depth), max_length(p->match.binary.rhs, depth));
+    case PARSER_AND:
+        for(unsigned i = 0; i < p->match.variadic.n; i++)
+            n = add_bounded(n, max_length(p->match.variadic.inner[i], depth));
+        return n;
+
+    case PARSER_EITHER:
+        return MAX(max_length(p->match.binary.lhs, depth), max_length(p->match.binary.rhs, depth));
+    case PARSER_OR:
+        for(unsigned i = 0; i < p->match.variadic.n; i++)
+            n = MAX(n, max_length(p->match.variadic.inner[i], depth));
+        return n;
+
+    case PARSER_COUNT:
+        n = max_length(p->match.unary.inner, depth);
+        return n == 0 ? 0 : n > SIZE_MAX / p->match.unary.n ? SIZE_MAX : n * p->match.unary.n;
+
+    case PARSER_MANY:
+    case PARSER_LEAST:
+        return max_length(p->match.unary.inner, depth) == 0 ? 0 : SIZE_MAX;
+
+    default:
+        return SIZE_MAX;
+    }
+}
+
+static void literal_append(struct literal *l, const char8_t *str, size_t len) {
+    // a prefix of a required literal is required as well
+    len = MIN(len, LITERAL_MAX - l->len);
+    memcpy(l->str + l->len, str, len);
+    l->len += len;
+}
+
+static inline void literal_pick(struct literal *best, const struct literal *l) {
+    if(l->len > best->len || (l->len == best->len && l->before < best->before))
+        *best = *l;
+}
+
+// stores a literal every match of `p` contains in `required`, returns true if `p` matches exactly this literal
+static bool literal_of(const struct cc_parser *p, struct literal *required, unsigned depth) {
+    required->len = 0;
+    required->before = 0;
+    if(depth == 0)
+        return false;
+
+    depth--;
+
+    switch(p->type) {
+    case PARSER_PASS:
+    case PARSER_LIFT:
+    case PARSER_LIFT_VAL:
+    case PARSER_LOCATION:
+    case PARSER_SOF:
+    case PARSER_EOF:
+        return true;
+
+    case PARSER_STRING:
+        literal_append(required, p->match.str, p->match.len);
+        return p->match.len <= LITERAL_MAX;
+
+    case PARSER_CHAR: {
+        uint8_t buf[4];
+        literal_append(required, buf, utf8_put(p->match.ch, buf));
+        return required->len == utf8_cp_length(p->match.ch);
+    }
+
+    case PARSER_EXPECT:
+        return literal_of(p->match.expect.inner, required, depth);
+    case PARSER_APPLY:
+        return literal_of(p->match.apply.inner, required, depth);
+    case PARSER_NORETURN:
+    case PARSER_NOERROR:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        return literal_of(p->match.unary.inner, required, depth);
+
+    case PARSER_SEQ:
+    case PARSER_AND: {
+        struct cc_parser *both[] = {p->match.binary.lhs, p->match.binary.rhs};
+        struct cc_parser *const *inner = p->type == PARSER_SEQ ? both : p->match.variadic.inner;
+        unsigned n = p->type == PARSER_SEQ ? LEN(both) : p->match.variadic.n;
+
+        // consecutive exact literals are concatenated
+        struct literal run = {0}, l;
+        size_t offset = 0; // maximum length of the parsers in front of `inner[i]`
+        bool exact = true;
+        for(unsigned i = 0; i < n; i++) {
+            size_t max = max_length(inner[i], depth);
+            if(literal_of(inner[i], &l, depth) && run.len + l.len <= LITERAL_MAX) {
+                if(run.len == 0)
+                    run.before = offset;
+                literal_append(&run, l.str, l.len);
+                offset = add_bounded(offset, max);
+                continue;
+            }
+
+            exact = false;
+            literal_pick(required, &run);
+            l.before = add_bounded(offset, l.before);
+            literal_pick(required, &l);
+            run.len = 0;
+            offset = add_bounded(offset, max);
+        }
+
+        literal_pick(required, &run);
+        return exact;
+    }
+
+    case PARSER_COUNT:
+    case PARSER_LEAST:
+        if(p->match.unary.n > 0)
+            literal_of(p->match.unary.inner, required, depth);
+        return false;
+
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        literal_of(p->match.binary.lhs, required, depth);
+        return false;
+
+    default:
+        return false;
+    }
+}
+
+// Lazy DFA:
+
+struct dfa_state {
+    bool accept;     // the nfa has matched
+    bool accept_eof; // the nfa matches if the input ends here
+    uint32_t hash;
+    uint32_t n;      // number of nfa instructions, 0 for the dead state
+    uint32_t *pcs;   // sorted byte, eof and match instructions
+    struct dfa_state *next[]; // by byte class, NULL until computed
+};
+
+// states are only ever added and published atomically, so matching runs without locking once they are cached
+#define DFA_MAX_STATES 4096
+#define DFA_TABLE_INIT_CAP 64
+
+struct regex {
+    struct nfa nfa;
+
+    uint8_t classes[256]; // bytes no instruction distinguishes share a class
+    unsigned nclasses;
+
+    struct dfa_state *start[2]; // in the middle and at the start of the input
+
+    pthread_mutex_t lock; // guards everything below
+    uint32_t nstates;
+    struct dfa_state **states;
+
+    uint32_t table_capacity;
+    struct dfa_state **table;
+
+    // scratch space of the nfa simulation
+    uint64_t *visited;
+    uint32_t *stack;
+    uint32_t *set;
+
+    // prefilter of `regex_search` for matches after the start of the input
+    struct literal prefix;   // every match starts with `prefix`
+    struct literal required; // every match contains `required`
+    bool first[256];         // bytes a match can start with
+};
+
+static inline bool visited(struct regex *re, uint32_t pc) {
+    return re->visited[pc / 64] & (1ull << (pc % 64));
+}
+
+// marks the epsilon closure of `pc`
+static void closure(struct regex *re, uint32_t pc, bool sof, bool eof) {
+    uint32_t top = 0;
+    if(visited(re, pc))
+        return;
+
+    re->visited[pc / 64] |= 1ull << (pc % 64);
+    re->stack[top++] = pc;
+
+    while(top > 0) {
+        pc = re->stack[--top];
+        const struct nfa_inst *inst = &re->nfa.insts[pc];
+        uint32_t to[2], n = 0;
+
+        switch(inst->op) {
+        case NFA_SPLIT:
+            to[n++] = inst->y;
+            to[n++] = inst->x;
+            break;
+        case NFA_JUMP:
+            to[n++] = inst->x;
+            break;
+        case NFA_SOF:
+            if(sof)
+                to[n++] = pc + 1;
+            break;
+        case NFA_EOF:
+            if(eof)
+                to[n++] = pc + 1;
+            break;
+        default:
+            break;
+        }
+
+        for(uint32_t i = 0; i < n; i++) {
+            if(visited(re, to[i]))
+                continue;
+            re->visited[to[i] / 64] |= 1ull << (to[i] % 64);
+            re->stack[top++] = to[i];
+        }
+    }
+}
+
+static inline void clear_visited(struct regex *re) {
+    memset(re->visited, 0, (re->nfa.count + 63) / 64 * sizeof(uint64_t));
+}
+
+// collects the marked instructions a state consists of into `re->set`
+static uint32_t collect(struct regex *re) {
+    uint32_t n = 0;
+    for(uint32_t w = 0; w < (re->nfa.count + 63) / 64; w++) {
+        for(uint64_t bits = re->visited[w]; bits; bits &= bits - 1) {
+            uint32_t pc = w * 64 + __builtin_ctzll(bits);
+            enum nfa_opcode op = re->nfa.insts[pc].op;
+            if(op == NFA_BYTE || op == NFA_EOF || op == NFA_MATCH)
+                re->set[n++] = pc;
+        }
+    }
+
+    return n;
+}
+
+static uint32_t hash_set(const uint32_t *pcs, uint32_t n) {
+    uint32_t h = 2166136261u;
+    for(uint32_t i = 0; i < n; i++)
+        h = (h ^ pcs[i]) * 16777619u;
+    return h;
+}
+
+static inline size_t state_size(const struct regex *re, uint32_t n) {
+    return sizeof(struct dfa_state) + re->nclasses * sizeof(struct dfa_state*) + n * sizeof(uint32_t);
+}
+
+// builds the state of the instructions in `re->set` into `st`
+static void state_init(struct regex *re, struct dfa_state *st, uint32_t n, bool sof) {
+    memset(st, 0, state_size(re, 0));
+    st->n = n;
+    st->hash = hash_set(re->set, n);
+    st->pcs = (uint32_t*) &st->next[re->nclasses];
+    memcpy(st->pcs, re->set, n * sizeof(uint32_t));
+
+    uint32_t match = re->nfa.count - 1;
+    st->accept = n > 0 && st->pcs[n - 1] == match;
+
+    // pending end-of-input assertions
+    clear_visited(re);
+    for(uint32_t i = 0; i < n; i++) {
+        if(re->nfa.insts[st->pcs[i]].op == NFA_EOF)
+            closure(re, st->pcs[i] + 1, sof, true);
+    }
+    st->accept_eof = st->accept || visited(re, match);
+}
+
+static struct dfa_state *table_find(struct regex *re, uint32_t hash, uint32_t n) {
+    if(re->table_capacity == 0)
+        return NULL;
+
+    for(uint32_t i = hash & (re->table_capacity - 1); re->table[i]; i = (i + 1) & (re->table_capacity - 1)) {
+        struct dfa_state *st = re->table[i];
+        if(st->hash == hash && st->n == n && memcmp(st->pcs, re->set, n * sizeof(uint32_t)) == 0)
+            return st;
+    }
+
+    return NULL;
+}
+
+static int table_insert(struct regex *re, struct dfa_state *st) {
+    if((re->nstates + 1) * 2 > re->table_capacity) {
+        uint32_t new_capacity = MAX(re->table_capacity * 2, DFA_TABLE_INIT_CAP);
+        struct dfa_state **new = calloc(new_capacity, sizeof(struct dfa_state*));
+        if(!new)
+            return errno;
+
+        for(uint32_t i = 0; i < re->table_capacity; i++) {
+            if(!re->table[i])
+                continue;
+            uint32_t j = re->table[i]->hash & (new_capacity - 1);
+            while(new[j])
+                j = (j + 1) & (new_capacity - 1);
+            new[j] = re->table[i];
+        }
+
+        free(re->table);
+        re->table = new;
+        re->table_capacity = new_capacity;
+    }
+
+    uint32_t i = st->hash & (re->table_capacity - 1);
+    while(re->table[i])
+        i = (i + 1) & (re->table_capacity - 1);
+    re->table[i] = st;
+    re->states[re->nstates++] = st;
+    return 0;
+}
+
+// returns the cached state of the instructions in `re->set`, adds it if it is new
+static struct dfa_state *state_intern(struct regex *re, uint32_t n, bool sof) {
+    struct dfa_state *st = table_find(re, hash_set(re->set, n), n);
+    if(st)
+        return st;
+
+    if(!(st = malloc(state_size(re, n))))
+        return NULL;
+
+    state_init(re, st, n, sof);
+    if(table_insert(re, st)) {
+        free(st);
+        return NULL;
+    }
+
+    return st;
+}
+
+// computes the instructions following `st` on `byte` into `re->set`
+static uint32_t step(struct regex *re, const struct dfa_state *st, uint8_t byte) {
+    clear_visited(re);
+    for(uint32_t i = 0; i < st->n; i++) {
+        const struct nfa_inst *inst = &re->nfa.insts[st->pcs[i]];
+        if(inst->op == NFA_BYTE && byte >= inst->lo && byte <= inst->hi)
+            closure(re, st->pcs[i] + 1, false, false);
+    }
+
+    return collect(re);
+}
+
+// returns the successor of `st` on `byte`. once the cache is full, states are built into `*transient` without caching them.
+static struct dfa_state *transition(struct regex *re, struct dfa_state *st, uint8_t byte, struct dfa_state **transient) {
+    struct dfa_state **slot = &st->next[re->classes[byte]];
+
+    pthread_mutex_lock(&re->lock);
+
+    struct dfa_state *next = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if(next)
+        goto unlock;
+
+    uint32_t n = step(re, st, byte);
+    if(!(next = table_find(re, hash_set(re->set, n), n)) && re->nstates < DFA_MAX_STATES)
+        next = state_intern(re, n, false);
+    else if(!next) {
+        // the transient state may be `st` itself, which is no longer needed
+        if((next = realloc(*transient, state_size(re, re->nfa.count)))) {
+            *transient = next;
+            state_init(re, next, n, false);
+        }
+        goto unlock;
+    }
+
+    if(next && st != *transient)
+        __atomic_store_n(slot, next, __ATOMIC_RELEASE);
+
+unlock:
+    pthread_mutex_unlock(&re->lock);
+    return next;
+}
+
+__internal int regex_match(struct regex *re, bool sof, regex_input_t input, void *userp, size_t *len) {
+    struct dfa_state *st = re->start[sof], *transient = NULL, *next;
+    size_t avail, i = 0, matched = st->accept ? 0 : SIZE_MAX;
+    const char8_t *p = input(userp, STREAM_LOOKAHEAD, &avail);
+
+    for(;;) {
+        for(; i < avail; i++) {
+            if(!(next = __atomic_load_n(&st->next[re->classes[p[i]]], __ATOMIC_ACQUIRE))
+                && !(next = transition(re, st, p[i], &transient))) {
+                free(transient);
+                return -ENOMEM;
+            }
+
+            st = next;
+            if(st->accept)
+                matched = i + 1;
+            else if(st->n == 0)
+                goto done;
+        }
+
+        p = input(userp, i + STREAM_LOOKAHEAD, &avail);
+        if(i == avail) {
+            if(st->accept_eof)
+                matched = i;
+            break;
+        }
+    }
+
+done:
+    free(transient);
+
+    if(matched == SIZE_MAX)
+        return PARSE_FAILURE;
+
+    *len = matched;
+    return PARSE_SUCCESS;
+}
+
+__internal bool regex_first_bytes(struct regex *re, uint32_t bytes[256 / 32]) {
+    memset(bytes, 0, 256 / 8);
+
+    for(unsigned k = 0; k < LEN(re->start); k++) {
+        const struct dfa_state *st = re->start[k];
+        for(uint32_t i = 0; i < st->n; i++) {
+            const struct nfa_inst *inst = &re->nfa.insts[st->pcs[i]];
+            for(unsigned b = inst->lo; inst->op == NFA_BYTE && b <= inst->hi; b++)
+                bytes[b / 32] |= 1u << (b % 32);
+        }
+    }
+
+    return re->start[0]->accept_eof || re->start[1]->accept_eof;
+}
+
+// Search:
+
+// returns the first occurrence of `lit` in `p`
+static const char8_t *find_literal(const char8_t *p, size_t n, const struct literal *lit) {
+    if(lit->len > n)
+        return NULL;
+    if(lit->len == 1)
+        return memchr(p, lit->str[0], n);
+
+    size_t i = 0, last = n - lit->len;
+
+#if defined(__SSE2__)
+    // compare the first and last byte of the literal at 16 positions at once
+    __m128i first = _mm_set1_epi8((char) lit->str[0]), final = _mm_set1_epi8((char) lit->str[lit->len - 1]);
+    for(; i + 16 <= last + 1; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (p + i));
+        __m128i b = _mm_loadu_si128((const __m128i*) (p + i + lit->len - 1));
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, final)));
+
+        for(; mask; mask &= mask - 1) {
+            size_t k = i + __builtin_ctz(mask);
+            if(memcmp(p + k + 1, lit->str + 1, lit->len - 2) == 0)
+                return p + k;
+        }
+    }
+#endif
+
+    for(const char8_t *found; i <= last && (found = memchr(p + i, lit->str[0], last - i + 1)); i = found - p + 1) {
+        if(memcmp(found, lit->str, lit->len) == 0)
+            return found;
+    }
+
+    return NULL;
+}
+
+// returns the next position at or after `i` a match may start at, or `size + 1` if there is none
+static size_t prefilter(const struct regex *re, const char8_t *buf, size_t size, size_t i, size_t *required_at) {
+#ifndef CC_NO_SCAN
+    const char8_t *found;
+    if(re->prefix.len > 0) {
+        found = find_literal(buf + i, size - i, &re->prefix);
+        return found ? (size_t) (found - buf) : size + 1;
+    }
+
+    if(re->required.len > 0) {
+        if(*required_at == SIZE_MAX || *required_at < i) {
+            if(!(found = find_literal(buf + i, size - i, &re->required)))
+                return size + 1;
+            *required_at = found - buf;
+        }
+
+        // skip the positions too far in front of the next occurrence
+        if(re->required.before < *required_at - i) {
+            for(i = *required_at - re->required.before; i < size && CC_UTF8_IS_CONT(buf[i]); i++);
+        }
+    }
+#else
+    (void) required_at;
+#endif
+
+    while(i < size && !re->first[buf[i]])
+        i++;
+    return i;
+}
+
+struct buffer_input {
+    const char8_t *buf;
+    size_t size;
+    size_t off;
+};
+
+static const char8_t *buffer_input(void *userp, size_t, size_t *avail) {
+    struct buffer_input *in = userp;
+    *avail = in->size - in->off;
+    return in->buf + in->off;
+}
+
+__internal int regex_search(struct regex *re, const char8_t *buf, size_t size, size_t from, size_t *start, size_t *len) {
+    struct buffer_input in = {buf, size, from};
+    int res;
+
+    // the start of the input has a state of its own, the prefilter only describes the other positions
+    if(from == 0) {
+        if((res = regex_match(re, true, buffer_input, &in, len)) != PARSE_FAILURE) {
+            *start = 0;
+            return res;
+        }
+
+        for(from = 1; from < size && CC_UTF8_IS_CONT(buf[from]); from++);
+    }
+
+    if(re->start[0]->n == 0)
+        return PARSE_FAILURE;
+
+    size_t required_at = SIZE_MAX;
+    for(size_t i = from; i <= size; i++) {
+        if((i = prefilter(re, buf, size, i, &required_at)) > size)
+            break;
+
+        in.off = i;
+        if((res = regex_match(re, false, buffer_input, &in, len)) != PARSE_FAILURE) {
+            *start = i;
+            return res;
+        }
+
+        // matches only start at character boundaries
+        while(i + 1 < size && CC_UTF8_IS_CONT(buf[i + 1]))
+            i++;
+    }
+
+    return PARSE_FAILURE;
+}
+
+// collects the literal every match after the start of the input begins with from the automaton
+static void compute_prefix(struct regex *re) {
+    struct dfa_state *st = re->start[0], *transient = NULL;
+
+    while(st && st->n > 0 && !st->accept && re->prefix.len < LITERAL_MAX) {
+        const struct nfa_inst *inst = &re->nfa.insts[st->pcs[0]];
+        if(inst->op != NFA_BYTE || inst->lo != inst->hi)
+            break;
+
+        bool single = true;
+        for(uint32_t i = 1; i < st->n && single; i++) {
+            const struct nfa_inst *other = &re->nfa.insts[st->pcs[i]];
+            single = other->op == NFA_BYTE && other->lo == inst->lo && other->hi == inst->hi;
+        }
+
+        if(!single)
+            break;
+
+        re->prefix.str[re->prefix.len++] = inst->lo;
+        st = transition(re, st, inst->lo, &transient);
+    }
+
+    free(transient);
+}
+
+static void compute_first(struct regex *re) {
+    const struct dfa_state *st = re->start[0];
+    for(uint32_t i = 0; i < st->n; i++) {
+        const struct nfa_inst *inst = &re->nfa.insts[st->pcs[i]];
+        for(unsigned b = inst->lo; inst->op == NFA_BYTE && b <= inst->hi; b++)
+            re->first[b] = true;
+    }
+
+    if(st->accept)
+        memset(re->first, true, sizeof(re->first));
+}
+
+static void compute_classes(struct regex *re) {
+    bool cut[257] = {0};
+    for(uint32_t i = 0; i < re->nfa.count; i++) {
+        const struct nfa_inst *inst = &re->nfa.insts[i];
+        if(inst->op == NFA_BYTE && inst->lo <= inst->hi) {
+            cut[inst->lo] = true;
+            cut[inst->hi + 1] = true;
+        }
+    }
+
+    unsigned c = 0;
+    for(unsigned b = 0; b < 256; b++) {
+        if(b > 0 && cut[b])
+            c++;
+        re->classes[b] = c;
+    }
+
+    re->nclasses = c + 1;
+}
+
+__internal struct regex *regex_compile(const struct cc_parser *p) {
+    struct regex *re = calloc(1, sizeof(struct regex));
+    if(!re)
+        return NULL;
+
+    int err;
+    if((err = nfa_compile(&re->nfa, p, NFA_MAX_DEPTH)) || (err = nfa_emit(&re->nfa, NFA_INST(.op = NFA_MATCH), NULL)))
+        goto cleanup;
+
+    compute_classes(re);
+
+    uint32_t count = re->nfa.count;
+    if(!(re->visited = calloc((count + 63) / 64, sizeof(uint64_t)))
+        || !(re->stack = malloc(count * sizeof(uint32_t)))
+        || !(re->set = malloc(count * sizeof(uint32_t)))
+        || !(re->states = malloc(DFA_MAX_STATES * sizeof(struct dfa_state*)))) {
+        err = errno;
+        goto cleanup;
+    }
+
+    if((err = pthread_mutex_init(&re->lock, NULL)))
+        goto cleanup;
+
+    clear_visited(re);
+    closure(re, 0, false, false);
+    if(!(re->start[0] = state_intern(re, collect(re), false))) {
+        err = ENOMEM;
+        goto cleanup_lock;
+    }
+
+    // the start of the input gets a state of its own, it is never reached by a transition
+    clear_visited(re);
+    closure(re, 0, true, false);
+    uint32_t n = collect(re);
+    if(!(re->start[1] = malloc(state_size(re, n)))) {
+        err = errno;
+        goto cleanup_lock;
+    }
+
+    state_init(re, re->start[1], n, true);
+
+    compute_prefix(re);
+    compute_first(re);
+    if(re->prefix.len == 0)
+        literal_of(p, &re->required, NFA_MAX_DEPTH);
+
+    return re;
+
+cleanup_lock:
+    pthread_mutex_destroy(&re->lock);
+    re->start[1] = NULL;
+cleanup:
+    for(uint32_t i = 0; i < re->nstates; i++)
+        free(re->states[i]);
+    free(re->states);
+    free(re->table);
+    free(re->visited);
+    free(re->stack);
+    free(re->set);
+    free(re->nfa.insts);
+    free(re);
+    errno = err;
+    return NULL;
+}
+
+__internal void regex_free(struct regex *re) {
+    if(!re)
+        return;
+
+    pthread_mutex_destroy(&re->lock);
+
+    for(uint32_t i = 0; i < re->nstates; i++)
+        free(re->states[i]);
+    free(re->start[1]);
+    free(re->states);
+    free(re->table);
+    free(re->visited);
+    free(re->stack);
+    free(re->set);
+    free(re->nfa.insts);
+    free(re);
+}
@@ -7,8 +7,16 @@
 #include <errno.h>
 #include <locale.h>
 #include <memory.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 #define SCOPE_INIT_CAP 16
 
@@ -16,22 +24,67 @@
 #define CC_STATE_FLAG_EOF       0x01
 #define CC_STATE_FLAG_NOERROR   0x02
 #define CC_STATE_FLAG_NORETURN  0x04
+#define CC_STATE_FLAG_MEMOIZE   0x08
+
+// state flags that influence the result of a parser and are therefore part of a memoization key
+#define MEMO_KEY_FLAGS (CC_STATE_FLAG_NOERROR | CC_STATE_FLAG_NORETURN)
+
+#define MEMO_INIT_CAP_MIN 64
+#define MEMO_INIT_CAP_MAX (1 << 16)
+
+#if defined(__GNUC__) && !defined(CC_NO_THREADED_DISPATCH)
+    #define CC_THREADED_DISPATCH
+#endif
 
-#define FAIL_WITH(e, s, x, c) do {                  \
-        int err = new_error((e), (s), (x), (c));    \
+#define FAIL_WITH(e, s, p) do {                     \
+        int err = new_error((e), (s), (p), NULL);   \
         return err ? -err : PARSE_FAILURE;        \
     } while(0)
 
+struct frame_stack;
+
+#define LINE_INDEX_INIT_CAP 64
+
+// newlines in the input since the start of the parse, line and column numbers are only computed from them when needed
+struct line_index {
+    struct cc_location start;  // location the parse started at
+    struct cc_location window; // location of the first byte in the window of a streaming source
+    size_t scanned;            // input before this byte offset is indexed
+    size_t count;
+    size_t capacity;
+    size_t *newlines;          // byte offsets of the newlines
+};
+
+#define EVENT_BUFFER_INIT_CAP 64
+
+// events of `cc_parse_events`, which are only delivered once no parser can backtrack past them anymore
+struct event_buffer {
+    cc_event_t handler; // NULL if no events are emitted
+    void *userp;
+    size_t base;  // number of events delivered so far
+    size_t count; // number of events emitted so far, the ones from `base` are buffered
+    size_t capacity;
+    struct cc_event *items;
+};
+
 struct cc_state {
     int flags;
     const struct cc_source *src;
-    struct cc_location loc;
+    size_t pos; // byte offset of the current location
+
+    const struct frame_stack *frames; // call stack of the current parse
+    struct cc_error *error; // error report of the current parse
+    const struct cc_parser *failed; // parser whose failure is reported, its message is only built by `report_error`
+    bool rejected; // the last parse failed because the input did not match, not because of an action
+    struct line_index lines;
 
     struct cc_hashtable scope;
+    struct cc_arena arena; // holds all lazy nodes of the current parse
+    struct event_buffer events;
 };
 
 static inline bool is_sof(struct cc_state *s) {
-    return s->loc.byte_off == 0;
+    return s->pos == 0;
 }
 
 static inline bool is_eof(struct cc_state *s) {
@@ -57,26 +110,130 @@ static inline bool set_flag(struct cc_state *s, int flag, bool state) {
     return before;
 }
 
+static void stream_fill(struct cc_state *s, size_t n);
+
+// returns the number of input bytes available at the current location.
+// streaming sources try to make at least `n` bytes available first.
+static inline size_t input_available(struct cc_state *s, size_t n) {
+    const struct cc_source *src = s->src;
+
+    if(src->stream.read && s->pos - src->buffer_off + n > src->buffer_size && !src->stream.eof)
+        stream_fill(s, n);
+
+    return src->buffer_size - (s->pos - src->buffer_off);
+}
+
+static inline const char8_t *input_at(struct cc_state *s, size_t byte_off) {
+    assert(byte_off >= s->src->buffer_off && "input already discarded");
+    return s->src->buffer + (byte_off - s->src->buffer_off);
+}
+
 static inline char32_t peek_at(struct cc_state *s) {
-    if(s->loc.byte_off >= s->src->buffer_size) {
+    if(input_available(s, STREAM_LOOKAHEAD) == 0) {
         s->flags |= CC_STATE_FLAG_EOF;
         return EOF;
     }
 
-    return utf8_first_cp(s->src->buffer + s->loc.byte_off);
+    s->flags &= ~CC_STATE_FLAG_EOF; // reset after backtracking
+
+    return utf8_first_cp(input_at(s, s->pos));
+}
+
+static inline void lines_reset(struct cc_state *s, struct cc_location start) {
+    s->lines.start = s->lines.window = start;
+    s->lines.scanned = start.byte_off;
+    s->lines.count = 0;
+}
+
+// records the newlines up to the byte offset `off`, which must still be in the window
+static int lines_scan(struct cc_state *s, size_t off) {
+    struct line_index *idx = &s->lines;
+    size_t from = idx->scanned, n = off - from;
+    const char8_t *p = input_at(s, from), *nl;
+
+    for(size_t i = 0; (nl = memchr(p + i, '\n', n - i)); i = nl - p + 1) {
+        if(idx->count + 1 > idx->capacity) {
+            size_t new_capacity = MAX(idx->capacity * 2, LINE_INDEX_INIT_CAP);
+            size_t *new = realloc(idx->newlines, new_capacity * sizeof(size_t));
+            if(!new) {
+                idx->scanned = from + (nl - p);
+                return errno;
+            }
+
+            idx->newlines = new;
+            idx->capacity = new_capacity;
+        }
+
+        idx->newlines[idx->count++] = from + (nl - p);
+    }
+
+    idx->scanned = off;
+    return 0;
+}
+
+// computes the line and column number of the byte offset `off`
+static int lines_resolve(struct cc_state *s, size_t off, struct cc_location *loc) {
+    struct line_index *idx = &s->lines;
+
+    int err;
+    if(off > idx->scanned && (err = lines_scan(s, off)))
+        return err;
+
+    // number of newlines before `off`
+    size_t lo = 0, hi = idx->count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(idx->newlines[mid] < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    size_t line_start = lo ? idx->newlines[lo - 1] + 1 : idx->start.byte_off;
+    uint32_t col = lo ? 1 : idx->start.col;
+
+    size_t buffer_off = s->src->buffer_off;
+    if(off < buffer_off) {
+        // input that was already discarded by a streaming source only counts in bytes
+        col += off - line_start;
+    }
+    else {
+        if(line_start < buffer_off) {
+            col = idx->window.col;
+            line_start = buffer_off;
+        }
+
+        // continuation bytes do not start a new character
+        for(const char8_t *p = input_at(s, line_start), *end = input_at(s, off); p < end; p++)
+            col += (*p & 0xc0) != 0x80;
+    }
+
+    *loc = (struct cc_location){.col = col, .line = idx->start.line + lo, .byte_off = off};
+    return 0;
+}
+
+// fills in the line and column of the error location, unless they are already known
+static int lines_resolve_error(struct cc_state *s, struct cc_error *e) {
+    if(e->loc.line != 0 || (!e->failure && !s->failed && e->num_expected == 0))
+        return 0;
+
+    return lines_resolve(s, e->loc.byte_off, &e->loc);
 }
 
 static inline int state_init(struct cc_state *s) {
     memset(s, 0, sizeof(struct cc_state));
 
     s->flags = CC_STATE_FLAGS_DEFAULT;
-    s->loc = CC_LOCATION_DEFAULT;
+    s->arena = (struct cc_arena) ARENA_INIT;
 
     return hashtable_init(&s->scope, SCOPE_INIT_CAP);
 }
 
 static inline void state_free(struct cc_state *s) {
+    free(s->lines.newlines);
+    free(s->events.items);
     hashtable_free(&s->scope);
+    arena_free(&s->arena);
 }
 
 static inline int scope_push(struct cc_state *s, struct cc_binding *binding) {
@@ -91,36 +248,36 @@ static struct cc_parser *scope_lookup(struct cc_state *s, const char *name) {
     return hashtable_get(&s->scope, name);
 }
 
-static int new_error(struct cc_error *e, struct cc_state *s, const char *msg, bool copy) {
-    if(is_noerror(s))
-        return 0;
+// errors are only kept at the farthest position a parser failed at outside `noerror` sections, earlier ones are dropped
+static inline bool error_behind(const struct cc_state *s, const struct cc_error *e) {
+    return (e->failure || s->failed || e->num_expected) && s->pos < e->loc.byte_off;
+}
 
-    if(!e)
+// records the failure of `p` at the current position.
+// as most failures are discarded by backtracking, the message is only built by `report_error` unless `msg` is given.
+static int new_error(struct cc_error *e, struct cc_state *s, const struct cc_parser *p, char *msg) {
+    if(!e) {
+        free(msg);
         return EINVAL;
+    }
 
+    if(is_noerror(s) || error_behind(s, e)) {
+        free(msg);
+        return 0;
+    }
+
+    free((void*) e->failure);
     memset(e, 0, sizeof(struct cc_error));
 
-    e->loc = s->loc;
+    e->loc = (struct cc_location){.byte_off = s->pos}; // line and column are resolved later
     e->received = peek_at(s);
-    if(copy && !(e->failure = strdup(msg)))
-        return errno;
-    else if(!copy)
-        e->failure = msg;
-
+    e->failure = msg;
+    s->failed = msg ? NULL : p;
     return 0;
 }
 
 static inline char32_t advance_char(struct cc_state *s, char32_t ch) {
-    s->loc.byte_off += utf8_cp_length(ch);
-
-    if(ch == '\n') {
-        s->loc.line++;
-        s->loc.col = 1;
-    }
-    else {
-        s->loc.col++;
-    }
-
+    s->pos += utf8_cp_length(ch);
     return ch;
 }
 
@@ -140,8 +297,7 @@ static int char_result(struct cc_result *r, char32_t ch) {
     return 0;
 }
 
-static int string_result(struct cc_result *r, const char8_t *str) {
-    size_t len = strlen((const char*) str);
+static int string_result(struct cc_result *r, const char8_t *str, size_t len) {
     int err = allocate_string((char8_t**) &r->out, len);
     if(err)
         return err;
@@ -157,8 +313,8 @@ static int match_char(struct cc_state *s, char32_t ch, struct cc_lazy **r) {
 
     advance_char(s, ch);
 
-    if(r != NULL && !is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-        return -ENOMEM;
+    if(r != NULL && !is_noreturn(s))
+        *r = lazy_char(next);
 
     return PARSE_SUCCESS;
 }
@@ -170,8 +326,8 @@ static int match_char_func(struct cc_state *s, int(*f)(char32_t), struct cc_lazy
 
     advance_char(s, next);
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-        return -ENOMEM;
+    if(!is_noreturn(s))
+        *r = lazy_char(next);
     
     return PARSE_SUCCESS;
 }
@@ -194,8 +350,8 @@ static int match_any(struct cc_state *s, struct cc_lazy **r) {
 
     advance_char(s, next);
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-        return -ENOMEM;
+    if(!is_noreturn(s))
+        *r = lazy_char(next);
 
     return PARSE_SUCCESS;
 }
@@ -207,88 +363,155 @@ static int match_range(struct cc_state *s, char32_t lo, char32_t hi, struct cc_l
 
     advance_char(s, next);
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-        return -ENOMEM;
+    if(!is_noreturn(s))
+        *r = lazy_char(next);
 
     return PARSE_SUCCESS;
 }
 
-static int match_oneof(struct cc_state *s, const char32_t *chars, size_t n, struct cc_lazy **r) {
+static int match_class(struct cc_state *s, const struct char_class *c, bool negate, struct cc_lazy **r) {
     char32_t next = peek_at(s);
-    if(is_eof(s))
+    if(is_eof(s) || char_class_has(c, next) == negate)
         return PARSE_FAILURE;
 
-    bool one_found = false;
-    for(size_t i = 0; i < n; i++) {
-        if(next == chars[i]) {
-            if(one_found)
-                return PARSE_FAILURE;
-            one_found = true;
-        }
-    }
-    
-    if(!one_found)
+    advance_char(s, next);
+
+    if(!is_noreturn(s))
+        *r = lazy_char(next);
+
+    return PARSE_SUCCESS;
+}
+
+static int match_string(struct cc_state *s, struct cc_parser *p, struct cc_lazy **r) {
+    // compare the whole string at once, so streaming sources cannot move their window in between
+    size_t len = p->match.len;
+    if(input_available(s, len) < len || memcmp(input_at(s, s->pos), p->match.str, len) != 0)
         return PARSE_FAILURE;
 
-    advance_char(s, next);
+    s->pos += len;
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
+    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_terminal(&s->arena, s->pos, p))))
         return -ENOMEM;
 
     return PARSE_SUCCESS;
 }
 
-static int match_anyof(struct cc_state *s, const char32_t *chars, size_t n, struct cc_lazy **r) {
-    char32_t next = peek_at(s);
-    if(is_eof(s))
-        return PARSE_FAILURE;
+// consumes the input up to the next occurrence of `str`, or up to the end of the input.
+// `str` starts with an ascii character or a lead byte, so it can only be found at character boundaries.
+static void scan_until(struct cc_state *s, const char8_t *str, size_t len) {
+    size_t avail;
+    while((avail = input_available(s, len)) > 0) {
+        const char8_t *p = input_at(s, s->pos);
+        const char8_t *found = memchr(p, str[0], avail);
+        if(!found) {
+            s->pos += avail;
+            continue;
+        }
 
-    for(size_t i = 0; i < n; i++) {
-        if(next == chars[i]) {
-            advance_char(s, next);
+        size_t k = found - p;
+        if(k + len > avail) {
+            // fewer than `len` bytes are left of the whole input
+            if(k == 0) {
+                s->pos += avail;
+                break;
+            }
 
-            if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-                return -ENOMEM;
+            // make the rest of the candidate available first
+            s->pos += k;
+            continue;
+        }
 
-            return PARSE_SUCCESS;
+        if(memcmp(found, str, len) == 0) {
+            s->pos += k;
+            break;
         }
+
+        s->pos += k + 1;
+    }
+}
+
+#if defined(__AVX2__)
+    #define SCAN_VECTOR_SIZE 32
+    #define scan_vector __m256i
+    #define scan_load(p) _mm256_loadu_si256((const __m256i*) (p))
+    #define scan_set1(x) _mm256_set1_epi8((char) (x))
+    #define scan_zero() _mm256_setzero_si256()
+    #define scan_in_range(v, lo, hi) _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8((v), scan_set1(lo)), scan_set1((hi) - (lo))), scan_zero())
+    #define scan_or(a, b) _mm256_or_si256((a), (b))
+    #define scan_movemask(v) ((uint32_t) _mm256_movemask_epi8(v))
+#elif defined(__SSE2__)
+    #define SCAN_VECTOR_SIZE 16
+    #define scan_vector __m128i
+    #define scan_load(p) _mm_loadu_si128((const __m128i*) (p))
+    #define scan_set1(x) _mm_set1_epi8((char) (x))
+    #define scan_zero() _mm_setzero_si128()
+    #define scan_in_range(v, lo, hi) _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8((v), scan_set1(lo)), scan_set1((hi) - (lo))), scan_zero())
+    #define scan_or(a, b) _mm_or_si128((a), (b))
+    #define scan_movemask(v) ((uint32_t) _mm_movemask_epi8(v) | 0xffff0000u)
+#endif
+
+// returns the length of the run of ascii characters in the class `c` at the start of `p`
+static size_t scan_ascii(const struct scan_class *c, const char8_t *p, size_t n) {
+    size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+    // non-ascii bytes are never inside of the (ascii) ranges
+    for(; c->n > 0 && i + SCAN_VECTOR_SIZE <= n; i += SCAN_VECTOR_SIZE) {
+        scan_vector v = scan_load(p + i);
+        scan_vector m = scan_in_range(v, c->lo[0], c->hi[0]);
+        for(uint32_t j = 1; j < c->n; j++)
+            m = scan_or(m, scan_in_range(v, c->lo[j], c->hi[j]));
+
+        uint32_t mask = scan_movemask(m);
+        if(mask != UINT32_MAX)
+            return i + __builtin_ctz(~mask);
     }
+#endif
 
-    return PARSE_FAILURE;
+    for(; i < n && p[i] < 0x80 && (c->ascii[p[i] / 32] & (1u << (p[i] % 32))); i++);
+    return i;
 }
 
-static int match_noneof(struct cc_state *s, const char32_t *chars, size_t n, struct cc_lazy **r) {
-    char32_t next = peek_at(s);
-    if(is_eof(s))
-        return PARSE_FAILURE;
+static int call_terminal(struct cc_state *s, struct cc_parser *p, struct cc_lazy **r, struct cc_error *e);
 
-    for(size_t i = 0; i < n; i++) {
-        if(next == chars[i])
-            return PARSE_FAILURE;
-    }
+// consumes the longest run of characters in the class `c`
+static int scan_run(struct cc_state *s, const struct scan_class *c, struct cc_error *e) {
+    size_t avail;
+    while((avail = input_available(s, STREAM_LOOKAHEAD)) > 0) {
+        const char8_t *p = input_at(s, s->pos);
+        size_t n = scan_ascii(c, p, avail);
+        s->pos += n;
 
-    advance_char(s, next);
+        if(n == avail)
+            continue;
+        if(p[n] < 0x80)
+            break;
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_char(s->loc, next))))
-        return -ENOMEM;
+        // other code points are left to the terminal parser
+        int res = call_terminal(s, (struct cc_parser*) c->p, NULL, e);
+        if(res != PARSE_SUCCESS)
+            return res < 0 ? res : 0;
+    }
 
-    return PARSE_SUCCESS;
+    return 0;
 }
 
-static int match_string(struct cc_state *s, struct cc_parser *p, struct cc_lazy **r) {
-    struct cc_state save = *s;
+static const char8_t *regex_input(void *userp, size_t n, size_t *avail) {
+    struct cc_state *s = userp;
+    *avail = input_available(s, n);
+    return input_at(s, s->pos);
+}
 
-    for(size_t i = 0; p->match.str[i];) {
-        char32_t ch = utf8_first_cp(p->match.str + i);
-        if(!match_char(s, ch, NULL)) {
-            *s = save;
-            return PARSE_FAILURE;
-        }
+static int match_regex(struct cc_state *s, struct cc_parser *p, struct cc_lazy **r) {
+    size_t len;
+    int res = regex_match(p->match.regex, is_sof(s), regex_input, s, &len);
+    if(res != PARSE_SUCCESS)
+        return res;
 
-        i += utf8_cp_length(ch);
-    }
+    const char8_t *start = input_at(s, s->pos);
+    s->pos += len;
 
-    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_terminal(s->loc, p))))
+    if(!is_noreturn(s) && !(*r = LAZY_UPCAST(lazy_text(&s->arena, s->pos, start, len, s->src->stream.read != NULL))))
         return -ENOMEM;
 
     return PARSE_SUCCESS;
@@ -306,23 +529,32 @@ static int call_terminal(struct cc_state *s, struct cc_parser *p, struct cc_lazy
 
     switch(p->type) {
         case PARSER_FAIL:
-            FAIL_WITH(e, s, (char*) p->match.msg, true);
+            FAIL_WITH(e, s, p);
 
         case PARSER_PASS:
             return PARSE_SUCCESS;
         
-        case PARSER_LOCATION:
-            if(!is_noreturn(s) && !((*r) = LAZY_UPCAST(lazy_inline(s->loc, &s->loc, sizeof(struct cc_location)))))
+        case PARSER_LOCATION: {
+            if(is_noreturn(s))
+                return PARSE_SUCCESS;
+
+            struct cc_location loc;
+            int err;
+            if((err = lines_resolve(s, s->pos, &loc)))
+                return -err;
+
+            if(!((*r) = LAZY_UPCAST(lazy_inline(&s->arena, s->pos, &loc, sizeof(struct cc_location)))))
                 return -ENOMEM;
             return PARSE_SUCCESS;
+        }
 
         case PARSER_LIFT:
-            if(!is_noreturn(s) && !((*r) = LAZY_UPCAST(lazy_lift(s->loc, p->match.lift.lf))))
+            if(!is_noreturn(s) && !((*r) = LAZY_UPCAST(lazy_lift(&s->arena, s->pos, p->match.lift.lf))))
                 return -ENOMEM;
             return PARSE_SUCCESS;
 
         case PARSER_LIFT_VAL:
-            if(!is_noreturn(s) && !((*r) = LAZY_UPCAST(lazy_value(s->loc, p->match.lift.val))))
+            if(!is_noreturn(s) && !((*r) = lazy_value(&s->arena, s->pos, p->match.lift.val)))
                 return -ENOMEM;
             return PARSE_SUCCESS;
 
@@ -339,15 +571,16 @@ static int call_terminal(struct cc_state *s, struct cc_parser *p, struct cc_lazy
         case PARSER_MATCH:
             return match_char_func(s, p->match.matchfn, r);
         case PARSER_ONEOF:
-            return match_oneof(s, p->match.list.chars, p->match.list.n, r);
         case PARSER_ANYOF:
-            return match_anyof(s, p->match.list.chars, p->match.list.n, r);
+            return match_class(s, p->match.list.class, false, r);
         case PARSER_NONEOF:
-            return match_noneof(s, p->match.list.chars, p->match.list.n, r);
+            return match_class(s, p->match.list.class, true, r);
         case PARSER_STRING:
             return match_string(s, p, r);
+        case PARSER_REGEX:
+            return match_regex(s, p, r);
 
-        default: FAIL_WITH(e, s, format("undefined parser %d", p->type), false);
+        default: FAIL_WITH(e, s, p);
     }
 }
 
@@ -385,10 +618,18 @@ static uint32_t data_pop(struct data_stack *st) {
 
 struct frame {
     struct cc_parser *parser;
+    const struct cc_ir *ir;
     uint32_t ip;
     uint32_t sp;
     uint32_t rp; // result pointer
-    struct cc_location loc;
+    bool memo;   // record the result in the memo table on return
+    const char *rule; // name the parser was called by, NULL if it was not called through a lookup
+    size_t start; // byte offset the parser was called at
+    size_t pos;   // byte offset of the saved location
+    size_t mark;  // arena position at the saved location
+    size_t keep;  // oldest byte offset this frame might return to
+    size_t events;     // number of events emitted when the parser was called
+    size_t event_mark; // number of events emitted at the saved location
 };
 
 struct frame_stack {
@@ -420,6 +661,251 @@ static struct frame frame_pop(struct frame_stack *st) {
     return st->items[--st->count];
 }
 
+// delivers the buffered events no frame might backtrack past anymore
+static int events_flush(struct cc_state *s) {
+    struct event_buffer *ev = &s->events;
+
+    size_t commit = ev->count;
+    for(size_t i = 0; s->frames && i < s->frames->count; i++)
+        commit = MIN(commit, s->frames->items[i].event_mark);
+
+    if(commit <= ev->base)
+        return 0;
+
+    int err = 0;
+    size_t n = commit - ev->base;
+    for(size_t i = 0; i < n && !err; i++) {
+        struct cc_event *event = &ev->items[i];
+        event->text.ptr = input_at(s, event->offset);
+        err = ev->handler(event, ev->userp);
+    }
+
+    memmove(ev->items, ev->items + n, (ev->count - commit) * sizeof(struct cc_event));
+    ev->base = commit;
+    return err;
+}
+
+// adds an event for the input from `start` to the current location
+static int event_push(struct cc_state *s, enum cc_event_type type, const char *rule, size_t start) {
+    struct event_buffer *ev = &s->events;
+
+    int err;
+    if(ev->count - ev->base + 1 > ev->capacity) {
+        // make room by delivering events first
+        if((err = events_flush(s)))
+            return err;
+    }
+
+    if(ev->count - ev->base + 1 > ev->capacity) {
+        size_t new_capacity = MAX(ev->capacity * 2, EVENT_BUFFER_INIT_CAP);
+        void *new = realloc(ev->items, new_capacity * sizeof(struct cc_event));
+        if(!new)
+            return errno;
+
+        ev->items = new;
+        ev->capacity = new_capacity;
+    }
+
+    ev->items[ev->count++ - ev->base] = (struct cc_event){
+        .type = type,
+        .rule = rule,
+        .offset = start,
+        .text.len = type == CC_EVENT_ENTER ? 0 : s->pos - start,
+    };
+    return 0;
+}
+
+// drops the events emitted after the first `count` ones, delivered events cannot be taken back
+static inline void events_truncate(struct cc_state *s, size_t count) {
+    if(count < s->events.count)
+        s->events.count = MAX(count, s->events.base);
+}
+
+// makes `n` bytes after the current location available in the window of a streaming source, if the input is long enough.
+// input before the oldest location any frame might still return to is discarded first.
+static void stream_fill(struct cc_state *s, size_t n) {
+    struct cc_source *src = (struct cc_source*) s->src; // the window of streaming sources moves while parsing
+    char8_t *buffer = (char8_t*) src->buffer;
+
+    size_t keep = s->pos;
+    for(size_t i = 0; s->frames && i < s->frames->count; i++)
+        keep = MIN(keep, s->frames->items[i].keep);
+
+    if(keep > src->buffer_off) {
+        // the discarded input is still needed to compute line and column numbers and by the events delivered before.
+        // events that are held back start after `keep`.
+        struct cc_location window;
+        int err;
+        if((err = lines_resolve(s, keep, &window)) || (s->error && (err = lines_resolve_error(s, s->error)))
+                || (s->events.handler && (err = events_flush(s)))) {
+            src->stream.err = err;
+            src->stream.eof = true;
+            return;
+        }
+
+        s->lines.window = window;
+
+        size_t discard = keep - src->buffer_off;
+        memmove(buffer, buffer + discard, src->buffer_size - discard);
+        src->buffer_off = keep;
+        src->buffer_size -= discard;
+    }
+
+    // the window is followed by zeroed lookahead bytes, so decoding a truncated character stays in bounds
+    size_t needed = s->pos - src->buffer_off + n + STREAM_LOOKAHEAD;
+    if(needed > src->stream.capacity) {
+        size_t capacity = MAX(src->stream.capacity, STREAM_INIT_CAP);
+        while(capacity < needed)
+            capacity *= 2;
+
+        if(!(buffer = realloc(buffer, capacity))) {
+            src->stream.err = errno;
+            src->stream.eof = true;
+            return;
+        }
+
+        src->buffer = buffer;
+        src->stream.capacity = capacity;
+    }
+
+    needed -= STREAM_LOOKAHEAD;
+    while(src->buffer_size < needed && !src->stream.eof) {
+        size_t nread = 0;
+        int err = src->stream.read(src->stream.userp, buffer + src->buffer_size, src->stream.capacity - STREAM_LOOKAHEAD - src->buffer_size, &nread);
+        if(err)
+            src->stream.err = err;
+        if(err || nread == 0)
+            src->stream.eof = true;
+
+        src->buffer_size += nread;
+    }
+
+    memset(buffer + src->buffer_size, 0, STREAM_LOOKAHEAD);
+}
+
+struct value_stack {
+    size_t count;
+    size_t capacity;
+    void **items;
+};
+
+#define VALUE_STACK_INIT {0, 0, NULL}
+#define VALUE_STACK_INIT_CAP 64
+
+static int value_push(struct value_stack *st, void *v) {
+    if(st->count + 1 > st->capacity) {
+        size_t new_capacity = MAX(st->capacity * 2, VALUE_STACK_INIT_CAP);
+        void *new = realloc(st->items, new_capacity * sizeof(void*));
+        if(!new)
+            return errno;
+
+        st->items = new;
+        st->capacity = new_capacity;
+    }
+
+    st->items[st->count++] = v;
+    return 0;
+}
+
+static void *value_pop(struct value_stack *st) {
+    assert(st->count > 0);
+    return st->items[--st->count];
+}
+
+// memoized parser results, keyed by (parser, byte offset, state flags)
+struct memo_entry {
+    const struct cc_parser *p; // NULL if unused
+    size_t byte_off;
+    int flags;
+    bool success;
+    size_t end;
+    struct cc_lazy *result;
+};
+
+struct memo_table {
+    size_t capacity; // always a power of two
+    size_t count;
+    struct memo_entry *entries;
+};
+
+#define MEMO_TABLE_INIT {0, 0, NULL}
+
+static inline size_t memo_hash(const struct cc_parser *p, size_t byte_off, int flags) {
+    uint64_t h = ((uintptr_t) p >> 4) ^ ((uint64_t) byte_off << 2) ^ (uint64_t) flags;
+    h *= 0x9e3779b97f4a7c15ull;
+    return (size_t) (h ^ (h >> 32));
+}
+
+static struct memo_entry *memo_slot(struct memo_entry *entries, size_t capacity, const struct cc_parser *p, size_t byte_off, int flags) {
+    size_t i = memo_hash(p, byte_off, flags) & (capacity - 1);
+    while(entries[i].p && (entries[i].p != p || entries[i].byte_off != byte_off || entries[i].flags != flags))
+        i = (i + 1) & (capacity - 1);
+    return &entries[i];
+}
+
+static struct memo_entry *memo_lookup(struct memo_table *memo, const struct cc_parser *p, size_t byte_off, int flags) {
+    if(memo->count == 0)
+        return NULL;
+
+    struct memo_entry *entry = memo_slot(memo->entries, memo->capacity, p, byte_off, flags & MEMO_KEY_FLAGS);
+    return entry->p ? entry : NULL;
+}
+
+static int memo_grow(struct memo_table *memo, size_t input_size) {
+    size_t capacity = memo->capacity * 2;
+    if(capacity == 0) {
+        // start out proportional to the input size
+        capacity = MEMO_INIT_CAP_MIN;
+        while(capacity < MEMO_INIT_CAP_MAX && capacity < input_size / 4)
+            capacity *= 2;
+    }
+
+    struct memo_entry *entries = calloc(capacity, sizeof(struct memo_entry));
+    if(!entries)
+        return errno;
+
+    for(size_t i = 0; i < memo->capacity; i++) {
+        struct memo_entry *e = &memo->entries[i];
+        if(e->p)
+            *memo_slot(entries, capacity, e->p, e->byte_off, e->flags) = *e;
+    }
+
+    free(memo->entries);
+    memo->entries = entries;
+    memo->capacity = capacity;
+    return 0;
+}
+
+static int memo_insert(struct memo_table *memo, size_t input_size, const struct cc_parser *p, size_t byte_off, int flags, bool success, size_t end, struct cc_lazy *result) {
+    int err;
+    if((memo->count + 1) * 2 > memo->capacity && (err = memo_grow(memo, input_size)))
+        return err;
+
+    flags &= MEMO_KEY_FLAGS;
+
+    struct memo_entry *entry = memo_slot(memo->entries, memo->capacity, p, byte_off, flags);
+    assert(entry->p == NULL && "parser memoized twice");
+
+    *entry = (struct memo_entry){
+        .p = p,
+        .byte_off = byte_off,
+        .flags = flags,
+        .success = success,
+        .end = end,
+        .result = result,
+    };
+
+    memo->count++;
+    return 0;
+}
+
+// removes all entries, but keeps the table allocated for the next parse
+static void memo_clear(struct memo_table *memo) {
+    if(memo->count > 0)
+        memset(memo->entries, 0, memo->capacity * sizeof(struct memo_entry));
+    memo->count = 0;
+}
+
 
 __internal int result_push(struct result_stack *st, struct cc_lazy* v) {
     if(st->count + 1 > st->capacity) {
@@ -446,68 +932,77 @@ __internal struct cc_lazy *result_top(struct result_stack *st) {
     return st->items[st->count - 1];
 }
 
-static void remove_patched_values(struct result_stack *result_stack, struct data_stack *data_stack) {
-    size_t j = data_stack->count;
-    for(size_t i = result_stack->count; i > 0; i--) {
-        switch(result_stack->items[i - 1]->type) {
-        case LAZY_APPLY:
-            assert(j > 0);
-            LAZY_DOWNCAST(result_stack->items[i - 1], struct cc_lazy_apply)->value = NULL;
-            j--;
-            break;
-        case LAZY_FOLD:
-            assert(j > 0);
-            size_t state = data_stack->data[--j];
-            if(state > 0)
-                memset(LAZY_DOWNCAST(result_stack->items[i - 1], struct cc_lazy_fold)->values, 0, (state - 1) * sizeof(struct cc_lazy*));
-        default:
-            break;
-        }
-    }
-}
-
-static int lazy_eval(struct cc_state *s, struct result_stack *result_stack, struct data_stack *data_stack, struct cc_result *result) {
-    assert(result_stack->count == 1 && "no result left on stack");
-    data_stack->count = 0;
+// evaluates the lazy result tree `root` bottom-up.
+// the tree itself is not modified, since (memoized) nodes might be shared.
+// evaluates the tree of lazy nodes below `root`. the stacks are only used above their current count,
+// so results can also be evaluated while parsing.
+static int lazy_eval(struct cc_state *s, struct cc_lazy *root, struct result_stack *node_stack, struct data_stack *data_stack, struct value_stack *value_stack, struct cc_result *result) {
+    const size_t node_base = node_stack->count;
+    const size_t data_base = data_stack->count;
+    const size_t value_base = value_stack->count;
 
     int err = 0;
     int res = PARSE_SUCCESS;
 
     memset(result, 0, sizeof(struct cc_result));
 
-    if(lazy_is_recursive(result_top(result_stack)) && (err = data_push(data_stack, 0u)))
+    if((err = result_push(node_stack, root)))
+        goto cleanup;
+    if(lazy_is_recursive(root) && (err = data_push(data_stack, 0u)))
         goto cleanup;
 
-    while(result_stack->count > 0) {
-        struct cc_lazy *lazy = result_top(result_stack); 
-
-        if(!lazy) {
-            result->out = NULL;
-            result_pop(result_stack);
-            continue;
-        }
-
-        assert(result->err == NULL);
+    while(node_stack->count > node_base) {
+        struct cc_lazy *lazy = result_top(node_stack); 
+        struct cc_result out = {0};
 
-        switch(lazy->type) {
+        switch(lazy ? lazy_type(lazy) : 0) {
+        case 0:
+            break;
         case LAZY_VALUE:
-            result->out = LAZY_DOWNCAST(lazy, struct cc_lazy_value)->value;
+            out.out = lazy_get_value(lazy);
             break;
         case LAZY_INLINE:
             struct cc_lazy_inline *inl = LAZY_DOWNCAST(lazy, struct cc_lazy_inline);
-            if(!(result->out = malloc(inl->size)))
-                return errno;
+            if(!(out.out = malloc(inl->size))) {
+                err = errno;
+                goto cleanup;
+            }
             
-            memcpy(result->out, inl->value, inl->size);
+            memcpy(out.out, inl->value, inl->size);
+            break;
+        case LAZY_SPAN:
+            struct cc_lazy_span *span = LAZY_DOWNCAST(lazy, struct cc_lazy_span);
+            if(!(out.out = malloc(sizeof(struct cc_span) + (span->span.ptr ? 0 : span->span.len + 1)))) {
+                err = errno;
+                goto cleanup;
+            }
+
+            struct cc_span *copy = out.out;
+            *copy = span->span;
+
+            if(!copy->ptr) {
+                // the copied input is stored right behind the span
+                char8_t *data = (char8_t*) (copy + 1);
+                memcpy(data, span->data, span->span.len);
+                data[span->span.len] = '\0';
+                copy->ptr = data;
+            }
+            break;
+        case LAZY_TEXT:
+            struct cc_lazy_span *text = LAZY_DOWNCAST(lazy, struct cc_lazy_span);
+            if((err = -string_result(&out, text->span.ptr ? text->span.ptr : text->data, text->span.len)))
+                goto cleanup;
             break;
         case LAZY_CHAR:
-            char_result(result, LAZY_DOWNCAST(lazy, struct cc_lazy_char)->ch); 
+            if((err = -char_result(&out, lazy_get_char(lazy))))
+                goto cleanup;
             break;
         case LAZY_TERMINAL:
             struct cc_lazy_terminal *term = LAZY_DOWNCAST(lazy, struct cc_lazy_terminal);
             switch(term->p->type) {
                 case PARSER_STRING:
-                    string_result(result, term->p->match.str);
+                    if((err = -string_result(&out, term->p->match.str, term->p->match.len)))
+                        goto cleanup;
                     break;
                 default:
                     assert(false && "unexpected parser type");
@@ -515,32 +1010,27 @@ static int lazy_eval(struct cc_state *s, struct result_stack *result_stack, stru
             }
             break;
         case LAZY_LIFT:
-            *result = LAZY_DOWNCAST(lazy, struct cc_lazy_lift)->lift();
+            out = LAZY_DOWNCAST(lazy, struct cc_lazy_lift)->lift();
             break;
         case LAZY_FOLD: {
             struct cc_lazy_fold *fold = LAZY_DOWNCAST(lazy, struct cc_lazy_fold);
             uint32_t state = data_pop(data_stack);
 
-            if(state > 0) {
-                // save the previous result
-                fold->values[state - 1] = result->out;
-            }
-
             if(state < fold->n) {
                 // calculate the next result
                 if((err = data_push(data_stack, state + 1u)))
                     goto cleanup;
-                if((err = result_push(result_stack, fold->values[state])))
+                if((err = result_push(node_stack, fold->values[state])))
                     goto cleanup;
                 if(lazy_is_recursive(fold->values[state]) && (err = data_push(data_stack, 0u)))
                     goto cleanup;  
-                fold->values[state] = NULL;
                 continue;
             }
 
-            *result = fold->fold(fold->n, (void**) fold->values); 
-
-            memset(fold->values, 0, fold->n * sizeof(struct cc_fold*));
+            // the results of all inner values are on top of the value stack
+            assert(value_stack->count >= value_base + fold->n);
+            value_stack->count -= fold->n;
+            out = fold->fold(fold->n, value_stack->items + value_stack->count); 
             break;
         }
         case LAZY_APPLY: {
@@ -551,14 +1041,13 @@ static int lazy_eval(struct cc_state *s, struct result_stack *result_stack, stru
             case 0:
                 if((err = data_push(data_stack, 1u)))
                     goto cleanup;
-                if((err = result_push(result_stack, apply->value)))
+                if((err = result_push(node_stack, apply->value)))
                     goto cleanup;
                 if(lazy_is_recursive(apply->value) && (err = data_push(data_stack, 0u)))
                     goto cleanup;
-                apply->value = NULL;
                 continue;
             case 1:
-                *result = apply->apply(result->out); 
+                out = apply->apply(value_pop(value_stack)); 
                 break;
             default:
                 assert(false && "invalid apply state");
@@ -566,399 +1055,1109 @@ static int lazy_eval(struct cc_state *s, struct result_stack *result_stack, stru
             }
             break;
         }
+        case LAZY_REDUCE: {
+            struct cc_lazy_reduce *reduce = LAZY_DOWNCAST(lazy, struct cc_lazy_reduce);
+            if(reduce->acc.err) {
+                // the location of the error is already resolved
+                *result = reduce->acc;
+                res = PARSE_FAILURE;
+                goto cleanup;
+            }
+
+            out.out = reduce->acc.out;
+            break;
+        }
         default:
             assert(false && "invalid lazy type");
             unreachable();
         }
 
-        struct cc_location location = lazy->location;
+        result_pop(node_stack);
 
-        if((err = lazy_free(result_pop(result_stack), result_stack)))
-            goto cleanup;
-
-        if(result->err) {
-            cc_with_filename(result->err, s->src->origin);
-            cc_with_location(result->err, location);
+        if(out.err) {
+            struct cc_location loc;
+            if((err = lines_resolve(s, lazy->location, &loc))) {
+                cc_err_free(out.err);
+                goto cleanup;
+            }
 
-            // remove patched values, so they don't get freed accidentally
-            remove_patched_values(result_stack, data_stack);
+            cc_with_filename(out.err, s->src->origin);
+            cc_with_location(out.err, loc);
 
+            *result = out;
             res = PARSE_FAILURE;
             goto cleanup;
         }
+
+        if((err = value_push(value_stack, out.out)))
+            goto cleanup;
     }
 
-    assert(data_stack->count == 0 && "data stack is not empty");
+    assert(data_stack->count == data_base && "data stack is not empty");
+    assert(value_stack->count == value_base + 1 && "no result left on stack");
+    result->out = value_pop(value_stack);
 cleanup:
-    return res == PARSE_SUCCESS ? -err : PARSE_FAILURE;
+    // values of partially evaluated folds are lost on error, since their type is unknown
+    node_stack->count = node_base;
+    data_stack->count = data_base;
+    value_stack->count = value_base;
+    return err ? -err : res;
+}
+
+// attaches the current location to an error returned by the init or step function of a reduce parser
+static int reduce_error(struct cc_state *s, struct cc_result *acc) {
+    struct cc_location loc;
+    int err;
+    if((err = lines_resolve(s, s->pos, &loc))) {
+        cc_err_free(acc->err);
+        return err;
+    }
+
+    cc_with_filename(acc->err, s->src->origin);
+    cc_with_location(acc->err, loc);
+    return 0;
 }
 
-static int ir_eval(struct cc_state *s, struct cc_parser *p, struct cc_result *r) {
-    struct data_stack data_stack = DATA_STACK_INIT;
-    struct result_stack result_stack = RESULT_STACK_INIT;
-    struct frame_stack call_stack = CALL_STACK_INIT;
+// adds `what` to the list of expected items at the current position, if no parser failed any farther.
+// the items are borrowed from the parsers and only get copied by `report_error`.
+static void expect(struct cc_state *s, struct cc_error *e, const char *what) {
+    if(error_behind(s, e))
+        return;
+
+    if(s->pos > e->loc.byte_off || (e->num_expected == 0 && !e->failure && !s->failed)) {
+        free((void*) e->failure);
+        memset(e, 0, sizeof(struct cc_error));
+        s->failed = NULL;
+
+        e->loc = (struct cc_location){.byte_off = s->pos};
+        e->received = peek_at(s);
+    }
+
+    if(e->num_expected == 0)
+        e->filename = s->src->origin;
+
+    if(e->num_expected >= CC_ERR_MAX_EXPECTED)
+        return;
+
+    for(size_t i = 0; i < e->num_expected; i++) {
+        if(strcmp(e->expected[i], what) == 0)
+            return;
+    }
+
+    e->expected[e->num_expected++] = what;
+}
 
+// builds the message of the failed parser `p` recorded by `new_error`
+static char *failure_message(const struct cc_parser *p) {
+    switch(p->type) {
+    case PARSER_FAIL:
+        return strdup(p->match.msg);
+    case PARSER_LOOKUP:
+        return format("undefined parser \"%s\"", p->match.lookup.name);
+    default:
+        return format("undefined parser %d", p->type);
+    }
+}
+
+// copies the error report `e` collected while parsing into a new `cc_error` for the caller
+static struct cc_error *report_error(struct cc_state *s, struct cc_error *e) {
     int err;
-    uint32_t call_success = PARSE_SUCCESS;
+    if((err = lines_resolve_error(s, e))) {
+        errno = err;
+        return NULL;
+    }
 
-    if(!(r->err = malloc(sizeof(struct cc_error))))
-        return -errno;
-    memset(r->err, 0, sizeof(struct cc_error));
+    struct cc_error *report = malloc(sizeof(struct cc_error));
+    if(!report)
+        return NULL;
+
+    *report = *e;
+    e->failure = NULL; // ownership is passed on
+
+    if(s->failed && !(report->failure = failure_message(s->failed))) {
+        report->num_expected = 0;
+        cc_err_free(report);
+        return NULL;
+    }
+
+    for(size_t i = 0; i < report->num_expected; i++) {
+        if(!(report->expected[i] = strdup(e->expected[i]))) {
+            report->num_expected = i;
+            cc_err_free(report);
+            return NULL;
+        }
+    }
+
+    return report;
+}
+
+// a `cc_context` keeps all buffers needed for parsing allocated between parses
+struct cc_context {
+    struct cc_state state;
+    struct cc_error err; // error report of the current parse
+
+    struct data_stack data_stack;
+    struct result_stack result_stack;
+    struct frame_stack call_stack;
+    struct value_stack value_stack;
+    struct memo_table memo;
+};
+
+static int context_init(struct cc_context *ctx) {
+    memset(ctx, 0, sizeof(struct cc_context));
 
-    if((err = frame_push(&call_stack, (struct frame){
+    ctx->data_stack = (struct data_stack) DATA_STACK_INIT;
+    ctx->result_stack = (struct result_stack) RESULT_STACK_INIT;
+    ctx->call_stack = (struct frame_stack) CALL_STACK_INIT;
+    ctx->value_stack = (struct value_stack) VALUE_STACK_INIT;
+    ctx->memo = (struct memo_table) MEMO_TABLE_INIT;
+
+    return state_init(&ctx->state);
+}
+
+// frees the buffers of the context, but not the context itself
+static void context_release(struct cc_context *ctx) {
+    free(ctx->data_stack.data);
+    free(ctx->result_stack.items);
+    free(ctx->call_stack.items);
+    free(ctx->value_stack.items);
+    free(ctx->memo.entries);
+    arena_free(&ctx->state.arena);
+
+    ctx->data_stack = (struct data_stack) DATA_STACK_INIT;
+    ctx->result_stack = (struct result_stack) RESULT_STACK_INIT;
+    ctx->call_stack = (struct frame_stack) CALL_STACK_INIT;
+    ctx->value_stack = (struct value_stack) VALUE_STACK_INIT;
+    ctx->memo = (struct memo_table) MEMO_TABLE_INIT;
+}
+
+static void context_free(struct cc_context *ctx) {
+    context_release(ctx);
+    state_free(&ctx->state);
+}
+
+// pseudo-result of `call_parser`, if a new frame was pushed onto the call stack
+#define CALL_FRAME 2
+
+// resolves the parser `p` once when it gets called:
+// terminal parsers are run directly, combinators get compiled (if needed) and a new frame is pushed.
+// returns `PARSE_SUCCESS` or `PARSE_FAILURE` if `p` was run directly, `CALL_FRAME` if a frame was pushed
+// or a negative errno value on error.
+static int call_parser(struct cc_state *s, struct cc_parser *p, struct frame_stack *call_stack, struct result_stack *result_stack, struct memo_table *memo, uint32_t sp, struct cc_error *e) {
+    int err;
+    const char *rule = NULL;
+
+    // resolve parser lookups directly
+    while(p->type == PARSER_LOOKUP) {
+        rule = p->match.lookup.name;
+
+        // TODO: filter out infinite recursion
+
+        // linked lookups do not depend on the scope
+        struct cc_parser *found = p->match.lookup.target ? p->match.lookup.target : scope_lookup(s, p->match.lookup.name);
+        if(!found) {
+            if((err = new_error(e, s, p, NULL)))
+                return -err;
+            return PARSE_FAILURE;
+        }
+
+        p = found;
+    }
+
+    // interpret terminal parsers directly without generating ir first
+    if(!is_combinator(p->type)) {
+        struct cc_lazy *call_result;
+        int res = call_terminal(s, p, &call_result, e);
+
+        if(res == PARSE_SUCCESS && !is_noreturn(s) && (err = result_push(result_stack, call_result)))
+            return -err;
+        return res;
+    }
+
+    // replay memoized results
+    bool memoize = (p->type == PARSER_MEMO || (s->flags & CC_STATE_FLAG_MEMOIZE)) && !s->events.handler;
+    struct memo_entry *entry;
+    if(memoize && (entry = memo_lookup(memo, p, s->pos, s->flags))) {
+        s->pos = entry->end;
+
+        if(entry->success && !is_noreturn(s) && (err = result_push(result_stack, entry->result)))
+            return -err;
+        return entry->success ? PARSE_SUCCESS : PARSE_FAILURE;
+    }
+
+    // compile the parser to IR if needed
+    if(!p->ir && (err = cc_compile(p)))
+        return -err;
+
+    assert(p->ir && "no IR present even though it should be");
+
+    if((err = frame_push(call_stack, (struct frame){
         .parser = p,
-        .ip = 0,
-        .sp = 0,
-        .rp = 0
+        .ir = p->ir,
+        .ip = 0,                    // initial instruction pointer
+        .sp = sp,                   // save stack pointer
+        .rp = result_stack->count,  // save result pointer
+        .memo = memoize,
+        .rule = rule,
+        .start = s->pos,
+        .keep = p->type == PARSER_CAPTURE ? s->pos : SIZE_MAX,
+        .events = s->events.count,
+        .event_mark = SIZE_MAX,
     })))
+        return -err;
+
+    if(rule && s->events.handler && (err = event_push(s, CC_EVENT_ENTER, rule, s->pos)))
+        return -err;
+
+    return CALL_FRAME;
+}
+
+// threaded dispatch: every opcode handler jumps directly to the next handler through a label table.
+// compilers without labels-as-values fall back to a regular `switch`.
+#ifdef CC_THREADED_DISPATCH
+    #define OP(opcode) op_##opcode
+    #define OP_UNDEFINED op_undefined
+    #define DISPATCH() __extension__ ({ goto *dispatch_table[ir->bytes[ip++]]; })
+#else
+    #define OP(opcode) case opcode
+    #define OP_UNDEFINED default
+    #define DISPATCH() goto dispatch
+#endif
+
+// (re-)loads the topmost frame into the dispatch registers
+#define LOAD_FRAME() do {                               \
+        t = &call_stack.items[call_stack.count - 1];    \
+        ir = t->ir;                                     \
+        ip = t->ip;                                     \
+    } while(0)
+
+static int ir_eval(struct cc_context *ctx, struct cc_parser *p, struct cc_result *r) {
+    struct cc_state *s = &ctx->state;
+    struct cc_error *e = &ctx->err;
+
+    // the buffers of the context are borrowed for the duration of the parse
+    struct data_stack data_stack = ctx->data_stack;
+    struct result_stack result_stack = ctx->result_stack;
+    struct frame_stack call_stack = ctx->call_stack;
+    struct value_stack value_stack = ctx->value_stack;
+    struct memo_table memo = ctx->memo;
+
+    int err = 0, res;
+    uint32_t call_success = PARSE_SUCCESS, v;
+
+    // memoized results must survive backtracking, so the arena is never reset below this mark
+    size_t memo_pin = 0;
+
+    s->frames = &call_stack;
+    s->error = e;
+    s->rejected = false;
+
+    // operands of inline matches
+    const char *what;
+    struct cc_parser *terminal;
+    struct cc_lazy *lazy;
+
+    // dispatch registers
+    struct frame *t;
+    const struct cc_ir *ir;
+    uint32_t ip;
+
+#ifdef CC_THREADED_DISPATCH
+    // indexed with any opcode byte, the ones past the last opcode end up at `op_undefined` like the `default` case
+    __extension__ static const void *const dispatch_table[UINT8_MAX + 1] = {
+        [0]                     = &&op_undefined,
+        [IR_PUSH]               = &&op_IR_PUSH,
+        [IR_POP]                = &&op_IR_POP,
+        [IR_SWAP]               = &&op_IR_SWAP,
+        [IR_DUP]                = &&op_IR_DUP,
+        [IR_NEGATE]             = &&op_IR_NEGATE,
+        [IR_INCREMENT]          = &&op_IR_INCREMENT,
+        [IR_DECREMENT]          = &&op_IR_DECREMENT,
+        [IR_SAVE_LOCATION]      = &&op_IR_SAVE_LOCATION,
+        [IR_RESTORE_LOCATION]   = &&op_IR_RESTORE_LOCATION,
+        [IR_SET_NOERROR]        = &&op_IR_SET_NOERROR,
+        [IR_SET_NORETURN]       = &&op_IR_SET_NORETURN,
+        [IR_CALL]               = &&op_IR_CALL,
+        [IR_RETURN]             = &&op_IR_RETURN,
+        [IR_FOLD]               = &&op_IR_FOLD,
+        [IR_APPLY]              = &&op_IR_APPLY,
+        [IR_CAPTURE]            = &&op_IR_CAPTURE,
+        [IR_EXPECT]             = &&op_IR_EXPECT,
+        [IR_PUSH_BINDING]       = &&op_IR_PUSH_BINDING,
+        [IR_POP_BINDING]        = &&op_IR_POP_BINDING,
+        [IR_NULL_RESULT]        = &&op_IR_NULL_RESULT,
+        [IR_POP_RESULT]         = &&op_IR_POP_RESULT,
+        [IR_REDUCE_INIT]        = &&op_IR_REDUCE_INIT,
+        [IR_REDUCE]             = &&op_IR_REDUCE,
+        [IR_JUMP]               = &&op_IR_JUMP,
+        [IR_JUMP_IF_NONZERO]    = &&op_IR_JUMP_IF_NONZERO,
+        [IR_JUMP_IF_SUCCESS]    = &&op_IR_JUMP_IF_SUCCESS,
+        [IR_JUMP_IF_FAILURE]    = &&op_IR_JUMP_IF_FAILURE,
+        [IR_PREDICT]            = &&op_IR_PREDICT,
+        [IR_MATCH]              = &&op_IR_MATCH,
+        [IR_MATCH_CHAR]         = &&op_IR_MATCH_CHAR,
+        [IR_MATCH_RANGE]        = &&op_IR_MATCH_RANGE,
+        [IR_MATCH_SET]          = &&op_IR_MATCH_SET,
+        [IR_MATCH_STRING]       = &&op_IR_MATCH_STRING,
+        [IR_SCAN_CLASS]         = &&op_IR_SCAN_CLASS,
+        [IR_SCAN_UNTIL]         = &&op_IR_SCAN_UNTIL,
+        [IR_OPCODE_MAX ... UINT8_MAX] = &&op_undefined,
+    };
+#endif
+
+    if((res = call_parser(s, p, &call_stack, &result_stack, &memo, 0, e)) < 0) {
+        err = -res;
         goto cleanup;
+    }
+
+    if(res != CALL_FRAME) {
+        // the root parser is a terminal and has already been run
+        if((err = data_push(&data_stack, res)))
+            goto cleanup;
+        goto finish;
+    }
 
-    while(call_stack.count > 0) {
-        struct frame *t = &call_stack.items[call_stack.count - 1];
-        call_success = PARSE_SUCCESS;
+    LOAD_FRAME();
 
-        // resolve parser lookups directly
-        while(t->parser->type == PARSER_LOOKUP) {
-            // TODO: filter out infinite recursion
+    // interpret the next IR opcode
+    // fprintf(stderr, "%04x: <%02hhx> %s\n", ip, ir->bytes[ip], ir_str_opcode(ir->bytes[ip]));
+#ifdef CC_THREADED_DISPATCH
+    DISPATCH();
+#else
+dispatch:
+    switch(ir->bytes[ip++]) {
+#endif
+    OP(IR_PUSH):
+        ip = IR_ALIGN(ip, uint32_t);
 
-            struct cc_parser *found = scope_lookup(s, t->parser->match.lookup);
-            if(!found) {
-                if(!is_noerror(s) && (err = new_error(r->err, s, format("undefined parser \"%s\"", t->parser->match.lookup), false)))
-                    goto cleanup;
-                
-                call_success = PARSE_FAILURE;
-                goto do_return;
-            }
+        v = ir_read_u32(ir, ip);
+        ip += sizeof(uint32_t);
 
-            t->parser = found;
+        if((err = data_push(&data_stack, v)))
+            goto cleanup;
+        DISPATCH();
+
+    OP(IR_POP):
+        data_pop(&data_stack);
+        DISPATCH();
+
+    OP(IR_SWAP):
+        assert(data_stack.count >= 2);
+        v = data_stack.data[data_stack.count - 1];
+        data_stack.data[data_stack.count - 1] = data_stack.data[data_stack.count - 2];
+        data_stack.data[data_stack.count - 2] = v;
+        DISPATCH();
+
+    OP(IR_DUP):
+        assert(data_stack.count >= 1);
+        v = data_stack.data[data_stack.count - 1];
+
+        if((err = data_push(&data_stack, v)))
+            goto cleanup;
+        DISPATCH();
+
+    OP(IR_NEGATE):
+        assert(data_stack.count >= 1);
+        data_stack.data[data_stack.count - 1] = !data_stack.data[data_stack.count - 1];
+        DISPATCH();
+
+    OP(IR_INCREMENT):
+        assert(data_stack.count >= 1);
+        data_stack.data[data_stack.count - 1]++; // TODO: range check
+        DISPATCH();
+
+    OP(IR_DECREMENT):
+        assert(data_stack.count >= 1);
+        data_stack.data[data_stack.count - 1]--; // TODO: range check
+        DISPATCH();
+
+    OP(IR_SAVE_LOCATION):
+        t->pos = s->pos;
+        t->mark = arena_mark(&s->arena);
+        t->keep = s->pos;
+        t->event_mark = s->events.count;
+        DISPATCH();
+
+    OP(IR_RESTORE_LOCATION):
+        s->pos = t->pos;
+        arena_reset(&s->arena, MAX(t->mark, memo_pin)); // results of failed alternatives are no longer used
+        events_truncate(s, t->event_mark);
+        DISPATCH();
+
+    OP(IR_SET_NORETURN):
+        assert(data_stack.count >= 1);
+
+        v = data_stack.data[data_stack.count - 1];
+        data_stack.data[data_stack.count - 1] = set_flag(s, CC_STATE_FLAG_NORETURN, v);
+        DISPATCH();
+
+    OP(IR_SET_NOERROR):
+        assert(data_stack.count >= 1);
+
+        v = data_stack.data[data_stack.count - 1];
+        data_stack.data[data_stack.count - 1] = set_flag(s, CC_STATE_FLAG_NOERROR, v);
+        DISPATCH();
+
+    OP(IR_CALL): {
+        ip = IR_ALIGN(ip, uintptr_t);
+
+        struct cc_parser *callee = (struct cc_parser*) ir_read_ptr(ir, ip); // call destination
+        t->ip = ip + sizeof(uintptr_t);
+
+        if((res = call_parser(s, callee, &call_stack, &result_stack, &memo, data_stack.count, e)) < 0) {
+            err = -res;
+            goto cleanup;
         }
-        
-        // check if the current parser a terminal parser
-        if(!is_combinator(t->parser->type)) {
-            // interpret the parser directly without generating ir first
-            struct cc_lazy *call_result;
-            call_success = call_terminal(s, t->parser, &call_result, r->err);
-            if(err < 0) {
-                err = -call_success;
+
+        if(res == CALL_FRAME)
+            LOAD_FRAME();
+        else {
+            ip = t->ip;
+            if((err = data_push(&data_stack, res)))
                 goto cleanup;
-            }
+        }
+        DISPATCH();
+    }
+
+    OP(IR_RETURN):
+        call_success = data_pop(&data_stack);
+    do_return:
+        assert(data_stack.count >= t->sp);
 
-            if(call_success == PARSE_SUCCESS && !is_noreturn(s) && (err = result_push(&result_stack, call_result)))
+        if(is_noreturn(s) || !call_success) {
+            assert(result_stack.count >= t->rp);
+            result_stack.count = t->rp;
+        }
+        else {
+            assert(result_stack.count == t->rp + 1);
+        }
+
+        if(s->events.handler) {
+            if(!call_success)
+                events_truncate(s, t->events);
+            else if(t->rule && (err = event_push(s, CC_EVENT_EXIT, t->rule, t->start)))
                 goto cleanup;
+        }
 
-            goto do_return;
+        if(t->memo) {
+            lazy = call_success && !is_noreturn(s) ? result_top(&result_stack) : NULL;
+            if(lazy)
+                memo_pin = arena_mark(&s->arena);
+
+            if((err = memo_insert(&memo, s->src->buffer_size, t->parser, t->start, s->flags, call_success, s->pos, lazy)))
+                goto cleanup;
         }
 
-        // compile the parser to IR if needed
-        if(!t->parser->ir && (err = cc_compile(t->parser)))
+        data_stack.count = t->sp;   // restore stack pointer
+        frame_pop(&call_stack);     // return to caller
+
+        if((err = data_push(&data_stack, call_success)))
             goto cleanup;
 
-        assert(t->parser->ir && "no IR present even though it should be");
+        if(call_stack.count == 0)
+            goto finish;
+
+        LOAD_FRAME();
+        DISPATCH();
+
+    OP(IR_FOLD): {
+        uint32_t n = data_pop(&data_stack);
+        if(is_noreturn(s))
+            DISPATCH();
 
+        assert(result_stack.count >= n);
+        result_stack.count -= n;
 
-        // automatically return on IR end
-        if(t->ip >= t->parser->ir->count) {
-            call_success = data_pop(&data_stack);
-            goto do_return;
+        struct cc_lazy_fold *fold = lazy_fold(&s->arena, s->pos, t->parser->fold, n, result_stack.items + result_stack.count);
+        if(!fold) {
+            err = ENOMEM;
+            goto cleanup;
         }
 
-        uint32_t v;
+        if((err = result_push(&result_stack, LAZY_UPCAST(fold))))
+            goto cleanup;
+        DISPATCH();
+    }
 
-        // interpret the next IR opcode
-        // fprintf(stderr, "%04x: <%02hhx> %s\n", t->ip, t->parser->ir->bytes[t->ip], ir_str_opcode(t->parser->ir->bytes[t->ip]));
-        switch(t->parser->ir->bytes[t->ip++]) {
-        case IR_PUSH:
-            assert(t->parser->ir->count - t->ip >= sizeof(uint32_t));
+    OP(IR_APPLY): {
+        assert(t->parser->type == PARSER_APPLY);
+        if(is_noreturn(s))
+            DISPATCH();
 
-            v = ir_read_u32(t->parser->ir, t->ip);
-            t->ip += sizeof(uint32_t);
+        assert(result_stack.count > 0);
 
-            if((err = data_push(&data_stack, v)))
-                goto cleanup;
-            continue;
+        struct cc_lazy *result_top = result_stack.items[result_stack.count - 1];
+        struct cc_lazy_apply *apply = lazy_apply(&s->arena, s->pos, t->parser->match.apply.af, result_top);
+        if(!apply) {
+            err = ENOMEM;
+            goto cleanup;
+        }
 
-        case IR_POP:
-            data_pop(&data_stack);
-            continue;
+        result_stack.items[result_stack.count - 1] = LAZY_UPCAST(apply);
+        DISPATCH();
+    }
 
-        case IR_SWAP:
-            assert(data_stack.count >= 2);
-            v = data_stack.data[data_stack.count - 1];
-            data_stack.data[data_stack.count - 1] = data_stack.data[data_stack.count - 2];
-            data_stack.data[data_stack.count - 2] = v;
-            continue;
+    OP(IR_CAPTURE): {
+        assert(t->parser->type == PARSER_CAPTURE);
+        if(s->events.handler && (err = event_push(s, CC_EVENT_TOKEN, NULL, t->start)))
+            goto cleanup;
+        if(is_noreturn(s))
+            DISPATCH();
 
-        case IR_DUP:
-            assert(data_stack.count >= 1);
-            v = data_stack.data[data_stack.count - 1];
+        if(!(lazy = LAZY_UPCAST(lazy_span(&s->arena, s->pos, input_at(s, t->start), s->pos - t->start, s->src->stream.read != NULL)))) {
+            err = ENOMEM;
+            goto cleanup;
+        }
 
-            if((err = data_push(&data_stack, v)))
-                goto cleanup;
-            continue;
+        if((err = result_push(&result_stack, lazy)))
+            goto cleanup;
+        DISPATCH();
+    }
 
-        case IR_NEGATE:
-            assert(data_stack.count >= 1);
-            data_stack.data[data_stack.count - 1] = !data_stack.data[data_stack.count - 1];
-            continue;
+    OP(IR_EXPECT):
+        assert(t->parser->type == PARSER_EXPECT);
+        if(!is_noerror(s))
+            expect(s, e, t->parser->match.expect.what);
+        DISPATCH();
 
-        case IR_INCREMENT:
-            assert(data_stack.count >= 1);
-            data_stack.data[data_stack.count - 1]++; // TODO: range check
-            continue;
+    OP(IR_PUSH_BINDING):
+        assert(t->parser->type == PARSER_BIND);
+        if((err = scope_push(s, t->parser->match.bind.binding)))
+            goto cleanup;
+        DISPATCH();
 
-        case IR_DECREMENT:
-            assert(data_stack.count >= 1);
-            data_stack.data[data_stack.count - 1]--; // TODO: range check
-            continue;
+    OP(IR_POP_BINDING):
+        assert(t->parser->type == PARSER_BIND);
+        if(scope_pop(s) != t->parser->match.bind.binding->p) {
+            assert(false && "scope stack corrupt");
+            unreachable();
+        }
+        DISPATCH();
 
-        case IR_SAVE_LOCATION:
-            t->loc = s->loc;
-            continue;
+    OP(IR_NULL_RESULT):
+        if(!is_noreturn(s) && (err = result_push(&result_stack, NULL)))
+            goto cleanup;
+        DISPATCH();
 
-        case IR_RESTORE_LOCATION:
-            s->loc = t->loc;
-            continue;
+    OP(IR_POP_RESULT):
+        if(!is_noreturn(s))
+            result_pop(&result_stack);
+        DISPATCH();
 
-        case IR_SET_NORETURN:
-            assert(data_stack.count >= 1);
+    OP(IR_REDUCE_INIT): {
+        assert(t->parser->type == PARSER_REDUCE);
+        if(is_noreturn(s))
+            DISPATCH();
 
-            v = data_stack.data[data_stack.count - 1];
-            data_stack.data[data_stack.count - 1] = set_flag(s, CC_STATE_FLAG_NORETURN, v);
-            continue;
+        struct cc_result acc = t->parser->match.reduce.init();
+        if(acc.err && (err = reduce_error(s, &acc)))
+            goto cleanup;
 
-        case IR_SET_NOERROR:
-            assert(data_stack.count >= 1);
+        struct cc_lazy_reduce *reduce = lazy_reduce(&s->arena, s->pos, acc);
+        if(!reduce) {
+            err = ENOMEM;
+            goto cleanup;
+        }
 
-            v = data_stack.data[data_stack.count - 1];
-            data_stack.data[data_stack.count - 1] = set_flag(s, CC_STATE_FLAG_NOERROR, v);
-            continue;
+        if((err = result_push(&result_stack, LAZY_UPCAST(reduce))))
+            goto cleanup;
+        DISPATCH();
+    }
 
-        case IR_CALL:
-            assert(t->parser->ir->count - t->ip >= sizeof(uintptr_t));
-            
-            if((err = frame_push(&call_stack, (struct frame){
-                .parser = (struct cc_parser*) ir_read_ptr(t->parser->ir, t->ip), // call destination
-                .sp = data_stack.count,     // save stack pointer
-                .rp = result_stack.count,   // save result pointer
-                .ip = 0,                    // initial instruction pointer
-            })))
-                goto cleanup;
-            t->ip += sizeof(uintptr_t);
-            continue;
+    OP(IR_REDUCE): {
+        assert(t->parser->type == PARSER_REDUCE);
+        if(is_noreturn(s))
+            DISPATCH();
 
-        case IR_RETURN:
-        do_return:
-            assert(data_stack.count >= t->sp);
+        assert(result_stack.count >= 2);
+        lazy = result_pop(&result_stack);
 
-            if(is_noreturn(s) || !call_success) {
-                while(result_stack.count > t->rp) {
-                    struct cc_lazy *lazy = result_pop(&result_stack);
-                    if((err = lazy_free(lazy, &result_stack)))
-                        goto cleanup;
-                }
+        struct cc_lazy_reduce *reduce = LAZY_DOWNCAST(result_top(&result_stack), struct cc_lazy_reduce);
+        assert(reduce->lazy.type == LAZY_REDUCE);
 
-                assert(result_stack.count == t->rp);
-            }
-            else {
-                assert(result_stack.count == t->rp + 1);
+        // after an error, the remaining results are only parsed
+        if(!reduce->acc.err) {
+            struct cc_result x;
+            if((res = lazy_eval(s, lazy, &result_stack, &data_stack, &value_stack, &x)) < 0) {
+                err = -res;
+                goto cleanup;
             }
 
-            data_stack.count = t->sp;   // restore stack pointer
-            frame_pop(&call_stack);     // return to caller
-                
-            if((err = data_push(&data_stack, call_success)))
+            // the accumulator is kept next to the error, so the caller can still free it
+            if(res == PARSE_FAILURE)
+                reduce->acc.err = x.err;
+            else if((reduce->acc = t->parser->match.reduce.step(reduce->acc.out, x.out)).err && (err = reduce_error(s, &reduce->acc)))
                 goto cleanup;
-            continue;
+        }
 
-        case IR_FOLD:
-            uint32_t n = data_pop(&data_stack);
-            if(is_noreturn(s))
-                continue;
+        // the lazy nodes of the result are no longer used
+        arena_reset(&s->arena, MAX(t->mark, memo_pin));
+        DISPATCH();
+    }
 
-            assert(result_stack.count >= n);
-            result_stack.count -= n;
+    OP(IR_JUMP):
+        ip = IR_ALIGN(ip, uint32_t);
 
-            struct cc_lazy_fold *fold = lazy_fold(s->loc, t->parser->fold, n, result_stack.items + result_stack.count);
-            if(!fold) {
-                err = ENOMEM;
-                goto cleanup;
-                
-            }
+        ip = ir_read_u32(ir, ip);
 
-            if((err = result_push(&result_stack, LAZY_UPCAST(fold))))
-                goto cleanup;
-            continue;
+        assert(ip != UINT32_MAX && "unpatched jump target");
+        DISPATCH();
 
-        case IR_APPLY:
-            assert(t->parser->type == PARSER_APPLY);
-            if(is_noreturn(s))
-                continue;
+    OP(IR_JUMP_IF_NONZERO):
+        ip = IR_ALIGN(ip, uint32_t);
 
-            assert(result_stack.count > 0);
+        if(data_pop(&data_stack) != 0)
+            ip = ir_read_u32(ir, ip);
+        else
+            ip += sizeof(uint32_t);
 
-            struct cc_lazy *result_top = result_stack.items[result_stack.count - 1];
-            struct cc_lazy_apply *apply = lazy_apply(s->loc, t->parser->match.apply.af, result_top);
-            if(!apply) {
-                err = ENOMEM;
-                goto cleanup;
-            }
-        
-            result_stack.items[result_stack.count - 1] = LAZY_UPCAST(apply);
-            continue;
+        assert(ip != UINT32_MAX && "unpatched jump target");
+        DISPATCH();
 
-        case IR_EXPECT:
-            assert(t->parser->type == PARSER_EXPECT);
-            if(is_noerror(s))
-                continue;
+    OP(IR_JUMP_IF_SUCCESS):
+        ip = IR_ALIGN(ip, uint32_t);
 
-            if(r->err->num_expected == 0) {
-                r->err->filename = s->src->origin;
-                r->err->loc = s->loc;
-                r->err->received = peek_at(s);
-            }
+        if(data_pop(&data_stack) != PARSE_FAILURE)
+            ip = ir_read_u32(ir, ip);
+        else
+            ip += sizeof(uint32_t);
 
-            cc_add_expected(r->err, t->parser->match.expect.what);
-            continue;
+        assert(ip != UINT32_MAX && "unpatched jump target");
+        DISPATCH();
 
-        case IR_PUSH_BINDING:
-            assert(t->parser->type == PARSER_BIND);
-            if((err = scope_push(s, t->parser->match.bind.binding)))
-                goto cleanup;
-            continue;
+    OP(IR_JUMP_IF_FAILURE):
+        ip = IR_ALIGN(ip, uint32_t);
 
-        case IR_POP_BINDING:
-            assert(t->parser->type == PARSER_BIND);
-            if(scope_pop(s) != t->parser->match.bind.binding->p) {
-                assert(false && "scope stack corrupt");
-                unreachable();
-            }
-            continue;
+        if(data_pop(&data_stack) == PARSE_FAILURE)
+            ip = ir_read_u32(ir, ip);
+        else
+            ip += sizeof(uint32_t);
 
-        case IR_NULL_RESULT:
-            if(!is_noreturn(s) && (err = result_push(&result_stack, NULL)))
-                goto cleanup;
-            continue;
+        assert(ip != UINT32_MAX && "unpatched jump target");
+        DISPATCH();
 
-        case IR_POP_RESULT:
-            if(!is_noreturn(s)) {
-                struct cc_lazy *lazy = result_pop(&result_stack);
-                if((err = lazy_free(lazy, &result_stack)))
-                    goto cleanup;
-            }
-            continue;
+    // operand layout: [u32 target] [u32 n | IR_PREDICT_UNKNOWN] [u32 first set[FIRST_SET_WORDS]] [what[n]]
+    OP(IR_PREDICT):
+        ip = IR_ALIGN(ip, uintptr_t);
+        v = ir_read_u32(ir, ip + sizeof(uint32_t));
 
-        case IR_JUMP:
-            assert(t->parser->ir->count - t->ip >= sizeof(uint32_t));
+        if(v != IR_PREDICT_UNKNOWN || is_noerror(s)) {
+            uint32_t i = first_set_index(peek_at(s));
+            if(is_eof(s) || !(ir_read_u32(ir, ip + (2 + i / 32) * sizeof(uint32_t)) & (1u << (i % 32)))) {
+                // the variant cannot match, add the error entries it would have added
+                for(i = 0; i < v && !is_noerror(s); i++)
+                    expect(s, e, (const char*) ir_read_ptr(ir, ip + (2 + FIRST_SET_WORDS) * sizeof(uint32_t) + i * sizeof(uintptr_t)));
 
-            t->ip = ir_read_u32(t->parser->ir, t->ip);
+                ip = ir_read_u32(ir, ip);
 
-            assert(t->ip != UINT32_MAX && "unpatched jump target");
-            continue;
+                assert(ip != UINT32_MAX && "unpatched jump target");
+                DISPATCH();
+            }
+        }
 
-        case IR_JUMP_IF_NONZERO:
-            assert(t->parser->ir->count - t->ip >= sizeof(uint32_t));
+        ip += (2 + FIRST_SET_WORDS) * sizeof(uint32_t) + (v == IR_PREDICT_UNKNOWN ? 0 : v) * sizeof(uintptr_t);
+        DISPATCH();
+
+    // inline terminal matches, operand layout: [what] [u32 char | u32 lo, u32 hi | parser]
+    OP(IR_MATCH):
+        ip = IR_ALIGN(ip, uintptr_t);
+        what = (const char*) ir_read_ptr(ir, ip);
+        terminal = (struct cc_parser*) ir_read_ptr(ir, ip + sizeof(uintptr_t));
+        ip += 2 * sizeof(uintptr_t);
+
+        res = call_terminal(s, terminal, &lazy, e);
+        goto match_result;
+
+    OP(IR_MATCH_CHAR):
+        ip = IR_ALIGN(ip, uintptr_t);
+        what = (const char*) ir_read_ptr(ir, ip);
+        v = ir_read_u32(ir, ip + sizeof(uintptr_t));
+        ip += sizeof(uintptr_t) + sizeof(uint32_t);
+
+        lazy = NULL;
+        res = match_char(s, v, &lazy);
+        goto match_result;
+
+    OP(IR_MATCH_RANGE):
+        ip = IR_ALIGN(ip, uintptr_t);
+        what = (const char*) ir_read_ptr(ir, ip);
+        v = ir_read_u32(ir, ip + sizeof(uintptr_t));
+        ip += sizeof(uintptr_t) + sizeof(uint32_t);
+
+        lazy = NULL;
+        res = match_range(s, v, ir_read_u32(ir, ip), &lazy);
+        ip += sizeof(uint32_t);
+        goto match_result;
+
+    OP(IR_MATCH_SET):
+        ip = IR_ALIGN(ip, uintptr_t);
+        what = (const char*) ir_read_ptr(ir, ip);
+        terminal = (struct cc_parser*) ir_read_ptr(ir, ip + sizeof(uintptr_t));
+        ip += 2 * sizeof(uintptr_t);
+
+        lazy = NULL;
+        res = match_class(s, terminal->match.list.class, terminal->type == PARSER_NONEOF, &lazy);
+        goto match_result;
+
+    OP(IR_MATCH_STRING):
+        ip = IR_ALIGN(ip, uintptr_t);
+        what = (const char*) ir_read_ptr(ir, ip);
+        terminal = (struct cc_parser*) ir_read_ptr(ir, ip + sizeof(uintptr_t));
+        ip += 2 * sizeof(uintptr_t);
+
+        lazy = NULL;
+        res = match_string(s, terminal, &lazy);
+
+    match_result:
+        if(res < 0) {
+            err = -res;
+            goto cleanup;
+        }
 
-            if(data_pop(&data_stack) != 0)
-                t->ip = ir_read_u32(t->parser->ir, t->ip);
-            else
-                t->ip += sizeof(uint32_t);
+        if(res == PARSE_SUCCESS && !is_noreturn(s) && (err = result_push(&result_stack, lazy)))
+            goto cleanup;
+        else if(res == PARSE_FAILURE && what && !is_noerror(s))
+            expect(s, e, what);
 
-            assert(t->ip != UINT32_MAX && "unpatched jump target");
-            continue;
+        if((err = data_push(&data_stack, res)))
+            goto cleanup;
+        DISPATCH();
 
-        case IR_JUMP_IF_SUCCESS:
-            assert(t->parser->ir->count - t->ip >= sizeof(uint32_t));
+    // operand layout: [struct scan_class] [u32 target]
+    OP(IR_SCAN_CLASS): {
+        ip = IR_ALIGN(ip, struct scan_class);
 
-            if(data_pop(&data_stack) != PARSE_FAILURE)
-                t->ip = ir_read_u32(t->parser->ir, t->ip);
-            else
-                t->ip += sizeof(uint32_t);
+        // only emitted where the results of the class are not needed
+        struct scan_class class;
+        memcpy(&class, ir->bytes + ip, sizeof(struct scan_class));
+        if((res = scan_run(s, &class, e)) < 0) {
+            err = -res;
+            goto cleanup;
+        }
 
-            assert(t->ip != UINT32_MAX && "unpatched jump target");
-            continue;
+        ip = ir_read_u32(ir, ip + sizeof(struct scan_class));
 
-        case IR_JUMP_IF_FAILURE:
-            assert(t->parser->ir->count - t->ip >= sizeof(uint32_t));
+        assert(ip != UINT32_MAX && "unpatched jump target");
+        DISPATCH();
+    }
 
-            if(data_pop(&data_stack) == PARSE_FAILURE)
-                t->ip = ir_read_u32(t->parser->ir, t->ip);
-            else
-                t->ip += sizeof(uint32_t);
+    // operand layout: [string] [u32 length]
+    OP(IR_SCAN_UNTIL):
+        ip = IR_ALIGN(ip, uintptr_t);
 
-            assert(t->ip != UINT32_MAX && "unpatched jump target");
-            continue;
+        // the loop following this instruction matches the string afterwards
+        if(is_noreturn(s))
+            scan_until(s, (const char8_t*) ir_read_ptr(ir, ip), ir_read_u32(ir, ip + sizeof(uintptr_t)));
 
-        default:
-            ir_dump(t->parser->ir, stderr);
-            if(!is_noerror(s) && (err = new_error(r->err, s, format("undefined opcode <%02hhx> at <%04x>", t->parser->ir->bytes[t->ip - 1], t->ip - 1), false)))
-                goto cleanup;
-            call_success = PARSE_FAILURE;
-            goto do_return;
-        }
+        ip += sizeof(uintptr_t) + sizeof(uint32_t);
+        DISPATCH();
+
+    OP_UNDEFINED:
+        ir_dump(ir, stderr);
+        if(!is_noerror(s) && (err = new_error(e, s, t->parser, format("undefined opcode <%02hhx> at <%04x>", ir->bytes[ip - 1], ip - 1))))
+            goto cleanup;
+        call_success = PARSE_FAILURE;
+        goto do_return;
+#ifndef CC_THREADED_DISPATCH
     }
+#endif
 
+finish:
     assert(data_stack.count >= 1);
     call_success = data_pop(&data_stack);
 
+    // no parser is left to backtrack
+    if(call_success == PARSE_SUCCESS && s->events.handler && (err = events_flush(s)))
+        goto cleanup;
+
     if(call_success == PARSE_SUCCESS && !is_noreturn(s)) {
-        cc_err_free(r->err);
+        assert(result_stack.count == 1 && "no result left on stack");
+        struct cc_lazy *root = result_pop(&result_stack);
 
-        if((err = lazy_eval(s, &result_stack, &data_stack, r)) < 0)
-            err = -err;
+        if((res = lazy_eval(s, root, &result_stack, &data_stack, &value_stack, r)) < 0)
+            err = -res;
         else
-            call_success = err;
+            call_success = res;
     }
-cleanup:
-    while(result_stack.count > 0) {
-        struct cc_lazy *lazy = result_pop(&result_stack);
-        if(lazy_free(lazy, &result_stack))
-            break;
+    else if(call_success == PARSE_FAILURE) {
+        s->rejected = true;
+        if(!(r->err = report_error(s, e)))
+            err = errno;
     }
-    if(result_stack.items)
-        free(result_stack.items);
-    if(data_stack.data)
-        free(data_stack.data);
-    if(call_stack.items)
-        free(call_stack.items);
+cleanup:
+    // all lazy nodes are released at once
+    arena_reset(&s->arena, 0);
+    memo_clear(&memo);
+
+    // leave the context ready for the next parse
+    s->frames = NULL;
+    s->error = NULL;
+    s->failed = NULL;
+    s->events.base = s->events.count = 0;
+    while(s->scope.head)
+        scope_pop(s);
+
+    free((void*) e->failure);
+    memset(e, 0, sizeof(struct cc_error));
+
+    data_stack.count = 0;
+    result_stack.count = 0;
+    call_stack.count = 0;
+    value_stack.count = 0;
+
+    ctx->data_stack = data_stack;
+    ctx->result_stack = result_stack;
+    ctx->call_stack = call_stack;
+    ctx->value_stack = value_stack;
+    ctx->memo = memo;
     return err ? -err : (int) call_success;
 }
 
+#undef OP
+#undef OP_UNDEFINED
+#undef DISPATCH
+#undef LOAD_FRAME
+
 int cc_parse(const struct cc_source *src, struct cc_parser *p, struct cc_result *r) {
+    return cc_parse_with(src, p, r, CC_PARSE_DEFAULT);
+}
+
+int cc_parse_with(const struct cc_source *src, struct cc_parser *p, struct cc_result *r, int flags) {
+    struct cc_context ctx;
+
+    int err;
+    if((err = context_init(&ctx))) {
+        if(r)
+            memset(r, 0, sizeof(struct cc_result));
+        cc_release(p);
+        return err;
+    }
+
+    err = cc_parse_ctx(&ctx, src, p, r, flags);
+
+    context_free(&ctx);
+    return err;
+}
+
+struct cc_context *cc_context_create(void) {
+    struct cc_context *ctx = malloc(sizeof(struct cc_context));
+    if(!ctx)
+        return NULL;
+
+    int err;
+    if((err = context_init(ctx))) {
+        free(ctx);
+        errno = err;
+        return NULL;
+    }
+
+    return ctx;
+}
+
+void cc_context_reset(struct cc_context *ctx) {
+    if(ctx)
+        context_release(ctx);
+}
+
+void cc_context_destroy(struct cc_context *ctx) {
+    if(!ctx)
+        return;
+
+    context_free(ctx);
+    free(ctx);
+}
+
+// runs `p` on `src` from the start of its remaining input with the state flags `flags`
+static int parse_once(struct cc_context *ctx, const struct cc_source *src, struct cc_parser *p, struct cc_result *r, int flags) {
+    struct cc_state *s = &ctx->state;
+    s->flags = flags;
+    s->pos = src->stream.read ? src->stream.pos.byte_off : 0;
+    s->src = src;
+    lines_reset(s, src->stream.read ? src->stream.pos : CC_LOCATION_DEFAULT);
+
+    return ir_eval(ctx, p, r);
+}
+
+int cc_parse_ctx(struct cc_context *ctx, const struct cc_source *src, struct cc_parser *p, struct cc_result *r, int flags) {
     if(r)
         memset(r, 0, sizeof(struct cc_result));
-    
+
     int err = 0;
-    struct cc_state s;
-    if((err = state_init(&s)))
-        goto cleanup;
-    
-    if(!src || !p || !r) {
+    if(!ctx || !src || !p || !r) {
         err = EINVAL;
         goto cleanup;
     }
 
-    s.src = src;
-    
-    r->err = NULL;
-    r->out = NULL;
+    struct cc_state *s = &ctx->state;
+    int state_flags = CC_STATE_FLAGS_DEFAULT;
+    if(flags & CC_PARSE_MEMOIZE)
+        state_flags |= CC_STATE_FLAG_MEMOIZE;
 
-    int res = ir_eval(&s, p, r);
+    // streams cannot be parsed twice, as the input is discarded while parsing
+    bool lazy_errors = (flags & CC_PARSE_LAZY_ERRORS) && !src->stream.read;
+
+    int res = parse_once(ctx, src, p, r, lazy_errors ? state_flags | CC_STATE_FLAG_NOERROR : state_flags);
+    if(lazy_errors && res == PARSE_FAILURE && s->rejected) {
+        // the input is invalid, parse it again to build the error report.
+        // errors of actions already have their location and are not parsed again, as the actions would run twice
+        if(r->err)
+            cc_err_free(r->err);
+        memset(r, 0, sizeof(struct cc_result));
+
+        res = parse_once(ctx, src, p, r, state_flags);
+    }
 
     if(res < 0) {
         // resource error, ideally this should never happen
-        cc_err_free(r->err);
+        if(r->err)
+            cc_err_free(r->err);
+        r->err = NULL;
         err = -res;
+    }
+    else if(src->stream.read) {
+        // streams continue after the consumed input on the next parse
+        if(res == PARSE_SUCCESS && (err = lines_resolve(s, s->pos, &((struct cc_source*) src)->stream.pos)))
+            goto cleanup;
+        err = src->stream.err;
+    }
+
+cleanup:
+    cc_release(p);
+    return err;
+}
+
+int cc_parse_events(const struct cc_source *src, struct cc_parser *p, cc_event_t handler, void *userp, struct cc_error **e) {
+    if(e)
+        *e = NULL;
+
+    if(!src || !p || !handler) {
+        cc_release(p);
+        return -EINVAL;
+    }
+
+    struct cc_context ctx;
+    int err;
+    if((err = context_init(&ctx))) {
+        cc_release(p);
+        return -err;
+    }
+
+    struct cc_state *s = &ctx.state;
+    s->events.handler = handler;
+    s->events.userp = userp;
+
+    // no results are built, error reports only if they are asked for
+    struct cc_result r = {0};
+    int res = parse_once(&ctx, src, p, &r, CC_STATE_FLAG_NORETURN | (e ? 0 : CC_STATE_FLAG_NOERROR));
+
+    if(res < 0) {
+        if(r.err)
+            cc_err_free(r.err);
+        r.err = NULL;
+        err = -res;
+    }
+    else if(src->stream.read) {
+        // streams continue after the consumed input on the next parse
+        if(res == PARSE_SUCCESS && (err = lines_resolve(s, s->pos, &((struct cc_source*) src)->stream.pos)))
+            goto cleanup;
+        err = src->stream.err;
+    }
+
+    if(r.err) {
+        if(e && !err)
+            *e = r.err;
+        else
+            cc_err_free(r.err);
+    }
+
+cleanup:
+    context_free(&ctx);
+    cc_release(p);
+    return err ? -err : res == PARSE_SUCCESS ? CC_MATCH : CC_NOMATCH;
+}
+
+// shared state of a `cc_parse_batch` call
+struct batch {
+    const struct cc_source *const *sources;
+    struct cc_result *results;
+    struct cc_parser *p;
+    size_t n;
+    size_t next; // index of the next source to parse, workers take sources from here until all are done
+    int err;     // first internal error
+};
+
+static void batch_error(struct batch *b, int err) {
+    int none = 0;
+    __atomic_compare_exchange_n(&b->err, &none, err, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void *batch_worker(void *userp) {
+    struct batch *b = userp;
+
+    struct cc_context ctx;
+    int err;
+    if((err = context_init(&ctx))) {
+        batch_error(b, err);
+        return NULL;
+    }
+
+    size_t i;
+    while((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->n) {
+        if((err = cc_parse_ctx(&ctx, b->sources[i], cc_retain(b->p), &b->results[i], CC_PARSE_DEFAULT)))
+            batch_error(b, err);
+    }
+
+    context_free(&ctx);
+    return NULL;
+}
+
+int cc_parse_batch(const struct cc_source *const sources[], size_t n, struct cc_parser *p, struct cc_result results[], unsigned nthreads) {
+    int err = 0;
+    pthread_t *threads = NULL;
+
+    if(!p || (n > 0 && (!sources || !results))) {
+        err = EINVAL;
         goto cleanup;
     }
 
-    if(res == PARSE_SUCCESS) {
-        cc_err_free(r->err);
-        r->err = NULL;
+    memset(results, 0, n * sizeof(struct cc_result));
+
+    if(!(p = cc_freeze(p)))
+        return errno;
+
+    if(nthreads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = online > 0 ? (unsigned) online : 1;
+    }
+    nthreads = MAX(MIN(nthreads, n), 1);
+
+    struct batch b = {
+        .sources = sources,
+        .results = results,
+        .p = p,
+        .n = n,
+    };
+
+    // the calling thread is the first worker
+    if(nthreads > 1 && !(threads = calloc(nthreads - 1, sizeof(pthread_t)))) {
+        err = errno;
+        goto cleanup;
     }
 
+    unsigned started = 0;
+    for(; started < nthreads - 1; started++) {
+        if(pthread_create(&threads[started], NULL, batch_worker, &b))
+            break; // continue with fewer threads
+    }
+
+    batch_worker(&b);
+
+    for(unsigned i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    err = b.err;
 cleanup:
-    state_free(&s);
+    free(threads);
     cc_release(p);
     return err;
 }
-
@@ -1,55 +1,121 @@
 #include "internal.h"
 
-__internal struct cc_lazy_value *lazy_value(struct cc_location loc, void *value) {
-    struct cc_lazy_value *lazy = malloc(sizeof(struct cc_lazy_value));
-    if(!lazy)
-        return NULL;
+#define ARENA_CHUNK_MIN (16 * 1024)
+#define ARENA_CHUNK_MAX (1024 * 1024)
+
+#define ARENA_ALIGN(n) (((n) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+// moves on to the next chunk, which is either reused or newly allocated
+static void *arena_grow(struct cc_arena *a, size_t size) {
+    struct cc_arena_chunk *c = a->current;
+    struct cc_arena_chunk *next = c ? c->next : a->first;
+
+    if(!next || next->size < size) {
+        size_t chunk_size = c ? MIN(c->size * 2, ARENA_CHUNK_MAX) : ARENA_CHUNK_MIN;
+        chunk_size = MAX(chunk_size, size);
+
+        struct cc_arena_chunk *new = malloc(sizeof(struct cc_arena_chunk) + chunk_size);
+        if(!new)
+            return NULL;
+
+        new->size = chunk_size;
+        new->prev = c;
+        new->next = next;
+
+        if(next)
+            next->prev = new;
+        if(c)
+            c->next = new;
+        else
+            a->first = new;
+        next = new;
+    }
 
-    lazy->lazy.type = LAZY_VALUE;
-    lazy->lazy.location = loc;
-    lazy->value = value;
+    next->base = c ? c->base + c->size : 0;
+    next->used = size;
+    a->current = next;
+    return next->data;
+}
 
-    return lazy;
+static inline void *arena_alloc(struct cc_arena *a, size_t size) {
+    size = ARENA_ALIGN(size);
+
+    struct cc_arena_chunk *c = a->current;
+    if(!c || c->size - c->used < size)
+        return arena_grow(a, size);
+
+    void *p = c->data + c->used;
+    c->used += size;
+    return p;
 }
 
-__internal struct cc_lazy_inline *lazy_inline(struct cc_location loc, void *value, size_t size) {
-    struct cc_lazy_inline *lazy = malloc(sizeof(struct cc_lazy_inline) + size);
+__internal void arena_reset(struct cc_arena *a, size_t mark) {
+    struct cc_arena_chunk *c = a->current;
+    if(!c)
+        return;
+
+    while(c->prev && c->base > mark)
+        c = c->prev;
+
+    assert(mark >= c->base && mark - c->base <= c->used && "invalid arena mark");
+
+    c->used = mark - c->base;
+    a->current = c;
+}
+
+__internal void arena_free(struct cc_arena *a) {
+    struct cc_arena_chunk *c = a->first;
+    while(c) {
+        struct cc_arena_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+
+    a->first = a->current = NULL;
+}
+
+__internal struct cc_lazy *lazy_value(struct cc_arena *a, size_t loc, void *value) {
+    if(lazy_value_fits(value))
+        return (struct cc_lazy*) (((uintptr_t) value << LAZY_TAG_BITS) | LAZY_TAG_VALUE);
+
+    struct cc_lazy_value *lazy = arena_alloc(a, sizeof(struct cc_lazy_value));
     if(!lazy)
         return NULL;
 
-    lazy->lazy.type = LAZY_INLINE;
+    lazy->lazy.type = LAZY_VALUE;
     lazy->lazy.location = loc;
-    memcpy(lazy->value, value, size);
+    lazy->value = value;
 
-    return lazy;
+    return LAZY_UPCAST(lazy);
 }
 
-__internal struct cc_lazy_char *lazy_char(struct cc_location loc, char32_t ch) {
-    struct cc_lazy_char *lazy = malloc(sizeof(struct cc_lazy_char));
+__internal struct cc_lazy_inline *lazy_inline(struct cc_arena *a, size_t loc, void *value, size_t size) {
+    struct cc_lazy_inline *lazy = arena_alloc(a, sizeof(struct cc_lazy_inline) + size);
     if(!lazy)
         return NULL;
 
-    lazy->lazy.type = LAZY_CHAR;
+    lazy->lazy.type = LAZY_INLINE;
     lazy->lazy.location = loc;
-    lazy->ch = ch;
+    lazy->size = size;
+    memcpy(lazy->value, value, size);
 
     return lazy;
 }
 
-__internal struct cc_lazy_terminal *lazy_terminal(struct cc_location loc, struct cc_parser *p) {
-    struct cc_lazy_terminal *lazy = malloc(sizeof(struct cc_lazy_terminal));
+__internal struct cc_lazy_terminal *lazy_terminal(struct cc_arena *a, size_t loc, struct cc_parser *p) {
+    struct cc_lazy_terminal *lazy = arena_alloc(a, sizeof(struct cc_lazy_terminal));
     if(!lazy)
         return NULL;
 
     lazy->lazy.type = LAZY_TERMINAL;
     lazy->lazy.location = loc;
-    lazy->p = cc_retain(p);
+    lazy->p = p; // kept alive by the parser being run
 
     return lazy;
 }
 
-__internal struct cc_lazy_lift *lazy_lift(struct cc_location loc, cc_lift_t lift) {
-    struct cc_lazy_lift *lazy = malloc(sizeof(struct cc_lazy_lift));
+__internal struct cc_lazy_lift *lazy_lift(struct cc_arena *a, size_t loc, cc_lift_t lift) {
+    struct cc_lazy_lift *lazy = arena_alloc(a, sizeof(struct cc_lazy_lift));
     if(!lazy)
         return NULL;
 
@@ -60,8 +126,8 @@ __internal struct cc_lazy_lift *lazy_lift(struct cc_location loc, cc_lift_t lift
     return lazy;
 }
 
-__internal struct cc_lazy_fold *lazy_fold(struct cc_location loc, cc_fold_t fold, unsigned n, struct cc_lazy *values[]) {
-    struct cc_lazy_fold *lazy = malloc(sizeof(struct cc_lazy_fold) + n * sizeof(struct cc_lazy*));
+__internal struct cc_lazy_fold *lazy_fold(struct cc_arena *a, size_t loc, cc_fold_t fold, unsigned n, struct cc_lazy *values[]) {
+    struct cc_lazy_fold *lazy = arena_alloc(a, sizeof(struct cc_lazy_fold) + n * sizeof(struct cc_lazy*));
     if(!lazy)
         return NULL;
 
@@ -77,8 +143,8 @@ __internal struct cc_lazy_fold *lazy_fold(struct cc_location loc, cc_fold_t fold
     return lazy;
 }
 
-__internal struct cc_lazy_apply *lazy_apply(struct cc_location loc, cc_apply_t apply, struct cc_lazy *value) {
-    struct cc_lazy_apply *lazy = malloc(sizeof(struct cc_lazy_apply));
+__internal struct cc_lazy_apply *lazy_apply(struct cc_arena *a, size_t loc, cc_apply_t apply, struct cc_lazy *value) {
+    struct cc_lazy_apply *lazy = arena_alloc(a, sizeof(struct cc_lazy_apply));
     if(!lazy)
         return NULL;
 
@@ -92,94 +158,41 @@ __internal struct cc_lazy_apply *lazy_apply(struct cc_location loc, cc_apply_t a
     return lazy;
 }
 
-static void lazy_free_value(struct cc_lazy_value *lazy) {
-    free(lazy);
-}
-
-static void lazy_free_inline(struct cc_lazy_inline *lazy) {
-    free(lazy);
-}
+__internal struct cc_lazy_reduce *lazy_reduce(struct cc_arena *a, size_t loc, struct cc_result acc) {
+    struct cc_lazy_reduce *lazy = arena_alloc(a, sizeof(struct cc_lazy_reduce));
+    if(!lazy)
+        return NULL;
 
-static void lazy_free_char(struct cc_lazy_char *lazy) {
-    free(lazy);
-}
+    lazy->lazy.type = LAZY_REDUCE;
+    lazy->lazy.location = loc;
+    lazy->acc = acc;
 
-static void lazy_free_terminal(struct cc_lazy_terminal *lazy) {
-    cc_release(lazy->p);
-    free(lazy);
+    return lazy;
 }
 
-static void lazy_free_lift(struct cc_lazy_lift *lazy) {
-    free(lazy);
-}
+__internal struct cc_lazy_span *lazy_span(struct cc_arena *a, size_t loc, const char8_t *ptr, size_t len, bool copy) {
+    struct cc_lazy_span *lazy = arena_alloc(a, sizeof(struct cc_lazy_span) + (copy ? len : 0));
+    if(!lazy)
+        return NULL;
 
-static int lazy_free_fold(struct cc_lazy_fold *lazy, struct result_stack *stack) {
-    for(unsigned i = 0; i < lazy->n; i++) {
-        int err = result_push(stack, lazy->values[i]);
-        if(err)
-            return err;
-    }
+    lazy->lazy.type = LAZY_SPAN;
+    lazy->lazy.location = loc;
+    lazy->span.ptr = copy ? NULL : ptr;
+    lazy->span.len = len;
 
-    free(lazy);
-    return 0;
-}
+    if(copy)
+        memcpy(lazy->data, ptr, len);
 
-static int lazy_free_apply(struct cc_lazy_apply *lazy, struct result_stack *stack) {
-    int err = result_push(stack, lazy->value);
-    free(lazy);
-    return err;
+    return lazy;
 }
 
-__internal int lazy_free(struct cc_lazy *lazy, struct result_stack *stack) {
+__internal struct cc_lazy_span *lazy_text(struct cc_arena *a, size_t loc, const char8_t *ptr, size_t len, bool copy) {
+    struct cc_lazy_span *lazy = lazy_span(a, loc, ptr, len, copy);
     if(!lazy)
-        return 0;
-    if(!stack)
-        return EINVAL;
-
-    int err;
-    size_t stack_before = stack->count;
-
-    if((err = result_push(stack, lazy)))
-        goto cleanup;
-
-    while(stack->count > stack_before) {
-        if(!(lazy = result_pop(stack)))
-            continue;
-
-        switch(lazy->type) {
-        case LAZY_VALUE:
-            lazy_free_value(LAZY_DOWNCAST(lazy, struct cc_lazy_value));
-            break;
-        case LAZY_INLINE:
-            lazy_free_inline(LAZY_DOWNCAST(lazy, struct cc_lazy_inline));
-            break;
-        case LAZY_CHAR:
-            lazy_free_char(LAZY_DOWNCAST(lazy, struct cc_lazy_char));
-            break;
-        case LAZY_TERMINAL:
-            lazy_free_terminal(LAZY_DOWNCAST(lazy, struct cc_lazy_terminal));
-            break;
-        case LAZY_LIFT:
-            lazy_free_lift(LAZY_DOWNCAST(lazy, struct cc_lazy_lift));
-            break;
-        case LAZY_FOLD:
-            if((err = lazy_free_fold(LAZY_DOWNCAST(lazy, struct cc_lazy_fold), stack)))
-                goto cleanup;
-            break;
-        case LAZY_APPLY:
-            if((err = lazy_free_apply(LAZY_DOWNCAST(lazy, struct cc_lazy_apply), stack)))
-                goto cleanup;
-            break;
-        default:
-            fprintf(stderr, "%d\n", lazy->type);
-            assert(false && "unknown lazy type");
-            unreachable();
-        }
-    }
+        return NULL;
 
-cleanup:
-    stack->count = stack_before;
-    return err;
+    lazy->lazy.type = LAZY_TEXT;
+    return lazy;
 }
 
 __internal void *lazy_eval(struct cc_lazy *lazy) {
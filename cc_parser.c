@@ -8,20 +8,100 @@
 
 struct cc_parser *cc_retain(struct cc_parser *p) {
     // ignore NULL (simplifies error propagation)
-    if(p)
+    if(!p)
+        return p;
+
+    if(p->flags & PARSER_FLAG_FROZEN)
+        __atomic_add_fetch(&p->rc, 1, __ATOMIC_RELAXED);
+    else
         p->rc++;
         
     return p;
 }
 
 struct cc_parser *cc_release(struct cc_parser *p) {
-    if(!p || --p->rc > 0)
+    if(!p)
+        return p;
+
+    uint32_t rc = p->flags & PARSER_FLAG_FROZEN
+        ? __atomic_sub_fetch(&p->rc, 1, __ATOMIC_ACQ_REL)
+        : --p->rc;
+    if(rc > 0)
         return p;
 
     parser_free(p);
     return NULL;
 }
 
+// compiles `p` and every parser reachable from it, marking them as frozen
+static int parser_freeze(struct cc_parser *p) {
+    if(!p || (p->flags & PARSER_FLAG_FROZEN))
+        return 0;
+
+    p->flags |= PARSER_FLAG_FROZEN; // before recursing, since `cc_fix` creates cycles
+
+    int err;
+    if((err = cc_compile(p)))
+        return err;
+
+    switch(p->type) {
+        case PARSER_EXPECT:
+            return parser_freeze(p->match.expect.inner);
+        case PARSER_APPLY:
+            return parser_freeze(p->match.apply.inner);
+        case PARSER_REDUCE:
+            return parser_freeze(p->match.reduce.inner);
+        case PARSER_NOT:
+        case PARSER_MANY:
+        case PARSER_COUNT:
+        case PARSER_MAYBE:
+        case PARSER_LEAST:
+        case PARSER_NOERROR:
+        case PARSER_NORETURN:
+        case PARSER_MEMO:
+        case PARSER_CAPTURE:
+            return parser_freeze(p->match.unary.inner);
+        case PARSER_AND:
+        case PARSER_OR:
+            for(unsigned i = 0; i < p->match.variadic.n; i++) {
+                if((err = parser_freeze(p->match.variadic.inner[i])))
+                    return err;
+            }
+            return 0;
+        case PARSER_BIND:
+            if((err = parser_freeze(p->match.bind.binding->p)))
+                return err;
+            return parser_freeze(p->match.bind.inner);
+        case PARSER_SEQ:
+        case PARSER_EITHER:
+        case PARSER_MANY_UNTIL:
+        case PARSER_CHAIN:
+        case PARSER_POSTFIX:
+            if((err = parser_freeze(p->match.binary.lhs)))
+                return err;
+            return parser_freeze(p->match.binary.rhs);
+        case PARSER_LOOKUP:
+            // rules reached through linked lookups are called from every thread as well
+            return parser_freeze(p->match.lookup.target);
+        default:
+            return 0;
+    }
+}
+
+struct cc_parser *cc_freeze(struct cc_parser *p) {
+    if(!p)
+        return NULL;
+
+    int err;
+    if((err = parser_freeze(p))) {
+        cc_release(p);
+        errno = err;
+        return NULL;
+    }
+
+    return p;
+}
+
 void cc_parser_copy(struct cc_parser *d, const struct cc_parser* s) {
     int d_rc = d->rc;
     memcpy(d, s, sizeof(struct cc_parser));
@@ -49,6 +129,9 @@ void parser_free(struct cc_parser* p) {
         case PARSER_APPLY:
             cc_release(p->match.apply.inner);
             break;
+        case PARSER_REDUCE:
+            cc_release(p->match.reduce.inner);
+            break;
         case PARSER_NOT:
         case PARSER_MANY:
         case PARSER_COUNT:
@@ -56,6 +139,8 @@ void parser_free(struct cc_parser* p) {
         case PARSER_LEAST:
         case PARSER_NOERROR:
         case PARSER_NORETURN:
+        case PARSER_MEMO:
+        case PARSER_CAPTURE:
             cc_release(p->match.unary.inner);
             break;
         case PARSER_AND:
@@ -67,6 +152,14 @@ void parser_free(struct cc_parser* p) {
             cc_release(p->match.bind.binding->p);
             cc_release(p->match.bind.inner);
             break;
+        case PARSER_ANYOF:
+        case PARSER_NONEOF:
+        case PARSER_ONEOF:
+            free(p->match.list.class);
+            break;
+        case PARSER_REGEX:
+            regex_free(p->match.regex);
+            break;
         case PARSER_SEQ:
         case PARSER_EITHER:
         case PARSER_MANY_UNTIL:
@@ -106,7 +199,7 @@ free_data:
             free(p->match.variadic.inner);
             break;
         case PARSER_LOOKUP:
-            free((char*) p->match.lookup);
+            free((char*) p->match.lookup.name);
             break;
         case PARSER_BIND:
             free((char*) p->match.bind.binding->name);
@@ -135,6 +228,7 @@ struct cc_parser *cc_string(const char8_t *s) {
 
     p->type = PARSER_STRING;
     p->match.str = s;
+    p->match.len = strlen((const char*) s);
 
     return cc_expectf(p, "string \"%s\"", s);
 }
@@ -168,7 +262,51 @@ struct cc_parser *cc_range(char32_t lo, char32_t hi) {
     return cc_expectf(p, "character in range %s - %s", lo_buf, hi_buf);
 }
 
-static struct cc_parser *char_arr_parser(const char32_t *chars, const char *what) {
+static int compare_char(const void *a, const void *b) {
+    char32_t x = *(const char32_t*) a, y = *(const char32_t*) b;
+    return (x > y) - (x < y);
+}
+
+// compiles `chars` into a bitmap for ascii and a sorted range table for all other code points.
+// if `unique` is set, characters occurring more than once are left out.
+struct char_class *char_class_compile(const char32_t *chars, size_t n, bool unique) {
+    char32_t *sorted = malloc((n + 1) * sizeof(char32_t));
+    if(!sorted)
+        return NULL;
+
+    memcpy(sorted, chars, n * sizeof(char32_t));
+    qsort(sorted, n, sizeof(char32_t), compare_char);
+
+    // upper bound of the number of ranges, shrunk at the end
+    struct char_class *c = calloc(1, sizeof(struct char_class) + n * sizeof(c->ranges[0]));
+    if(!c) {
+        free(sorted);
+        return NULL;
+    }
+
+    for(size_t i = 0, j; i < n; i = j) {
+        for(j = i + 1; j < n && sorted[j] == sorted[i]; j++);
+        if(unique && j - i > 1)
+            continue;
+
+        char32_t cp = sorted[i];
+        if(cp < 0x80)
+            c->ascii[cp / 32] |= 1u << (cp % 32);
+        else if(c->n > 0 && c->ranges[c->n - 1].hi + 1 == cp)
+            c->ranges[c->n - 1].hi = cp;
+        else {
+            c->ranges[c->n].lo = c->ranges[c->n].hi = cp;
+            c->n++;
+        }
+    }
+
+    free(sorted);
+
+    struct char_class *shrunk = realloc(c, sizeof(struct char_class) + c->n * sizeof(c->ranges[0]));
+    return shrunk ? shrunk : c;
+}
+
+static struct cc_parser *char_arr_parser(const char32_t *chars, const char *what, enum parser_type type) {
     if(!chars || !what) {
         errno = EINVAL;
         return NULL;
@@ -178,6 +316,8 @@ static struct cc_parser *char_arr_parser(const char32_t *chars, const char *what
     if(!p)
         return NULL;
 
+    // set right away, so `parser_free` frees the class
+    p->type = type;
     p->match.list.chars = chars;
 
     while(chars[p->match.list.n])
@@ -186,14 +326,25 @@ static struct cc_parser *char_arr_parser(const char32_t *chars, const char *what
     struct string_buffer sb = STRING_BUFFER_INIT;
     int err;
 
+    if(!(p->match.list.class = char_class_compile(chars, p->match.list.n, type == PARSER_ONEOF))) {
+        err = errno;
+        goto cleanup;
+    }
+
     if((err = string_buffer_append(&sb, "%s of ", what)))
         goto cleanup;
     
-    if(p->match.list.n == 0 && (err = string_buffer_append(&sb, "nothing")))
-        goto cleanup;
+    if(p->match.list.n == 0) {
+        if((err = string_buffer_append(&sb, "nothing")))
+            goto cleanup;
+    }
 
-    else if(p->match.list.n == 1 && (err = string_buffer_append(&sb, "'%s'", chars[0])))
-        goto cleanup;
+    else if(p->match.list.n == 1) {
+        char8_t buf[CC_UTF8_ENCODE_PRINTABLE_MAX];
+        utf8_encode_printable(chars[0], buf);
+        if((err = string_buffer_append(&sb, "%s", buf)))
+            goto cleanup;
+    }
 
     else {
         for(size_t i = 0; i < p->match.list.n - 2; i++) {
@@ -211,52 +362,33 @@ static struct cc_parser *char_arr_parser(const char32_t *chars, const char *what
             goto cleanup;
     }
 
+    // `cc_expect` releases `p` if it fails
     struct cc_parser *ex = cc_expect(p, string_buffer_unwrap(&sb));
     if(!ex) {
-        err = errno;
-        goto cleanup;
+        free(sb.buf);
+        return NULL;
     }
 
     ex->flags |= PARSER_FLAG_FREE_DATA;
-    ex->match.expect.inner = p;
     
     return ex;
 cleanup:
     parser_free(p);
-    // TODO: free p
     free(sb.buf);
     errno = err;
     return NULL;
 }
 
 struct cc_parser *cc_anyof(const char32_t chars[]) {
-    struct cc_parser *p = char_arr_parser(chars, "any");
-    if(!p)
-        return NULL;
-
-    p->match.expect.inner->type = PARSER_ANYOF;
-
-    return p;
+    return char_arr_parser(chars, "any", PARSER_ANYOF);
 }
 
 struct cc_parser *cc_oneof(const char32_t chars[]) {
-    struct cc_parser *p = char_arr_parser(chars, "one");
-    if(!p)
-        return NULL;
-
-    p->match.expect.inner->type = PARSER_ONEOF;
-
-    return p;
+    return char_arr_parser(chars, "one", PARSER_ONEOF);
 }
 
 struct cc_parser *cc_noneof(const char32_t chars[]) {
-    struct cc_parser *p = char_arr_parser(chars, "none");
-    if(!p)
-        return NULL;
-
-    p->match.expect.inner->type = PARSER_NONEOF;
-
-    return p;
+    return char_arr_parser(chars, "none", PARSER_NONEOF);
 }
 
 __internal struct cc_parser *parser_match(int (*f)(char32_t), const char *what) {
@@ -480,7 +612,7 @@ struct cc_parser *cc_lookup(const char *name) {
         return NULL;
 
     p->type = PARSER_LOOKUP;
-    p->match.lookup = name;
+    p->match.lookup.name = name;
 
     return p;
 }
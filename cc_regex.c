@@ -193,7 +193,7 @@ static struct cc_result re_seq(size_t n, void **r) {
     if(!r) return cc_ok(NULL);
     if(n == 0) return cc_ok(cc_pass());
     if(n == 1) return cc_ok(r[0]);
-    if(n == 2) return cc_ok(cc_either(r[0], r[1]));
+    if(n == 2) return cc_ok(cc_seq(cc_fold_concat, r[0], r[1]));
 
     struct cc_parser **ps = malloc(n * sizeof(struct cc_parser*));
     memcpy(ps, r, n * sizeof(struct cc_parser*));
@@ -424,3 +424,92 @@ struct cc_parser *cc_regex(const char8_t *re, struct cc_error **e) {
     return p;
 }
 
+struct cc_parser *cc_regex_with(const char8_t *re, int flags, struct cc_error **e) {
+    struct cc_parser *p = cc_regex(re, e);
+    if(!p || *e || !(flags & CC_REGEX_DFA))
+        return p;
+
+    // the automaton does not refer to the parser it was compiled from
+    struct regex *dfa = regex_compile(p);
+    int err = errno;
+    cc_release(p);
+    if(!dfa) {
+        errno = err;
+        return NULL;
+    }
+
+    if(!(p = parser_allocate())) {
+        regex_free(dfa);
+        return NULL;
+    }
+
+    p->type = PARSER_REGEX;
+    p->match.regex = dfa;
+
+    return cc_expectf(p, "regular expression \"%s\"", re);
+}
+
+static struct regex *regex_of(const struct cc_parser *p) {
+    while(p->type == PARSER_EXPECT)
+        p = p->match.expect.inner;
+
+    return p->type == PARSER_REGEX ? p->match.regex : NULL;
+}
+
+static int regex_next(const struct cc_source *s, struct regex *re, size_t *off, struct cc_span *m) {
+    if(*off > s->buffer_size)
+        return CC_NOMATCH;
+
+    size_t start, len;
+    int res = regex_search(re, s->buffer, s->buffer_size, *off, &start, &len);
+    if(res != PARSE_SUCCESS)
+        return res;
+
+    m->ptr = s->buffer + start;
+    m->len = len;
+
+    // empty matches advance by one character
+    *off = start + len;
+    if(len == 0) {
+        do
+            (*off)++;
+        while(*off < s->buffer_size && CC_UTF8_IS_CONT(s->buffer[*off]));
+    }
+
+    return CC_MATCH;
+}
+
+int cc_regex_search(const struct cc_source *s, struct cc_parser *re, size_t *off, struct cc_span *m) {
+    if(!s || !re || !off || !m) {
+        cc_release(re);
+        return -EINVAL;
+    }
+
+    struct regex *dfa = regex_of(re);
+    int res = !dfa ? -EINVAL : s->stream.read ? -ENOTSUP : regex_next(s, dfa, off, m);
+
+    cc_release(re);
+    return res;
+}
+
+int cc_regex_findall(const struct cc_source *s, struct cc_parser *re, int (*f)(const struct cc_span *m, void *userp), void *userp) {
+    if(!s || !re || !f) {
+        cc_release(re);
+        return EINVAL;
+    }
+
+    struct regex *dfa = regex_of(re);
+    if(!dfa || s->stream.read) {
+        cc_release(re);
+        return dfa ? ENOTSUP : EINVAL;
+    }
+
+    struct cc_span m;
+    size_t off = 0;
+    int res, stop = 0;
+
+    while((res = regex_next(s, dfa, &off, &m)) == CC_MATCH && !(stop = f(&m, userp)));
+
+    cc_release(re);
+    return stop ? stop : -res;
+}
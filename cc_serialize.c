@@ -0,0 +1,845 @@
+#include <ccombinator.h>
+
+#include "internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Grammar images:
+//
+// a saved grammar is a header followed by the sections
+//
+//     nodes[n_nodes] rules[n_rules] refs[n_refs] words[n_words] strings[n_strings]
+//
+// parsers refer to other parsers, word lists and strings only by index, so the image is position-independent.
+// functions are stored by action name and bound to the actions passed to `cc_grammar_load` again.
+
+// images are written in the byte order of the machine saving them. the magic doubles as byte order mark,
+// machines with the other byte order do not recognize it.
+#define IMAGE_MAGIC 0x72676363u // "ccgr"
+#define IMAGE_VERSION 1
+
+struct image_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_nodes;
+    uint32_t n_rules;
+    uint32_t n_refs;
+    uint32_t n_words;
+    uint32_t n_strings;
+};
+
+// the operands `a`, `b` and `c` depend on the parser type, see `save_node`
+struct image_node {
+    uint32_t type; // see `image_types`
+    uint32_t fold; // ref + 1, 0 if the parser has no fold function
+    uint32_t a, b, c;
+};
+
+// codes of the parser types in an image, independent of the order of `enum parser_type`.
+// codes are never reused, types that cannot be stored have none.
+static const uint32_t image_types[PARSER_TYPE_MAX] = {
+    [PARSER_EOF]        = 1,
+    [PARSER_SOF]        = 2,
+    [PARSER_ANY]        = 3,
+    [PARSER_STRING]     = 4,
+    [PARSER_CHAR]       = 5,
+    [PARSER_CHAR_RANGE] = 6,
+    [PARSER_MATCH]      = 7,
+    [PARSER_PASS]       = 8,
+    [PARSER_FAIL]       = 9,
+    [PARSER_LIFT]       = 10,
+    [PARSER_LIFT_VAL]   = 11,
+    [PARSER_ANYOF]      = 12,
+    [PARSER_NONEOF]     = 13,
+    [PARSER_ONEOF]      = 14,
+    [PARSER_EXPECT]     = 15,
+    [PARSER_APPLY]      = 16,
+    [PARSER_NOT]        = 17,
+    [PARSER_SEQ]        = 18,
+    [PARSER_EITHER]     = 19,
+    [PARSER_AND]        = 20,
+    [PARSER_OR]         = 21,
+    [PARSER_MANY]       = 22,
+    [PARSER_MANY_UNTIL] = 23,
+    [PARSER_COUNT]      = 24,
+    [PARSER_LEAST]      = 25,
+    [PARSER_MAYBE]      = 26,
+    [PARSER_CHAIN]      = 27,
+    [PARSER_POSTFIX]    = 28,
+    [PARSER_LOCATION]   = 29,
+    [PARSER_NORETURN]   = 30,
+    [PARSER_NOERROR]    = 31,
+    [PARSER_MEMO]       = 32,
+    [PARSER_CAPTURE]    = 33,
+    [PARSER_LOOKUP]     = 34,
+    [PARSER_BIND]       = 35,
+};
+
+struct image_rule {
+    uint32_t name; // string offset
+    uint32_t node;
+};
+
+struct image_ref {
+    uint32_t name; // string offset
+    uint32_t type; // `enum cc_action_type`
+};
+
+// library functions parsers can refer to without them being passed as actions
+const struct cc_action builtin_actions[] = {
+    {CC_ACTION_FOLD, "cc_fold_concat", {.fold = cc_fold_concat}},
+    {CC_ACTION_FOLD, "cc_fold_first", {.fold = cc_fold_first}},
+    {CC_ACTION_FOLD, "cc_fold_middle", {.fold = cc_fold_middle}},
+    {CC_ACTION_FOLD, "cc_fold_last", {.fold = cc_fold_last}},
+    {CC_ACTION_FOLD, "cc_fold_null", {.fold = cc_fold_null}},
+    {CC_ACTION_MATCH, "cc_is_whitespace", {.match = cc_is_whitespace}},
+    {CC_ACTION_MATCH, "cc_is_blank", {.match = cc_is_blank}},
+    {CC_ACTION_MATCH, "cc_is_print", {.match = cc_is_print}},
+    {CC_ACTION_MATCH, "cc_is_cntrl", {.match = cc_is_cntrl}},
+    {CC_ACTION_MATCH, "cc_is_graph", {.match = cc_is_graph}},
+    {CC_ACTION_MATCH, "cc_is_punct", {.match = cc_is_punct}},
+    {CC_ACTION_MATCH, "cc_is_digit", {.match = cc_is_digit}},
+    {CC_ACTION_MATCH, "cc_is_hexdigit", {.match = cc_is_hexdigit}},
+    {CC_ACTION_MATCH, "cc_is_octdigit", {.match = cc_is_octdigit}},
+    {CC_ACTION_MATCH, "cc_is_alpha", {.match = cc_is_alpha}},
+    {CC_ACTION_MATCH, "cc_is_lower", {.match = cc_is_lower}},
+    {CC_ACTION_MATCH, "cc_is_upper", {.match = cc_is_upper}},
+    {CC_ACTION_MATCH, "cc_is_alphanum", {.match = cc_is_alphanum}},
+    {CC_ACTION_NULL, NULL, {NULL}},
+};
+
+static bool action_equal(const struct cc_action *a, const struct cc_action *b) {
+    if(a->type != b->type)
+        return false;
+
+    switch(a->type) {
+    case CC_ACTION_VALUE:
+        return a->value == b->value;
+    case CC_ACTION_FOLD:
+        return a->fold == b->fold;
+    case CC_ACTION_APPLY:
+        return a->apply == b->apply;
+    case CC_ACTION_LIFT:
+        return a->lift == b->lift;
+    case CC_ACTION_MATCH:
+        return a->match == b->match;
+    default:
+        return false;
+    }
+}
+
+// finds the action referring to the same function as `fn`
+const struct cc_action *find_action(const struct cc_action actions[], const struct cc_action *fn) {
+    for(size_t i = 0; actions && actions[i].type != CC_ACTION_NULL; i++) {
+        if(action_equal(&actions[i], fn))
+            return &actions[i];
+    }
+
+    return NULL;
+}
+
+static const struct cc_action *find_action_by_name(const struct cc_action actions[], const char *name, enum cc_action_type type) {
+    for(size_t i = 0; actions && actions[i].type != CC_ACTION_NULL; i++) {
+        if(actions[i].type == type && strcmp(actions[i].name, name) == 0)
+            return &actions[i];
+    }
+
+    return NULL;
+}
+
+// Saving:
+
+struct section {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+struct image_writer {
+    const struct cc_grammar *g;
+    uint32_t n_nodes;
+
+    // index of every parser already saved, open addressing by address
+    size_t capacity;
+    size_t count;
+    const struct cc_parser **keys;
+    uint32_t *indices;
+
+    struct section nodes, rules, refs, words, strings;
+};
+
+static int section_append(struct section *s, const void *data, size_t size, uint32_t *offset) {
+    if(s->size + size > UINT32_MAX)
+        return E2BIG;
+
+    if(s->size + size > s->capacity) {
+        size_t capacity = MAX(s->capacity * 2, MAX(s->size + size, 256));
+        uint8_t *grown = realloc(s->data, capacity);
+        if(!grown)
+            return errno;
+
+        s->data = grown;
+        s->capacity = capacity;
+    }
+
+    if(offset)
+        *offset = s->size;
+    memcpy(s->data + s->size, data, size);
+    s->size += size;
+    return 0;
+}
+
+static inline size_t node_hash(const struct cc_parser *p, size_t capacity) {
+    return ((uintptr_t) p >> 4) * 0x9e3779b97f4a7c15ull % capacity;
+}
+
+static bool node_index(const struct image_writer *w, const struct cc_parser *p, uint32_t *index) {
+    if(w->capacity == 0)
+        return false;
+
+    for(size_t i = node_hash(p, w->capacity); w->keys[i]; i = (i + 1) % w->capacity) {
+        if(w->keys[i] == p) {
+            *index = w->indices[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int node_insert(struct image_writer *w, const struct cc_parser *p, uint32_t index) {
+    if(2 * (w->count + 1) > w->capacity) {
+        size_t capacity = MAX(2 * w->capacity, 64);
+        const struct cc_parser **keys = calloc(capacity, sizeof(*keys));
+        uint32_t *indices = calloc(capacity, sizeof(*indices));
+        if(!keys || !indices) {
+            free(keys);
+            free(indices);
+            return ENOMEM;
+        }
+
+        for(size_t i = 0; i < w->capacity; i++) {
+            if(!w->keys[i])
+                continue;
+
+            size_t j = node_hash(w->keys[i], capacity);
+            while(keys[j])
+                j = (j + 1) % capacity;
+            keys[j] = w->keys[i];
+            indices[j] = w->indices[i];
+        }
+
+        free(w->keys);
+        free(w->indices);
+        w->keys = keys;
+        w->indices = indices;
+        w->capacity = capacity;
+    }
+
+    size_t i = node_hash(p, w->capacity);
+    while(w->keys[i])
+        i = (i + 1) % w->capacity;
+
+    w->keys[i] = p;
+    w->indices[i] = index;
+    w->count++;
+    return 0;
+}
+
+static int save_string(struct image_writer *w, const char *s, size_t len, uint32_t *offset) {
+    int err;
+    if((err = section_append(&w->strings, s, len, offset)))
+        return err;
+    return section_append(&w->strings, "", 1, NULL);
+}
+
+// stores the name of the action referring to the function in `fn`
+static int save_ref(struct image_writer *w, const struct cc_action *fn, uint32_t *ref) {
+    const struct cc_action *action = find_action(w->g->actions, fn);
+    if(!action && !(action = find_action(builtin_actions, fn)))
+        return ENOTSUP;
+
+    const struct image_ref *refs = (const struct image_ref*) w->refs.data;
+    uint32_t n = w->refs.size / sizeof(struct image_ref);
+    for(*ref = 0; *ref < n; (*ref)++) {
+        if(refs[*ref].type == action->type && strcmp((const char*) w->strings.data + refs[*ref].name, action->name) == 0)
+            return 0;
+    }
+
+    struct image_ref entry = {.type = action->type};
+    int err;
+    if((err = save_string(w, action->name, strlen(action->name), &entry.name)))
+        return err;
+    return section_append(&w->refs, &entry, sizeof(struct image_ref), NULL);
+}
+
+static int save_node(struct image_writer *w, const struct cc_parser *p, uint32_t *index);
+
+// stores the indices of the parsers in `inner` in the word section, starting at the word `offset`
+static int save_list(struct image_writer *w, struct cc_parser *const *inner, unsigned n, uint32_t *offset) {
+    uint32_t *indices = calloc(n, sizeof(uint32_t));
+    if(n > 0 && !indices)
+        return errno;
+
+    // children append to the word section themselves, the list is appended afterwards
+    int err = 0;
+    for(unsigned i = 0; i < n && !err; i++)
+        err = save_node(w, inner[i], &indices[i]);
+
+    if(!err && !(err = section_append(&w->words, indices, n * sizeof(uint32_t), offset)))
+        *offset /= sizeof(uint32_t);
+
+    free(indices);
+    return err;
+}
+
+static int save_node(struct image_writer *w, const struct cc_parser *p, uint32_t *index) {
+    if(!p)
+        return EINVAL;
+
+    if(node_index(w, p, index))
+        return 0;
+
+    // the slot is reserved before the inner parsers are saved, since `cc_fix` creates cycles
+    struct image_node node = {.type = image_types[p->type]};
+    uint32_t at = *index = w->n_nodes++;
+
+    int err;
+    if((err = node_insert(w, p, at)) || (err = section_append(&w->nodes, &node, sizeof(struct image_node), NULL)))
+        return err;
+
+    if(p->fold) {
+        if((err = save_ref(w, &(struct cc_action){CC_ACTION_FOLD, NULL, {.fold = p->fold}}, &node.fold)))
+            return err;
+        node.fold++;
+    }
+
+    switch(p->type) {
+    case PARSER_EOF:
+    case PARSER_SOF:
+    case PARSER_ANY:
+    case PARSER_PASS:
+    case PARSER_LOCATION:
+        break;
+    case PARSER_CHAR:
+        node.a = p->match.ch;
+        break;
+    case PARSER_CHAR_RANGE:
+        node.a = p->match.lo;
+        node.b = p->match.hi;
+        break;
+    case PARSER_STRING:
+        node.b = p->match.len;
+        err = save_string(w, (const char*) p->match.str, p->match.len, &node.a);
+        break;
+    case PARSER_FAIL:
+        err = save_string(w, p->match.msg, strlen(p->match.msg), &node.a);
+        break;
+    case PARSER_LOOKUP:
+        err = save_string(w, p->match.lookup.name, strlen(p->match.lookup.name), &node.a);
+        break;
+    case PARSER_MATCH:
+        err = save_ref(w, &(struct cc_action){CC_ACTION_MATCH, NULL, {.match = p->match.matchfn}}, &node.a);
+        break;
+    case PARSER_LIFT:
+        err = save_ref(w, &(struct cc_action){CC_ACTION_LIFT, NULL, {.lift = p->match.lift.lf}}, &node.a);
+        break;
+    case PARSER_LIFT_VAL:
+        // ref + 1 like `fold`, NULL values need no action
+        if(p->match.lift.val && !(err = save_ref(w, &(struct cc_action){CC_ACTION_VALUE, NULL, {.value = p->match.lift.val}}, &node.a)))
+            node.a++;
+        break;
+    case PARSER_ANYOF:
+    case PARSER_NONEOF:
+    case PARSER_ONEOF:
+        node.b = p->match.list.n;
+        static_assert(sizeof(char32_t) == sizeof(uint32_t));
+        err = section_append(&w->words, p->match.list.chars, p->match.list.n * sizeof(char32_t), &node.a);
+        node.a /= sizeof(uint32_t);
+        break;
+    case PARSER_EXPECT:
+        if(!(err = save_string(w, p->match.expect.what, strlen(p->match.expect.what), &node.a)))
+            err = save_node(w, p->match.expect.inner, &node.b);
+        break;
+    case PARSER_APPLY:
+        if(!(err = save_ref(w, &(struct cc_action){CC_ACTION_APPLY, NULL, {.apply = p->match.apply.af}}, &node.a)))
+            err = save_node(w, p->match.apply.inner, &node.b);
+        break;
+    case PARSER_NOT:
+    case PARSER_MANY:
+    case PARSER_COUNT:
+    case PARSER_MAYBE:
+    case PARSER_LEAST:
+    case PARSER_NOERROR:
+    case PARSER_NORETURN:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        node.a = p->match.unary.n;
+        err = save_node(w, p->match.unary.inner, &node.b);
+        break;
+    case PARSER_SEQ:
+    case PARSER_EITHER:
+    case PARSER_MANY_UNTIL:
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        if(!(err = save_node(w, p->match.binary.lhs, &node.a)))
+            err = save_node(w, p->match.binary.rhs, &node.b);
+        break;
+    case PARSER_AND:
+    case PARSER_OR:
+        node.b = p->match.variadic.n;
+        err = save_list(w, p->match.variadic.inner, p->match.variadic.n, &node.a);
+        break;
+    case PARSER_BIND:
+        err = save_string(w, p->match.bind.binding->name, strlen(p->match.bind.binding->name), &node.a);
+        if(!err)
+            err = save_node(w, p->match.bind.binding->p, &node.b);
+        if(!err)
+            err = save_node(w, p->match.bind.inner, &node.c);
+        break;
+    default:
+        // compiled automatons and step functions cannot be stored
+        return ENOTSUP;
+    }
+
+    if(err)
+        return err;
+
+    memcpy(w->nodes.data + at * sizeof(struct image_node), &node, sizeof(struct image_node));
+    return 0;
+}
+
+static int save_rule(const char *k, void *v, void *userp) {
+    struct image_writer *w = userp;
+    struct image_rule rule;
+
+    int err;
+    if((err = save_string(w, k, strlen(k), &rule.name)) || (err = save_node(w, v, &rule.node)))
+        return err;
+    return section_append(&w->rules, &rule, sizeof(struct image_rule), NULL);
+}
+
+static int write_all(int fd, const void *data, size_t size) {
+    for(size_t done = 0; done < size;) {
+        ssize_t n = write(fd, (const uint8_t*) data + done, size - done);
+        if(n < 0 && errno != EINTR)
+            return errno;
+        if(n > 0)
+            done += n;
+    }
+
+    return 0;
+}
+
+int cc_grammar_save(const struct cc_grammar *g, const char *path) {
+    if(!g || !path)
+        return EINVAL;
+
+    struct image_writer w = {.g = g};
+    struct section *sections[] = {&w.nodes, &w.rules, &w.refs, &w.words, &w.strings};
+    int fd = -1, err;
+
+    if((err = hashtable_iter(&g->rules, save_rule, &w)))
+        goto cleanup;
+
+    struct image_header header = {
+        .magic = IMAGE_MAGIC,
+        .version = IMAGE_VERSION,
+        .n_nodes = w.n_nodes,
+        .n_rules = w.rules.size / sizeof(struct image_rule),
+        .n_refs = w.refs.size / sizeof(struct image_ref),
+        .n_words = w.words.size / sizeof(uint32_t),
+        .n_strings = w.strings.size,
+    };
+
+    if((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        err = errno;
+        goto cleanup;
+    }
+
+    if((err = write_all(fd, &header, sizeof(struct image_header))))
+        goto cleanup;
+
+    for(size_t i = 0; i < LEN(sections); i++) {
+        if((err = write_all(fd, sections[i]->data, sections[i]->size)))
+            goto cleanup;
+    }
+
+cleanup:
+    if(fd >= 0 && close(fd) && !err)
+        err = errno;
+
+    for(size_t i = 0; i < LEN(sections); i++)
+        free(sections[i]->data);
+    free(w.keys);
+    free(w.indices);
+    return err;
+}
+
+// Loading:
+
+struct image_reader {
+    struct image_header header;
+
+    const struct image_node *nodes;
+    const struct image_rule *rules;
+    const struct image_ref *refs;
+    const uint32_t *words;
+    const char *strings;
+
+    const struct cc_action **functions; // resolved refs
+    struct cc_parser **parsers;
+};
+
+static int image_map(struct image_reader *r, const uint8_t *base, size_t size) {
+    if(size < sizeof(struct image_header))
+        return EINVAL;
+
+    memcpy(&r->header, base, sizeof(struct image_header));
+    if(r->header.magic != IMAGE_MAGIC || r->header.version != IMAGE_VERSION)
+        return EINVAL;
+
+    // the sections are all multiples of 4 bytes in size except the strings at the end, so they are aligned
+    uint64_t offset = sizeof(struct image_header);
+    r->nodes = (const struct image_node*) (base + offset);
+    offset += (uint64_t) r->header.n_nodes * sizeof(struct image_node);
+    r->rules = (const struct image_rule*) (base + offset);
+    offset += (uint64_t) r->header.n_rules * sizeof(struct image_rule);
+    r->refs = (const struct image_ref*) (base + offset);
+    offset += (uint64_t) r->header.n_refs * sizeof(struct image_ref);
+    r->words = (const uint32_t*) (base + offset);
+    offset += (uint64_t) r->header.n_words * sizeof(uint32_t);
+    r->strings = (const char*) (base + offset);
+    offset += r->header.n_strings;
+
+    // every string offset ends at a NUL byte at the latest
+    if(offset != size || (r->header.n_strings > 0 && r->strings[r->header.n_strings - 1] != '\0'))
+        return EINVAL;
+
+    return 0;
+}
+
+static const char *image_string(const struct image_reader *r, uint32_t offset) {
+    return offset < r->header.n_strings ? r->strings + offset : NULL;
+}
+
+static char *image_strdup(const struct image_reader *r, uint32_t offset, size_t *len) {
+    const char *s = image_string(r, offset);
+    if(!s) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if(len)
+        *len = strlen(s);
+    return strdup(s);
+}
+
+static const uint32_t *image_words(const struct image_reader *r, uint32_t offset, uint32_t n) {
+    return offset <= r->header.n_words && n <= r->header.n_words - offset ? r->words + offset : NULL;
+}
+
+static struct cc_parser *image_parser(const struct image_reader *r, uint32_t index) {
+    if(index >= r->header.n_nodes)
+        return NULL;
+
+    struct cc_parser *p = r->parsers[index];
+    p->rc++;
+    return p;
+}
+
+static const struct cc_action *image_function(const struct image_reader *r, uint32_t ref, enum cc_action_type type) {
+    return ref < r->header.n_refs && r->functions[ref]->type == type ? r->functions[ref] : NULL;
+}
+
+// returns the parser type with the image code `code`, PARSER_UNDEFINED if there is none
+static enum parser_type image_parser_type(uint32_t code) {
+    for(unsigned type = 0; code && type < PARSER_TYPE_MAX; type++) {
+        if(image_types[type] == code)
+            return type;
+    }
+
+    return PARSER_UNDEFINED;
+}
+
+// fills in the preallocated parser `index`, everything allocated is freed with the parser on failure
+static int load_node(struct image_reader *r, uint32_t index) {
+    const struct image_node *node = &r->nodes[index];
+    struct cc_parser *p = r->parsers[index];
+    const struct cc_action *fn;
+
+    enum parser_type type = image_parser_type(node->type);
+    if(type == PARSER_UNDEFINED)
+        return EINVAL;
+
+    if(type == PARSER_BIND && !(p->match.bind.binding = calloc(1, sizeof(struct cc_binding))))
+        return errno;
+
+    p->type = type;
+
+    if(node->fold) {
+        if(!(fn = image_function(r, node->fold - 1, CC_ACTION_FOLD)))
+            return EINVAL;
+        p->fold = fn->fold;
+    }
+
+    switch(type) {
+    case PARSER_EOF:
+    case PARSER_SOF:
+    case PARSER_ANY:
+    case PARSER_PASS:
+    case PARSER_LOCATION:
+        break;
+    case PARSER_CHAR:
+        p->match.ch = node->a;
+        break;
+    case PARSER_CHAR_RANGE:
+        p->match.lo = node->a;
+        p->match.hi = node->b;
+        break;
+    case PARSER_STRING:
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        if(!(p->match.str = (char8_t*) image_strdup(r, node->a, &p->match.len)))
+            return errno;
+        break;
+    case PARSER_FAIL:
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        if(!(p->match.msg = image_strdup(r, node->a, NULL)))
+            return errno;
+        break;
+    case PARSER_LOOKUP:
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        if(!(p->match.lookup.name = image_strdup(r, node->a, NULL)))
+            return errno;
+        break;
+    case PARSER_MATCH:
+        if(!(fn = image_function(r, node->a, CC_ACTION_MATCH)))
+            return EINVAL;
+        p->match.matchfn = fn->match;
+        break;
+    case PARSER_LIFT:
+        if(!(fn = image_function(r, node->a, CC_ACTION_LIFT)))
+            return EINVAL;
+        p->match.lift.lf = fn->lift;
+        break;
+    case PARSER_LIFT_VAL:
+        if(!node->a)
+            break;
+        if(!(fn = image_function(r, node->a - 1, CC_ACTION_VALUE)))
+            return EINVAL;
+        p->match.lift.val = fn->value;
+        break;
+    case PARSER_ANYOF:
+    case PARSER_NONEOF:
+    case PARSER_ONEOF: {
+        const uint32_t *words = image_words(r, node->a, node->b);
+        if(!words)
+            return EINVAL;
+
+        char32_t *chars = calloc(node->b + 1, sizeof(char32_t));
+        if(!chars)
+            return errno;
+        memcpy(chars, words, node->b * sizeof(char32_t));
+
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        p->match.list.chars = chars;
+        p->match.list.n = node->b;
+        if(!(p->match.list.class = char_class_compile(chars, node->b, type == PARSER_ONEOF)))
+            return errno;
+    } break;
+    case PARSER_EXPECT:
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        if(!(p->match.expect.what = image_strdup(r, node->a, NULL)))
+            return errno;
+        if(!(p->match.expect.inner = image_parser(r, node->b)))
+            return EINVAL;
+        break;
+    case PARSER_APPLY:
+        if(!(fn = image_function(r, node->a, CC_ACTION_APPLY)))
+            return EINVAL;
+        p->match.apply.af = fn->apply;
+        if(!(p->match.apply.inner = image_parser(r, node->b)))
+            return EINVAL;
+        break;
+    case PARSER_NOT:
+    case PARSER_MANY:
+    case PARSER_COUNT:
+    case PARSER_MAYBE:
+    case PARSER_LEAST:
+    case PARSER_NOERROR:
+    case PARSER_NORETURN:
+    case PARSER_MEMO:
+    case PARSER_CAPTURE:
+        p->match.unary.n = node->a;
+        if(!(p->match.unary.inner = image_parser(r, node->b)))
+            return EINVAL;
+        break;
+    case PARSER_SEQ:
+    case PARSER_EITHER:
+    case PARSER_MANY_UNTIL:
+    case PARSER_CHAIN:
+    case PARSER_POSTFIX:
+        if(!(p->match.binary.lhs = image_parser(r, node->a)))
+            return EINVAL;
+        if(!(p->match.binary.rhs = image_parser(r, node->b)))
+            return EINVAL;
+        break;
+    case PARSER_AND:
+    case PARSER_OR: {
+        const uint32_t *words = image_words(r, node->a, node->b);
+        if(!words)
+            return EINVAL;
+
+        // `cc_and` and `cc_or` accept zero parsers as well
+        struct cc_parser **inner = calloc(node->b, sizeof(struct cc_parser*));
+        if(node->b > 0 && !inner)
+            return errno;
+
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        p->match.variadic.inner = inner;
+        for(uint32_t i = 0; i < node->b; i++) {
+            if(!(inner[i] = image_parser(r, words[i])))
+                return EINVAL;
+            p->match.variadic.n++;
+        }
+    } break;
+    case PARSER_BIND:
+        p->flags |= PARSER_FLAG_FREE_DATA;
+        if(!(p->match.bind.binding->name = image_strdup(r, node->a, NULL)))
+            return errno;
+        if(!(p->match.bind.binding->p = image_parser(r, node->b)) || !(p->match.bind.inner = image_parser(r, node->c)))
+            return EINVAL;
+        break;
+    default:
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int load_grammar(struct image_reader *r, const struct cc_action actions[], struct cc_grammar **g) {
+    for(uint32_t i = 0; i < r->header.n_refs; i++) {
+        const char *name = image_string(r, r->refs[i].name);
+        if(!name)
+            return EINVAL;
+
+        if(!(r->functions[i] = find_action_by_name(actions, name, r->refs[i].type))
+            && !(r->functions[i] = find_action_by_name(builtin_actions, name, r->refs[i].type)))
+            return ENOENT;
+    }
+
+    for(uint32_t i = 0; i < r->header.n_nodes; i++) {
+        if(!(r->parsers[i] = parser_allocate()))
+            return errno;
+        r->parsers[i]->rc = 0; // counted while the references get resolved
+    }
+
+    int err;
+    for(uint32_t i = 0; i < r->header.n_nodes; i++) {
+        if((err = load_node(r, i)))
+            return err;
+    }
+
+    if(!(*g = grammar_init(MAX(2 * r->header.n_rules, 32))))
+        return errno;
+
+    for(uint32_t i = 0; i < r->header.n_rules; i++) {
+        char *name = image_strdup(r, r->rules[i].name, NULL);
+        struct cc_parser *p = image_parser(r, r->rules[i].node);
+        if(!name || !p) {
+            free(name);
+            return name ? EINVAL : errno;
+        }
+
+        if((err = hashtable_set(&(*g)->rules, name, p))) {
+            free(name);
+            return err;
+        }
+    }
+
+    return grammar_set_actions(*g, actions);
+}
+
+static int free_rule_name(const char *k, void *, void *) {
+    free((void*) k);
+    return 0;
+}
+
+struct cc_grammar *cc_grammar_load(const char *path, const struct cc_action actions[]) {
+    if(!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct image_reader r = {0};
+    struct cc_grammar *g = NULL;
+    void *base = MAP_FAILED;
+    size_t size = 0;
+    int err = 0;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (base = mmap(NULL, size = st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        err = errno;
+        goto cleanup;
+    }
+
+    if((err = image_map(&r, base, size)))
+        goto cleanup;
+
+    r.functions = calloc(r.header.n_refs + 1, sizeof(struct cc_action*));
+    r.parsers = calloc(r.header.n_nodes + 1, sizeof(struct cc_parser*));
+    if(!r.functions || !r.parsers) {
+        err = errno;
+        goto cleanup;
+    }
+
+    if((err = load_grammar(&r, actions, &g)))
+        goto cleanup;
+
+    // parsers no rule refers to would never be freed
+    for(uint32_t i = 0; i < r.header.n_nodes; i++) {
+        if(r.parsers[i]->rc == 0) {
+            err = EINVAL;
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    if(err) {
+        // the parsers are freed individually regardless of their references
+        if(g) {
+            hashtable_iter(&g->rules, free_rule_name, NULL);
+            g->rules.head = NULL;
+            cc_grammar_free(g);
+        }
+
+        for(uint32_t i = 0; r.parsers && i < r.header.n_nodes && r.parsers[i]; i++) {
+            struct cc_parser *p = r.parsers[i];
+            if(p->type == PARSER_ANYOF || p->type == PARSER_NONEOF || p->type == PARSER_ONEOF)
+                free(p->match.list.class);
+            p->flags |= PARSER_FLAG_RETAIN_INNER;
+            parser_free(p);
+        }
+        g = NULL;
+    }
+
+    free(r.functions);
+    free(r.parsers);
+    if(base != MAP_FAILED)
+        munmap(base, size);
+    close(fd);
+
+    errno = err;
+    return g;
+}
@@ -8,8 +8,13 @@ struct cc_result read_int(void *r) {
     if(!r)
         return cc_ok(NULL);
 
-    intptr_t n = atol(r); // safe here, since `r` only consists of digits
-    free(r);
+    struct cc_span *digits = r;
+
+    intptr_t n = 0;
+    for(size_t i = 0; i < digits->len; i++)
+        n = n * 10 + (digits->ptr[i] - '0'); // safe here, since the span only consists of digits
+
+    free(digits);
     return cc_ok((void*) n);
 }
 
@@ -49,7 +54,7 @@ struct cc_result calc_sum(size_t n, void **r) {
 }
 
 struct cc_parser *term_parser(struct cc_parser *self, void*) {
-    struct cc_parser *number = cc_apply(cc_least(1, cc_fold_concat, cc_digit()), read_int);
+    struct cc_parser *number = cc_apply(cc_capture(cc_least(1, cc_fold_concat, cc_digit())), read_int);
     
     struct cc_parser *negate = cc_apply(cc_and(2, cc_fold_last, 
         cc_noreturn(cc_char('-')),
@@ -51,21 +51,26 @@ extern "C" {
 // regular structs used by ccombinator
 
 typedef struct cc_action cc_action_t;
+typedef struct cc_context cc_context_t;
 typedef struct cc_error cc_error_t;
 typedef struct cc_grammar cc_grammar_t;
 typedef struct cc_location cc_location_t;
 typedef struct cc_parser cc_parser_t;
 typedef struct cc_result cc_result_t;
 typedef struct cc_source cc_source_t;
+typedef struct cc_span cc_span_t;
 
 // callback function types
 
 typedef struct cc_result (*cc_lift_t)(void);
 typedef struct cc_result (*cc_fold_t)(size_t, void**);
 typedef struct cc_result (*cc_apply_t)(void*);
+typedef struct cc_result (*cc_step_t)(void *acc, void *x);
 
 typedef int (*cc_match_t)(char32_t);
 
+typedef int (*cc_read_t)(void *userp, char8_t *buf, size_t n, size_t *nread);
+
 typedef struct cc_parser *(*cc_fix_t)(struct cc_parser*, void*);
 
 // error handling
@@ -81,6 +86,14 @@ struct cc_location {
     size_t byte_off;
 };
 
+// represents a slice of the input buffer of a `struct cc_source`, as returned by `cc_capture`.
+// `ptr` points into the source buffer directly and is only valid as long as the source is.
+// for streaming sources, the input is copied and stored right behind the span instead.
+struct cc_span {
+    const char8_t *ptr;
+    size_t len;
+};
+
 // maximum number of `expected` elements saved for the error report
 #define CC_ERR_MAX_EXPECTED 16
 
@@ -162,6 +175,11 @@ struct cc_parser *cc_retain(struct cc_parser *p);
 // if the reference-count reaches `0`, `p` is automatically freed and NULL returned.
 struct cc_parser *cc_release(struct cc_parser *p);
 
+// compiles `p` and all parsers reachable from it ahead of time and marks them as immutable.
+// frozen parsers use atomic reference-counting and can be shared between threads, e.g. for `cc_parse_batch`.
+// returns `p`, or NULL on error. frozen parsers must not be modified anymore.
+struct cc_parser *cc_freeze(struct cc_parser *p);
+
 // copies the contents of parser `s` to `d` while preserving the individual reference-counts.
 void cc_parser_copy(struct cc_parser *d, const struct cc_parser* s);
 
@@ -195,6 +213,8 @@ struct cc_parser *cc_oneof(const char32_t chars[]);
 struct cc_parser *cc_noneof(const char32_t chars[]);
 
 // matches any character, for which the function `f` returns a non-zero value.
+// `f` has to depend on its argument only: it may be called ahead of time, e.g. for every ascii character when a
+// repetition of `cc_match` is compiled.
 struct cc_parser *cc_match(cc_match_t f);
 
 // matches the end of file.
@@ -299,7 +319,7 @@ struct cc_parser *cc_and(unsigned n, cc_fold_t f, ...);
 struct cc_parser *cc_andv(unsigned n, cc_fold_t f, struct cc_parser **ps);
 
 // checks `n` parsers and returns the result of the first succeeding parser.
-// fails if no parser succeeds.
+// fails if no parser succeeds. parsers that cannot start with the next input character are skipped.
 struct cc_parser *cc_or(unsigned n, ...);
 struct cc_parser *cc_orv(unsigned n, struct cc_parser **ps);
 
@@ -307,6 +327,16 @@ struct cc_parser *cc_orv(unsigned n, struct cc_parser **ps);
 // parser results are combined using the folding function `f`.
 struct cc_parser *cc_many(cc_fold_t f, struct cc_parser *p);
 
+// runs parser `p` zero or more times in sequence until `p` fails, like `cc_many`.
+// the accumulator returned by `init` is combined with the result of every `p` as soon as it is parsed,
+// using `step`, which returns the new accumulator. the final accumulator is the result.
+// the results of `p` are not kept, so the memory used does not grow with the number of repetitions.
+// `init` and `step` run while parsing: if an enclosing parser fails or backtracks afterwards,
+// the accumulator (or an error returned by them) is discarded without being freed.
+// if the result of `p` is an error, the parse fails with it and `out` of the final result holds the accumulator.
+// with `CC_PARSE_LAZY_ERRORS`, invalid inputs are parsed twice, so `init` and `step` run again on the second pass.
+struct cc_parser *cc_many_reduce(cc_lift_t init, cc_step_t step, struct cc_parser *p);
+
 // runs parser `a` until parser `end` succeeds.
 // parser results are combined using the folding function `f`.
 struct cc_parser *cc_many_until(cc_fold_t f, struct cc_parser *a, struct cc_parser *end);
@@ -354,6 +384,16 @@ struct cc_parser *cc_noreturn(struct cc_parser *p);
 // this can reduce the memory footprint of the parser.
 struct cc_parser *cc_noerror(struct cc_parser *p);
 
+// memoizes the results of parser `p` per input position (packrat parsing).
+// repeated attempts of `p` at the same position, e.g. when backtracking in `cc_or`,
+// reuse the first result instead of parsing the input again.
+// this assumes the bindings visible to `p` do not change between these attempts.
+struct cc_parser *cc_memo(struct cc_parser *p);
+
+// runs `p` and returns the part of the input it consumed as a `struct cc_span` instead of its result.
+// `p` does not construct a result, so no characters are copied. the returned span must be freed manually.
+struct cc_parser *cc_capture(struct cc_parser *p);
+
 // enables the `FREE_DATA` flag on the parser `p`.
 // when `p` gets deleted, the user data associated with it is passed to `free`.
 struct cc_parser *cc_free_data(struct cc_parser *p);
@@ -392,6 +432,24 @@ struct cc_result cc_apply_free(void *r);
 struct cc_parser *cc_regex_from(const struct cc_source *s, struct cc_error **e);
 struct cc_parser *cc_regex(const char8_t *re, struct cc_error **e);
 
+enum cc_regex_flags {
+    CC_REGEX_DEFAULT    = 0x00,
+    CC_REGEX_DFA        = 0x01, // match in linear time using a lazily built dfa, finds the longest match instead of backtracking
+};
+
+// same as `cc_regex`, but with additional `cc_regex_flags` set in `flags`.
+struct cc_parser *cc_regex_with(const char8_t *re, int flags, struct cc_error **e);
+
+// searches the input of `s` for the leftmost-longest match of `re` starting at or after the byte offset `*off`.
+// `re` has to be constructed with `CC_REGEX_DFA` and `s` must not be a streaming source.
+// returns `CC_MATCH` and stores the matched input in `m`, `CC_NOMATCH` or a negative errno value on error.
+// `*off` is advanced past the match (by at least one character), so repeated calls find all non-overlapping matches.
+int cc_regex_search(const struct cc_source *s, struct cc_parser *re, size_t *off, struct cc_span *m);
+
+// calls `f` on every non-overlapping match of `re` in the input of `s` like `cc_regex_search`.
+// stops at the first non-zero value returned by `f` and returns it. otherwise returns `0` or an ERRNO value.
+int cc_regex_findall(const struct cc_source *s, struct cc_parser *re, int (*f)(const struct cc_span *m, void *userp), void *userp);
+
 
 enum cc_match_result {
     CC_NOMATCH  = 0,
@@ -464,13 +522,36 @@ struct cc_grammar *cc_bnf(const char8_t *s, const struct cc_action actions[], st
  */
 
 // returns the with the name `name` associated parser in the grammar `g`.
-// if no such parser is found, NULL is returned and errno set.
+// if no such parser is found, NULL is returned and errno set to ENOENT.
 struct cc_parser *cc_rule(const struct cc_grammar *g, const char *name);
 
+// same as `cc_rule`, but the references between the rules of `g` are resolved once instead of while parsing.
+// the returned parser does not retain the other rules, so `g` has to be freed after it.
+// must not be called while parsers of `g` are in use.
+struct cc_parser *cc_grammar_link(struct cc_grammar *g, const char *name);
+
 // frees a grammar object.
 // the reference-counts of all contained parsers is decreased.
 void cc_grammar_free(struct cc_grammar *g);
 
+// writes the rules of `g` to the file `path` in a binary format, which `cc_grammar_load` reads without parsing.
+// functions are stored by the name of their action (or library function like `cc_fold_concat`).
+// returns `0` or an ERRNO value, `ENOTSUP` if a function has no name or `g` contains regular expressions compiled with `CC_REGEX_DFA`.
+int cc_grammar_save(const struct cc_grammar *g, const char *path);
+
+// loads a grammar written by `cc_grammar_save`, the functions are bound to the `actions` with the same names again.
+// images are stored in the byte order of the machine that saved them and cannot be loaded on machines with the other one.
+// if the file is invalid, NULL is returned and errno set.
+struct cc_grammar *cc_grammar_load(const char *path, const struct cc_action actions[]);
+
+// writes a C translation unit defining `int name(const char8_t *in, size_t n, struct cc_result *r)` to `f`,
+// which parses the `n` bytes of `in` like `cc_parse` with `p` would, without interpreting `p`.
+// character literals are compared bytewise, so the result may differ from `cc_parse` if `in` is not valid utf-8.
+// functions are called by the name of their action (or library function like `cc_fold_concat`) and have to be linked in.
+// returns `0` or an ERRNO value, `ENOTSUP` if a function has no name, a parser is reached in scopes (see `cc_bind`) its lookups
+// resolve differently in, or `p` contains regular expressions compiled with `CC_REGEX_DFA`.
+int cc_codegen_c(struct cc_parser *p, const char *name, const struct cc_action actions[], FILE *f);
+
 /*
  * Source
  */
@@ -482,6 +563,15 @@ struct cc_source *cc_nstring_source(const char8_t *s, size_t n);
 // construct a `cc_source` from a file read from `filename`.
 struct cc_source *cc_open(const char *filename);
 
+// construct a streaming `cc_source`, which pulls its input from `read` while parsing.
+// `read` stores up to `n` bytes in `buf` and their count in `nread` (0 at the end of the input), it returns 0 or an ERRNO value.
+// only the input after the oldest location the parser might backtrack to is kept in memory.
+// every `cc_parse` continues where the last successful parse on the source stopped.
+struct cc_source *cc_stream_source(cc_read_t read, void *userp);
+
+// construct a streaming `cc_source` reading from the file descriptor `fd`, which is not closed by `cc_close`.
+struct cc_source *cc_fd_source(int fd);
+
 // frees a `cc_source` and closes all associated IO objects
 int cc_close(struct cc_source *s);
 
@@ -492,6 +582,58 @@ int cc_close(struct cc_source *s);
 // otherwise, `cc_parse` returns `0` and `r` contains the parsing result as either a value or an error report.
 int cc_parse(const struct cc_source *s, struct cc_parser *p, struct cc_result *r);
 
+enum cc_parse_flags {
+    CC_PARSE_DEFAULT     = 0x00,
+    CC_PARSE_MEMOIZE     = 0x01, // memoize every combinator like `cc_memo`, guarantees linear time for PEG-style grammars
+    CC_PARSE_LAZY_ERRORS = 0x02, // parse without tracking errors first, only parse again with error reports if that fails
+};
+
+// same as `cc_parse`, but with additional `cc_parse_flags` set in `flags`.
+int cc_parse_with(const struct cc_source *s, struct cc_parser *p, struct cc_result *r, int flags);
+
+// a `cc_context` keeps the internal buffers of `cc_parse` (stacks, scope, error report) allocated between parses.
+// when parsing many inputs, reusing a context avoids allocating these buffers over and over again.
+// a context must not be used by multiple threads at the same time.
+struct cc_context *cc_context_create(void);
+
+// frees the buffers kept by `ctx` (e.g. after parsing an unusually large input), `ctx` stays usable.
+void cc_context_reset(struct cc_context *ctx);
+
+void cc_context_destroy(struct cc_context *ctx);
+
+// same as `cc_parse_with`, but uses the buffers of `ctx`.
+int cc_parse_ctx(struct cc_context *ctx, const struct cc_source *s, struct cc_parser *p, struct cc_result *r, int flags);
+
+// parses each of the `n` sources in `sources` with the parser `p` and stores the results in `results`.
+// the sources are distributed over `nthreads` threads (0: one per online CPU), `p` is frozen using `cc_freeze`.
+// returns `0` or the first internal ERRNO value encountered.
+int cc_parse_batch(const struct cc_source *const sources[], size_t n, struct cc_parser *p, struct cc_result results[], unsigned nthreads);
+
+enum cc_event_type {
+    CC_EVENT_ENTER, // a rule starts matching at `offset`
+    CC_EVENT_EXIT,  // a rule matched `text`
+    CC_EVENT_TOKEN, // a `cc_capture` matched `text`
+};
+
+// an event of `cc_parse_events`, `text` is only valid during the call of the handler.
+struct cc_event {
+    enum cc_event_type type;
+    const char *rule;    // name of the rule, NULL for tokens
+    size_t offset;       // byte offset of the start of `text`
+    struct cc_span text; // matched input, empty for enter events
+};
+
+// returns 0 or an ERRNO value, which stops the parse
+typedef int (*cc_event_t)(const struct cc_event *ev, void *userp);
+
+// parses `s` using `p` like `cc_parse`, but calls `handler` on events in document order instead of building a result.
+// rules are the combinators called by name (`cc_lookup` or grammar rules), rules consisting of a single terminal parser emit no events.
+// events of alternatives that might still fail are held back until the parser cannot backtrack past them anymore.
+// `cc_memo` has no effect, as replayed results would skip their events.
+// returns `CC_MATCH`, `CC_NOMATCH` (with the error report stored in `e`, if not NULL) or a negative ERRNO value,
+// which is also returned if `handler` stopped the parse.
+int cc_parse_events(const struct cc_source *s, struct cc_parser *p, cc_event_t handler, void *userp, struct cc_error **e);
+
 /*
  * Character matchers
  */
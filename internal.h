@@ -55,6 +55,7 @@ enum parser_type : uint16_t {
     PARSER_ANYOF,
     PARSER_NONEOF,
     PARSER_ONEOF,
+    PARSER_REGEX,
 
     // combinators
     PARSER_EXPECT,
@@ -71,11 +72,14 @@ enum parser_type : uint16_t {
     PARSER_MAYBE,
     PARSER_CHAIN,
     PARSER_POSTFIX,
+    PARSER_REDUCE,
 
     // control parsers
     PARSER_LOCATION,
     PARSER_NORETURN,
     PARSER_NOERROR,
+    PARSER_MEMO,
+    PARSER_CAPTURE,
 
     PARSER_LOOKUP,
     PARSER_BIND,
@@ -84,9 +88,59 @@ enum parser_type : uint16_t {
 };
 
 static inline bool is_combinator(enum parser_type p) {
-    return (p >= PARSER_EXPECT && p <= PARSER_POSTFIX) || (p >= PARSER_NORETURN && p <= PARSER_BIND && p != PARSER_LOOKUP);
+    return (p >= PARSER_EXPECT && p <= PARSER_REDUCE) || (p >= PARSER_NORETURN && p <= PARSER_BIND && p != PARSER_LOOKUP);
 }
 
+// character set of anyof/oneof/noneof parsers, compiled when the parser is constructed
+struct char_class {
+    uint32_t ascii[4]; // bitmap of the code points < 0x80
+    size_t n;
+    struct { char32_t lo, hi; } ranges[]; // sorted, disjoint ranges of the code points >= 0x80
+};
+
+static inline bool char_class_has(const struct char_class *c, char32_t cp) {
+    if(cp < 0x80)
+        return !!(c->ascii[cp / 32] & (1u << (cp % 32)));
+
+    size_t lo = 0, hi = c->n;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(cp < c->ranges[mid].lo)
+            hi = mid;
+        else if(cp > c->ranges[mid].hi)
+            lo = mid + 1;
+        else
+            return true;
+    }
+
+    return false;
+}
+
+// compiles `chars` into a character set, characters occurring more than once are left out if `unique` is set
+__internal struct char_class *char_class_compile(const char32_t *chars, size_t n, bool unique);
+
+// regular (sub-)grammar compiled to a lazily built dfa over the utf-8 bytes of the input, see cc_dfa.c
+struct regex;
+
+// returns the input at the start of the match, streaming sources try to make at least `n` bytes available first.
+// the number of available bytes is stored in `avail`.
+typedef const char8_t *(*regex_input_t)(void *userp, size_t n, size_t *avail);
+
+// compiles `p`, returns NULL with errno set to ENOTSUP if `p` is not regular
+__internal struct regex *regex_compile(const struct cc_parser *p);
+__internal void regex_free(struct regex *re);
+
+// matches the longest prefix of the input, its length is stored in `len`.
+// `sof` is set if the match starts at the start of the input.
+__internal int regex_match(struct regex *re, bool sof, regex_input_t input, void *userp, size_t *len);
+
+// finds the leftmost-longest match in `buf` starting at or after the byte offset `from`.
+// the match starts at the byte offset stored in `start`, its length is stored in `len`.
+__internal int regex_search(struct regex *re, const char8_t *buf, size_t size, size_t from, size_t *start, size_t *len);
+
+// stores the bytes a match can start with in `bytes`, returns true if `re` can match without consuming input
+__internal bool regex_first_bytes(struct regex *re, uint32_t bytes[256 / 32]);
+
 struct cc_binding {
     const char *name;
     struct cc_parser *p;
@@ -94,7 +148,9 @@ struct cc_binding {
 
 enum parser_flags : uint16_t {
     PARSER_FLAG_FREE_DATA = 0x01,
-    PARSER_FLAG_RETAIN_INNER = 0x02
+    PARSER_FLAG_RETAIN_INNER = 0x02,
+    PARSER_FLAG_FROZEN = 0x04, // compiled and shared between threads, uses atomic reference-counting
+    PARSER_FLAG_LINKED = 0x08, // the lookups of grammar rules reachable from this parser are resolved
 };
 
 struct cc_parser {
@@ -110,12 +166,19 @@ struct cc_parser {
         char32_t ch;
         struct { char32_t lo, hi; }; // range
 
-        const char8_t *str;
+        struct {
+            const char8_t *str;
+            size_t len;
+        };
+
         const char *msg;
 
         int (*matchfn)(char32_t);
 
-        const char *lookup;
+        struct {
+            const char *name;
+            struct cc_parser *target; // rule resolved by `cc_grammar_link`, not retained
+        } lookup;
 
         struct {
             struct cc_binding *binding;
@@ -127,11 +190,20 @@ struct cc_parser {
             struct cc_parser *inner;
         } apply;
 
+        struct {
+            cc_lift_t init;
+            cc_step_t step;
+            struct cc_parser *inner;
+        } reduce;
+
         struct {
             const char32_t *chars;
             size_t n;
+            struct char_class *class;
         } list;
 
+        struct regex *regex;
+
         union {
             cc_lift_t lf;
             void *val;
@@ -166,12 +238,28 @@ struct cc_source {
 
     int fd;
 
+    // `buffer` holds the input from byte offset `buffer_off` to `buffer_off + buffer_size`
     const char8_t *buffer;
     size_t buffer_size;
+    size_t buffer_off;
 
     int (*buffer_dtor)(const char8_t *buffer);
+
+    // streaming sources pull their input from `read` while parsing
+    struct {
+        cc_read_t read; // NULL if the whole input is in `buffer`
+        void *userp;
+        size_t capacity;
+        bool eof;
+        int err;
+        struct cc_location pos; // location the next parse continues at
+    } stream;
 };
 
+// number of bytes a streaming source keeps available after the current location, enough for one utf-8 character
+#define STREAM_LOOKAHEAD 4
+#define STREAM_INIT_CAP 4096
+
 // Intermediate-representation structs:
 
 enum cc_ir_opcode : uint8_t {
@@ -189,68 +277,106 @@ enum cc_ir_opcode : uint8_t {
     IR_SET_NORETURN,        // set the noretun flag
 
     IR_CALL,                // call another parser
-    IR_RETURN,              // return from the current parser
+    IR_RETURN,              // return from the current parser with the top stack element as result
 
     IR_FOLD,                // call the fold function
     IR_APPLY,               // call the apply function
+    IR_CAPTURE,             // push the input consumed by the current parser as a span
     IR_EXPECT,              // add an "expect XXX" entry to an error
     IR_PUSH_BINDING,        // push a new binding
     IR_POP_BINDING,         // pop the topmost binding
     IR_NULL_RESULT,         // push a NULL (empty) parser result
     IR_POP_RESULT,          // pop the topmost parser result
+    IR_REDUCE_INIT,         // push a new accumulator as parser result
+    IR_REDUCE,              // combine the topmost parser result with the accumulator below it
 
     IR_JUMP,                // unconditional jump
     IR_JUMP_IF_NONZERO,     // jump if the top stack element != 0
     IR_JUMP_IF_SUCCESS,     // jump if the top stack element == PARSE_SUCCESS
     IR_JUMP_IF_FAILURE,     // jump if the top stack element == PARSE_FAILURE
+    IR_PREDICT,             // jump if the lookahead cannot start the next variant
+
+    IR_MATCH,               // match a terminal parser inline
+    IR_MATCH_CHAR,          // match a single character inline
+    IR_MATCH_RANGE,         // match a character range inline
+    IR_MATCH_SET,           // match a character of an anyof/oneof/noneof set inline
+    IR_MATCH_STRING,        // match a string inline
+    IR_SCAN_CLASS,          // consume a run of characters of a class at once if no results are needed
+    IR_SCAN_UNTIL,          // skip ahead to the next occurrence of a string if no results are needed
+
+    IR_OPCODE_MAX
 };
 
 #define IR_UNROLL_THRESHOLD 8
 
+#define SCAN_MAX_RANGES 4
+
+// operand of IR_SCAN_CLASS, ascii characters are matched without calling the terminal parser
+struct scan_class {
+    const struct cc_parser *p; // terminal matching all other code points
+    uint32_t ascii[4];
+    uint32_t n; // number of ascii ranges for the vectorized scan, 0 if the class consists of more
+    uint8_t lo[SCAN_MAX_RANGES], hi[SCAN_MAX_RANGES];
+};
+
+// IR_PREDICT operand if the error entries of a skipped variant are not known, it is then only skipped while errors are suppressed
+#define IR_PREDICT_UNKNOWN UINT32_MAX
+
 #define IR_INIT_CAPACITY 16
 #define IR_ALLOC_SIZE(cap) MAX(sizeof(struct cc_ir), offsetof(struct cc_ir, bytes) + (cap)) 
 
+// operands follow their opcode in native byte order, padded to their natural alignment
+#define IR_ALIGN(ip, type) (((ip) + alignof(type) - 1) & ~(uint32_t) (alignof(type) - 1))
+
 struct cc_ir {
     uint32_t count;
     uint32_t capacity;
-    uint8_t bytes[];
+    alignas(uintptr_t) uint8_t bytes[];
 };
 
 __internal int cc_compile(struct cc_parser *p);
 
+// Grammar analysis:
+
+// code points >= FIRST_SET_OTHER share one entry of a first set
+#define FIRST_SET_OTHER 0xff
+#define FIRST_SET_WORDS ((FIRST_SET_OTHER + 1) / 32)
+
+// code points a parser can start with
+struct first_set {
+    bool nullable; // can succeed without consuming any input
+    uint32_t bits[FIRST_SET_WORDS];
+};
+
+static inline uint32_t first_set_index(char32_t cp) {
+    return cp < FIRST_SET_OTHER ? cp : FIRST_SET_OTHER;
+}
+
 __internal int ir_dump(const struct cc_ir *ir, FILE *f);
 __internal const char *ir_str_opcode(enum cc_ir_opcode opcode);
 
 static inline uint32_t ir_read_u32(const struct cc_ir *ir, uint32_t ip) {
-    assert(ir->count - ip >= sizeof(uint32_t));
-    uint32_t c = 0;
-    for(unsigned i = 0; i < sizeof(uint32_t); i++) {
-        c |= (uint32_t) ir->bytes[ip + i] << ((sizeof(uint32_t) - i - 1) * 8);
-    }
+    assert(ip % alignof(uint32_t) == 0 && ir->count - ip >= sizeof(uint32_t));
+    uint32_t c;
+    memcpy(&c, ir->bytes + ip, sizeof(uint32_t));
     return c;
 }
 
 static inline uintptr_t ir_read_ptr(const struct cc_ir *ir, uint32_t ip) {
-    assert(ir->count - ip >= sizeof(uintptr_t));
-    uintptr_t c = 0;
-    for(unsigned i = 0; i < sizeof(uintptr_t); i++) {
-        c |= (uintptr_t) ir->bytes[ip + i] << ((sizeof(uintptr_t) - i - 1) * 8);
-    }
+    assert(ip % alignof(uintptr_t) == 0 && ir->count - ip >= sizeof(uintptr_t));
+    uintptr_t c;
+    memcpy(&c, ir->bytes + ip, sizeof(uintptr_t));
     return c;
 }
 
 static inline void ir_write_u32(struct cc_ir *ir, uint32_t ip, uint32_t p) {
-    assert(ir->count - ip >= sizeof(uint32_t));
-    for(unsigned i = 0; i < sizeof(uint32_t); i++) {
-        ir->bytes[ip + i] = (p >> ((sizeof(uint32_t) - i - 1) * 8)) & 0xff;
-    }
+    assert(ip % alignof(uint32_t) == 0 && ir->count - ip >= sizeof(uint32_t));
+    memcpy(ir->bytes + ip, &p, sizeof(uint32_t));
 }
 
 static inline void ir_write_ptr(struct cc_ir *ir, uint32_t ip, uintptr_t p) {
-    assert(ir->count - ip >= sizeof(uintptr_t));
-    for(unsigned i = 0; i < sizeof(uintptr_t); i++) {
-        ir->bytes[ip + i] = (p >> ((sizeof(uintptr_t) - i - 1) * 8)) & 0xff;
-    }
+    assert(ip % alignof(uintptr_t) == 0 && ir->count - ip >= sizeof(uintptr_t));
+    memcpy(ir->bytes + ip, &p, sizeof(uintptr_t));
 }
 
 // Stack structs used for evaluation
@@ -271,6 +397,34 @@ __internal int result_push(struct result_stack *st, struct cc_lazy* v);
 __internal struct cc_lazy *result_pop(struct result_stack *st);
 __internal struct cc_lazy *result_top(struct result_stack *st);
 
+// Arena allocator for lazy nodes:
+
+// lazy nodes are allocated by bumping a pointer through a list of chunks and never freed individually.
+// positions in the arena are monotonic, so backtracking can release everything above a saved position.
+struct cc_arena_chunk {
+    struct cc_arena_chunk *prev;
+    struct cc_arena_chunk *next;
+    size_t base; // arena position of data[0]
+    size_t size;
+    size_t used;
+    alignas(max_align_t) uint8_t data[];
+};
+
+struct cc_arena {
+    struct cc_arena_chunk *first;
+    struct cc_arena_chunk *current;
+};
+
+#define ARENA_INIT {NULL, NULL}
+
+static inline size_t arena_mark(const struct cc_arena *a) {
+    return a->current ? a->current->base + a->current->used : 0;
+}
+
+// releases everything allocated after `mark`, chunks are kept for reuse
+__internal void arena_reset(struct cc_arena *a, size_t mark);
+__internal void arena_free(struct cc_arena *a);
+
 // Lazy-evaluation structs:
 
 enum cc_lazy_type : uint8_t {
@@ -281,11 +435,14 @@ enum cc_lazy_type : uint8_t {
     LAZY_LIFT,
     LAZY_FOLD,
     LAZY_APPLY,
+    LAZY_SPAN,
+    LAZY_TEXT,
+    LAZY_REDUCE,
 };
 
 struct cc_lazy {
     enum cc_lazy_type type;
-    struct cc_location location;
+    size_t location; // byte offset, the line and column are only computed for errors
 };
 
 #define LAZY_UPCAST(l) (&(l)->lazy)
@@ -299,7 +456,8 @@ struct cc_lazy_value {
 
 static_assert(offsetof(struct cc_lazy_value, lazy) == 0);
 
-__internal struct cc_lazy_value *lazy_value(struct cc_location loc, void *value);
+// values that fit into a tagged node pointer (see below) are not allocated
+__internal struct cc_lazy *lazy_value(struct cc_arena *a, size_t loc, void *value);
 
 struct cc_lazy_inline {
     struct cc_lazy lazy;
@@ -310,17 +468,7 @@ struct cc_lazy_inline {
 
 static_assert(offsetof(struct cc_lazy_inline, lazy) == 0);
 
-__internal struct cc_lazy_inline *lazy_inline(struct cc_location loc, void *value, size_t size);
-
-struct cc_lazy_char {
-    struct cc_lazy lazy;
-
-    char32_t ch;
-};
-
-static_assert(offsetof(struct cc_lazy_char, lazy) == 0);
-
-__internal struct cc_lazy_char *lazy_char(struct cc_location loc, char32_t ch);
+__internal struct cc_lazy_inline *lazy_inline(struct cc_arena *a, size_t loc, void *value, size_t size);
 
 struct cc_lazy_terminal {
     struct cc_lazy lazy;
@@ -330,7 +478,7 @@ struct cc_lazy_terminal {
 
 static_assert(offsetof(struct cc_lazy_terminal, lazy) == 0);
 
-__internal struct cc_lazy_terminal *lazy_terminal(struct cc_location loc, struct cc_parser *p);
+__internal struct cc_lazy_terminal *lazy_terminal(struct cc_arena *a, size_t loc, struct cc_parser *p);
 
 struct cc_lazy_lift {
     struct cc_lazy lazy;
@@ -340,7 +488,7 @@ struct cc_lazy_lift {
 
 static_assert(offsetof(struct cc_lazy_lift, lazy) == 0);
 
-__internal struct cc_lazy_lift *lazy_lift(struct cc_location loc, cc_lift_t lift);
+__internal struct cc_lazy_lift *lazy_lift(struct cc_arena *a, size_t loc, cc_lift_t lift);
 
 struct cc_lazy_fold {
     struct cc_lazy lazy;
@@ -352,7 +500,7 @@ struct cc_lazy_fold {
 
 static_assert(offsetof(struct cc_lazy_fold, lazy) == 0);
 
-__internal struct cc_lazy_fold *lazy_fold(struct cc_location loc, cc_fold_t fold, unsigned n, struct cc_lazy *values[]);
+__internal struct cc_lazy_fold *lazy_fold(struct cc_arena *a, size_t loc, cc_fold_t fold, unsigned n, struct cc_lazy *values[]);
 
 struct cc_lazy_apply {
     struct cc_lazy lazy;
@@ -363,30 +511,104 @@ struct cc_lazy_apply {
 
 static_assert(offsetof(struct cc_lazy_apply, lazy) == 0);
 
-__internal struct cc_lazy_apply *lazy_apply(struct cc_location loc, cc_apply_t apply, struct cc_lazy *value);
+__internal struct cc_lazy_apply *lazy_apply(struct cc_arena *a, size_t loc, cc_apply_t apply, struct cc_lazy *value);
 
-static inline bool lazy_is_recursive(struct cc_lazy* lazy) {
-    return lazy != NULL && (lazy->type == LAZY_APPLY || lazy->type == LAZY_FOLD);
+struct cc_lazy_reduce {
+    struct cc_lazy lazy;
+
+    struct cc_result acc; // already evaluated, `acc.err` has its location attached
+};
+
+static_assert(offsetof(struct cc_lazy_reduce, lazy) == 0);
+
+__internal struct cc_lazy_reduce *lazy_reduce(struct cc_arena *a, size_t loc, struct cc_result acc);
+
+struct cc_lazy_span {
+    struct cc_lazy lazy;
+
+    struct cc_span span; // `span.ptr` is NULL if the input was copied to `data`
+    char8_t data[];
+};
+
+static_assert(offsetof(struct cc_lazy_span, lazy) == 0);
+
+// input of streaming sources does not outlive the parse, so it gets copied if `copy` is set
+__internal struct cc_lazy_span *lazy_span(struct cc_arena *a, size_t loc, const char8_t *ptr, size_t len, bool copy);
+
+// same as `lazy_span`, but evaluates to a copy of the text as a string
+__internal struct cc_lazy_span *lazy_text(struct cc_arena *a, size_t loc, const char8_t *ptr, size_t len, bool copy);
+
+// Tagged lazy nodes:
+
+// characters and most values are encoded in the node pointer itself instead of allocating a node.
+// nodes are aligned to `alignof(max_align_t)`, so the lowest bits of a real node pointer are always zero.
+// tagged nodes have no location, which is fine, since evaluating them cannot fail with an error message.
+#define LAZY_TAG_BITS 2
+#define LAZY_TAG_MASK (((uintptr_t) 1 << LAZY_TAG_BITS) - 1)
+
+static_assert(alignof(max_align_t) > LAZY_TAG_MASK);
+
+enum lazy_tag {
+    LAZY_TAG_NONE = 0x00,
+    LAZY_TAG_CHAR,
+    LAZY_TAG_VALUE,
+};
+
+static inline enum lazy_tag lazy_tag(const struct cc_lazy *lazy) {
+    return (uintptr_t) lazy & LAZY_TAG_MASK;
+}
+
+static inline enum cc_lazy_type lazy_type(const struct cc_lazy *lazy) {
+    switch(lazy_tag(lazy)) {
+    case LAZY_TAG_CHAR:
+        return LAZY_CHAR;
+    case LAZY_TAG_VALUE:
+        return LAZY_VALUE;
+    default:
+        return lazy->type;
+    }
+}
+
+static inline struct cc_lazy *lazy_char(char32_t ch) {
+    return (struct cc_lazy*) (((uintptr_t) ch << LAZY_TAG_BITS) | LAZY_TAG_CHAR);
 }
 
-// freeing done on a stack since lazy-trees might be very big
-__internal int lazy_free(struct cc_lazy *lazy, struct result_stack *stack);
+static inline char32_t lazy_get_char(const struct cc_lazy *lazy) {
+    return (uintptr_t) lazy >> LAZY_TAG_BITS;
+}
+
+// the value is sign-extended, so small negative integers and all canonical pointers fit
+static inline bool lazy_value_fits(void *value) {
+    return (intptr_t) ((uintptr_t) value << LAZY_TAG_BITS) >> LAZY_TAG_BITS == (intptr_t) value;
+}
+
+static inline void *lazy_get_value(const struct cc_lazy *lazy) {
+    if(lazy_tag(lazy) == LAZY_TAG_VALUE)
+        return (void*) ((intptr_t) lazy >> LAZY_TAG_BITS);
+
+    return ((const struct cc_lazy_value*) lazy)->value;
+}
+
+static inline bool lazy_is_recursive(struct cc_lazy* lazy) {
+    return lazy != NULL && lazy_tag(lazy) == LAZY_TAG_NONE && (lazy->type == LAZY_APPLY || lazy->type == LAZY_FOLD);
+}
 
 __internal void lazy_debug_dump(const struct cc_lazy *lazy, FILE *f);
 
 // UTF-8 utilities:
 
-#define CC_UTF8_ENCODE_MAX (MB_CUR_MAX + 1)
+#define CC_UTF8_ENCODE_MAX 5
 #define CC_UTF8_ENCODE_PRINTABLE_MAX MAX(CC_UTF8_ENCODE_MAX, 16)
 
 #define CC_UTF8_IS_CONT(x) (((x) & 0xc0) == 0x80)
 
+// decodes the first character of `s`, ascii and stray continuation bytes are never combined with the bytes after them
 static inline char32_t utf8_first_cp(const uint8_t *s) {
-    uint32_t k = s[0] ? __builtin_clz(~(s[0] << 24)) : 0;
+    uint32_t k = __builtin_clz(~((uint32_t) s[0] << 24));
     uint32_t mask = (1 << (8 - k)) - 1;
     uint32_t value = *s & mask;
 
-    for(s++, k--; k > 0 && CC_UTF8_IS_CONT(s[0]); k--, s++) {
+    for(s++; k > 1 && CC_UTF8_IS_CONT(s[0]); k--, s++) {
         value <<= 6;
         value += (*s & 0x3f);
     }
@@ -405,14 +627,15 @@ static inline bool utf8_single_char(const char8_t *s) {
     return s[0] != '\0' && s[utf8_cp_length(s[0])] == '\0';
 }
 
-static inline int utf8_encode(char32_t cp, char8_t dst[CC_UTF8_ENCODE_MAX]) {
-    mbstate_t ps = {0};
-    size_t l = c32rtomb((char*) dst, cp, &ps); 
-    if(l == (size_t) -1)
-        return errno;
+// encodes `cp` independent of the locale, since the input is always utf-8. returns the length without the NUL byte
+static inline size_t utf8_encode(char32_t cp, char8_t dst[CC_UTF8_ENCODE_MAX]) {
+    size_t len = utf8_cp_length(cp);
+    dst[len] = '\0';
+    for(size_t i = len - 1; i > 0; i--, cp >>= 6)
+        dst[i] = 0x80 | (cp & 0x3f);
 
-    dst[l] = '\0';
-    return 0;
+    dst[0] = cp | (len > 1 ? (0xf00 >> len) & 0xff : 0);
+    return len;
 }
 
 static inline int utf8_encode_printable(char32_t cp, char8_t dst[CC_UTF8_ENCODE_PRINTABLE_MAX]) {
@@ -442,9 +665,7 @@ static inline int utf8_encode_printable(char32_t cp, char8_t dst[CC_UTF8_ENCODE_
     default:
         if(cc_is_print(cp)) {
             char8_t buf[CC_UTF8_ENCODE_MAX];
-            if((err = utf8_encode(cp, buf)))
-                break;
-
+            utf8_encode(cp, buf);
             if(snprintf((char*) dst, CC_UTF8_ENCODE_PRINTABLE_MAX, "'%s'", (char*) buf) < 0)
                 err = errno;
         }
@@ -530,6 +751,7 @@ struct cc_hashtable {
     size_t size;
     struct cc_hashentry **entries;
     struct cc_hashentry *head;
+    struct cc_hashentry *unused; // removed entries, reused by later insertions
 };
 
 #define FNV_OFFSET 14695981039346656037ul
@@ -563,10 +785,21 @@ __internal void *hashtable_head_value(struct cc_hashtable *t);
 
 struct cc_grammar {
     struct cc_hashtable rules;
+    struct cc_action *actions; // copy of the actions the rules were built with, NULL-terminated
+
+    bool linked; // the lookups of rules are resolved, see `cc_grammar_link`
+    bool scoped; // the rules contain bindings, which might shadow other rules
 };
 
 __internal struct cc_grammar *grammar_init(size_t cap);
+__internal int grammar_set_actions(struct cc_grammar *g, const struct cc_action actions[]);
 __internal void grammar_free(struct cc_grammar *g);
 
+// library functions parsers can refer to without them being passed as actions, see cc_serialize.c
+__internal extern const struct cc_action builtin_actions[];
+
+// finds the action referring to the same function as `fn`
+__internal const struct cc_action *find_action(const struct cc_action actions[], const struct cc_action *fn);
+
 #endif /* CC_INTERNAL_H */
 
@@ -0,0 +1,208 @@
+// ccgen: compiles a rule of a BNF grammar to a standalone C parser using `cc_codegen_c`
+//
+//     ccgen [-o output] [-n name] [-f|-a|-l|-m|-v action[=symbol]]... grammar rule
+//
+// the actions of the grammar are declared by their type (fold, apply, lift, match or value).
+// the generated parser refers to them by `symbol` (the name of the action by default), which has to be linked in:
+//
+//     ccgen -o json.c -n parse_json -f concat=cc_fold_concat -m digit=cc_is_digit json.bnf value
+
+#include <ccombinator.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STUBS 16
+#define STUBS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+// the grammar is never run, so its actions are placeholders told apart by their address.
+// every one returns a different value, so the compiler cannot merge them.
+#define FOLD_STUB(i) static struct cc_result fold_stub_##i(size_t n, void **r) { (void) n; (void) r; return cc_ok((void*) (uintptr_t) (i)); }
+#define APPLY_STUB(i) static struct cc_result apply_stub_##i(void *r) { (void) r; return cc_ok((void*) (uintptr_t) (i)); }
+#define LIFT_STUB(i) static struct cc_result lift_stub_##i(void) { return cc_ok((void*) (uintptr_t) (i)); }
+#define MATCH_STUB(i) static int match_stub_##i(char32_t c) { return c == (i); }
+
+STUBS(FOLD_STUB)
+STUBS(APPLY_STUB)
+STUBS(LIFT_STUB)
+STUBS(MATCH_STUB)
+
+#define FOLD_REF(i) fold_stub_##i,
+#define APPLY_REF(i) apply_stub_##i,
+#define LIFT_REF(i) lift_stub_##i,
+#define MATCH_REF(i) match_stub_##i,
+
+static const cc_fold_t fold_stubs[MAX_STUBS] = { STUBS(FOLD_REF) };
+static const cc_apply_t apply_stubs[MAX_STUBS] = { STUBS(APPLY_REF) };
+static const cc_lift_t lift_stubs[MAX_STUBS] = { STUBS(LIFT_REF) };
+static const cc_match_t match_stubs[MAX_STUBS] = { STUBS(MATCH_REF) };
+static char value_stubs[MAX_STUBS];
+
+#define MAX_ACTIONS (5 * MAX_STUBS)
+
+// actions by their name in the grammar and by their symbol in the generated code
+static struct cc_action grammar_actions[MAX_ACTIONS + 1];
+static struct cc_action symbol_actions[MAX_ACTIONS + 1];
+static size_t num_actions;
+
+static unsigned num_stubs[CC_ACTION_MATCH + 1];
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-o output] [-n name] [-f|-a|-l|-m|-v action[=symbol]]... grammar rule\n", argv0);
+    exit(EXIT_FAILURE);
+}
+
+static int add_action(enum cc_action_type type, char *decl) {
+    if(num_stubs[type] >= MAX_STUBS) {
+        fprintf(stderr, "ccgen: too many actions of one type (at most %d)\n", MAX_STUBS);
+        return EINVAL;
+    }
+
+    char *symbol = strchr(decl, '=');
+    if(symbol)
+        *symbol++ = '\0';
+    else
+        symbol = decl;
+
+    unsigned i = num_stubs[type]++;
+    struct cc_action action = {.type = type};
+    switch(type) {
+    case CC_ACTION_FOLD:
+        action.fold = fold_stubs[i];
+        break;
+    case CC_ACTION_APPLY:
+        action.apply = apply_stubs[i];
+        break;
+    case CC_ACTION_LIFT:
+        action.lift = lift_stubs[i];
+        break;
+    case CC_ACTION_MATCH:
+        action.match = match_stubs[i];
+        break;
+    default:
+        action.value = &value_stubs[i];
+        break;
+    }
+
+    grammar_actions[num_actions] = action;
+    grammar_actions[num_actions].name = decl;
+    symbol_actions[num_actions] = action;
+    symbol_actions[num_actions].name = symbol;
+    num_actions++;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL, *name = NULL;
+
+    int i;
+    for(i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if(!argv[i][1] || argv[i][2] || i + 1 >= argc)
+            usage(argv[0]);
+
+        char *arg = argv[++i];
+        int err = 0;
+        switch(argv[i - 1][1]) {
+        case 'o':
+            output = arg;
+            break;
+        case 'n':
+            name = arg;
+            break;
+        case 'f':
+            err = add_action(CC_ACTION_FOLD, arg);
+            break;
+        case 'a':
+            err = add_action(CC_ACTION_APPLY, arg);
+            break;
+        case 'l':
+            err = add_action(CC_ACTION_LIFT, arg);
+            break;
+        case 'm':
+            err = add_action(CC_ACTION_MATCH, arg);
+            break;
+        case 'v':
+            err = add_action(CC_ACTION_VALUE, arg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+
+        if(err)
+            return EXIT_FAILURE;
+    }
+
+    if(argc - i != 2)
+        usage(argv[0]);
+
+    const char *path = argv[i], *rule = argv[i + 1];
+
+    // the parsing function is named after the rule by default
+    char default_name[256];
+    if(!name) {
+        snprintf(default_name, sizeof(default_name), "parse_%s", rule);
+        for(char *c = default_name; *c; c++) {
+            if(!(cc_is_alphanum(*c) || *c == '_'))
+                *c = '_';
+        }
+
+        name = default_name;
+    }
+
+    struct cc_source *src = cc_open(path);
+    if(!src) {
+        fprintf(stderr, "ccgen: %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    struct cc_error *e = NULL;
+    struct cc_grammar *g = cc_bnf_from(src, grammar_actions, &e);
+    cc_close(src);
+
+    if(!g) {
+        if(e) {
+            cc_err_fprint(e, stderr);
+            cc_err_free(e);
+        }
+        else
+            fprintf(stderr, "ccgen: %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    struct cc_parser *p = cc_grammar_link(g, rule);
+    if(!p) {
+        if(errno == ENOENT)
+            fprintf(stderr, "ccgen: %s: undefined rule '%s'\n", path, rule);
+        else
+            fprintf(stderr, "ccgen: %s: %s\n", path, strerror(errno));
+        cc_grammar_free(g);
+        return EXIT_FAILURE;
+    }
+
+    FILE *f = output ? fopen(output, "w") : stdout;
+    if(!f) {
+        fprintf(stderr, "ccgen: %s: %s\n", output, strerror(errno));
+        cc_release(p);
+        cc_grammar_free(g);
+        return EXIT_FAILURE;
+    }
+
+    int err = cc_codegen_c(p, name, symbol_actions, f);
+    if(err)
+        fprintf(stderr, "ccgen: %s: %s\n", path, strerror(err));
+
+    if(output && fclose(f) && !err) {
+        err = errno;
+        fprintf(stderr, "ccgen: %s: %s\n", output, strerror(err));
+    }
+
+    // no incomplete output is left behind
+    if(output && err)
+        remove(output);
+
+    cc_release(p);
+    cc_grammar_free(g);
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}